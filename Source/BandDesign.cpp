@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    BandDesign.cpp
+
+  ==============================================================================
+*/
+
+#include "BandDesign.h"
+#include "PluginProcessor.h"
+
+namespace BandDesign
+{
+
+// Bilinear Code
+//==============================================================================
+// The same formulas as juce::dsp::IIR::Coefficients
+namespace
+{
+    Biquad normalise(double b0, double b1, double b2, double a0, double a1, double a2)
+    {
+        auto scale = 1.0 / a0;
+        return {b0 * scale, b1 * scale, b2 * scale, a1 * scale, a2 * scale};
+    }
+
+    Biquad bilinearLowPass(double sampleRate, double frequency, double quality)
+    {
+        auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+        auto nSquared = n * n;
+        auto c1 = 1.0 / (1.0 + 1.0 / quality * n + nSquared);
+
+        return {c1, c1 * 2.0, c1, c1 * 2.0 * (1.0 - nSquared), c1 * (1.0 - 1.0 / quality * n + nSquared)};
+    }
+
+    Biquad bilinearHighPass(double sampleRate, double frequency, double quality)
+    {
+        auto n = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+        auto nSquared = n * n;
+        auto c1 = 1.0 / (1.0 + 1.0 / quality * n + nSquared);
+
+        return {c1, c1 * -2.0, c1, c1 * 2.0 * (nSquared - 1.0), c1 * (1.0 - 1.0 / quality * n + nSquared)};
+    }
+
+    Biquad bilinearPeak(double sampleRate, double frequency, double quality, double gainFactor)
+    {
+        auto A = std::sqrt(juce::jmax(0.0, gainFactor));
+        auto omega = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        auto alpha = std::sin(omega) / (quality * 2.0);
+        auto c2 = -2.0 * std::cos(omega);
+        auto alphaTimesA = alpha * A;
+        auto alphaOverA = alpha / A;
+
+        return normalise(1.0 + alphaTimesA, c2, 1.0 - alphaTimesA, 1.0 + alphaOverA, c2, 1.0 - alphaOverA);
+    }
+}
+
+// Design Code
+//==============================================================================
+Biquad designPeak(const ChainSettings& settings, double sampleRate) noexcept
+{
+    auto gain = juce::Decibels::decibelsToGain((double) settings.peakGainInDecibels);
+
+    if (settings.filterDesign == Design_AnalogMatched) {
+        return MatchedBiquad::peak(sampleRate, settings.peakFreq, settings.peakQuality, gain);
+    }
+    return bilinearPeak(sampleRate, settings.peakFreq, settings.peakQuality, gain);
+}
+
+Sections design(const ChainSettings& settings, double sampleRate) noexcept
+{
+    auto matched = settings.filterDesign == Design_AnalogMatched;
+
+    Sections sections;
+    sections.numLowCut = settings.lowCutSlope + 1;
+    sections.numHighCut = settings.highCutSlope + 1;
+
+    auto lowCutOrder = 2 * sections.numLowCut;
+    for (int i = 0; i < sections.numLowCut; i++) {
+        auto quality = MatchedBiquad::getButterworthQuality(i, lowCutOrder);
+        sections.lowCut[i] = matched ? MatchedBiquad::highPass(sampleRate, settings.lowCutFreq, quality)
+                                     : bilinearHighPass(sampleRate, settings.lowCutFreq, quality);
+    }
+
+    sections.peak = designPeak(settings, sampleRate);
+
+    auto highCutOrder = 2 * sections.numHighCut;
+    for (int i = 0; i < sections.numHighCut; i++) {
+        auto quality = MatchedBiquad::getButterworthQuality(i, highCutOrder);
+        sections.highCut[i] = matched ? MatchedBiquad::lowPass(sampleRate, settings.highCutFreq, quality)
+                                      : bilinearLowPass(sampleRate, settings.highCutFreq, quality);
+    }
+
+    return sections;
+}
+
+}
@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    BandDesign.h
+
+    Every biquad of a path's bands, designed straight from its ChainSettings
+    without allocating anything, so the audio thread can redesign them as
+    often as it needs to, e.g. at each MIDI controller change mid-block.
+    The designs are makeLowCutFilter's, makePeakFilter's and
+    makeHighCutFilter's, worked out in double.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MatchedBiquad.h"
+
+struct ChainSettings;
+
+namespace BandDesign
+{
+    using Biquad = MatchedBiquad::Design;
+
+    struct Sections
+    {
+        // Only the first numLowCut/numHighCut are used, one per 12 dB/oct
+        Biquad lowCut[4], highCut[4];
+        int numLowCut {1}, numHighCut {1};
+        Biquad peak;
+    };
+
+    Sections design(const ChainSettings& settings, double sampleRate) noexcept;
+
+    // The Peak band alone
+    Biquad designPeak(const ChainSettings& settings, double sampleRate) noexcept;
+}
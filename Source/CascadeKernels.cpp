@@ -0,0 +1,540 @@
+/*
+  ==============================================================================
+
+    CascadeKernels.cpp
+
+  ==============================================================================
+*/
+
+#include "CascadeKernels.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #define CASCADE_HAS_X86_KERNELS 1
+#endif
+
+#if defined (__ARM_NEON__) || defined (__ARM_NEON)
+ #include <arm_neon.h>
+ #define CASCADE_HAS_NEON_KERNEL 1
+#endif
+
+// Lets a single function use instructions the rest of the binary isn't built for
+#if JUCE_INTEL && ! JUCE_MSVC
+ #define CASCADE_TARGET(isa) __attribute__ ((target (isa)))
+#else
+ #define CASCADE_TARGET(isa)
+#endif
+
+namespace CascadeKernels
+{
+
+// Levels
+//==============================================================================
+// Width lanes of a Levels, held in locals for the length of a kernel's load
+// or store loop so they can stay in registers. Does nothing for nullptr.
+template<int Width>
+struct LevelAccumulator
+{
+    LevelAccumulator(Levels* levelsToUse, int firstLaneToUse) noexcept
+        : levels(levelsToUse), firstLane(firstLaneToUse)
+    {
+        if (levels == nullptr) {
+            return;
+        }
+
+        std::copy(std::begin(levels->shelf), std::end(levels->shelf), shelf);
+        std::copy(std::begin(levels->highPass), std::end(levels->highPass), highPass);
+        for (int lane = 0; lane < Width; lane++) {
+            peak[lane] = levels->peak[firstLane + lane];
+            energy[lane] = levels->energy[firstLane + lane];
+            weightedEnergy[lane] = levels->weightedEnergy[firstLane + lane];
+            for (int k = 0; k < 4; k++) {
+                z[k][lane] = levels->z[k][firstLane + lane];
+            }
+        }
+    }
+
+    // One sample of every lane
+    void add(const float* frame) noexcept
+    {
+        for (int lane = 0; lane < Width; lane++) {
+            auto x = frame[lane];
+            peak[lane] = juce::jmax(peak[lane], std::abs(x));
+            energy[lane] += x * x;
+
+            // K-weighting, transposed direct form II like the sections
+            auto y = shelf[0] * x + z[0][lane];
+            z[0][lane] = shelf[1] * x - shelf[3] * y + z[1][lane];
+            z[1][lane] = shelf[2] * x - shelf[4] * y;
+
+            auto w = highPass[0] * y + z[2][lane];
+            z[2][lane] = highPass[1] * y - highPass[3] * w + z[3][lane];
+            z[3][lane] = highPass[2] * y - highPass[4] * w;
+
+            weightedEnergy[lane] += w * w;
+        }
+    }
+
+    void store() noexcept
+    {
+        if (levels == nullptr) {
+            return;
+        }
+
+        for (int lane = 0; lane < Width; lane++) {
+            levels->peak[firstLane + lane] = peak[lane];
+            levels->energy[firstLane + lane] = energy[lane];
+            levels->weightedEnergy[firstLane + lane] = weightedEnergy[lane];
+            for (int k = 0; k < 4; k++) {
+                levels->z[k][firstLane + lane] = z[k][lane];
+            }
+        }
+    }
+
+    Levels* const levels;
+    const int firstLane;
+    float shelf[5] {}, highPass[5] {};
+    float peak[Width] {}, energy[Width] {}, weightedEnergy[Width] {};
+    float z[4][Width] {};
+};
+
+// Scalar reference
+//==============================================================================
+// The reference meters in loops of its own, one channel at a time; only the
+// vector kernels fold it into their load and store loops
+static void addLevels(Levels* levels, float* const* channels, int numChannels, int numSamples)
+{
+    if (levels == nullptr) {
+        return;
+    }
+
+    for (int ch = 0; ch < numChannels; ch++) {
+        LevelAccumulator<1> accumulator(levels, ch);
+        for (int i = 0; i < numSamples; i++) {
+            accumulator.add(channels[ch] + i);
+        }
+        accumulator.store();
+    }
+}
+
+static void processScalar(Section* sections,
+                          const int* activeSections,
+                          int numActiveSections,
+                          float* const* channels,
+                          int numChannels,
+                          int numSamples,
+                          bool midSide,
+                          float* /*scratch*/,
+                          Levels* inputLevels,
+                          Levels* outputLevels)
+{
+    addLevels(inputLevels, channels, numChannels, numSamples);
+
+    if (midSide) {
+        for (int i = 0; i < numSamples; i++) {
+            auto l = channels[0][i], r = channels[1][i];
+            channels[0][i] = 0.5f * (l + r);
+            channels[1][i] = 0.5f * (l - r);
+        }
+    }
+
+    for (int ch = 0; ch < numChannels; ch++) {
+        auto* data = channels[ch];
+
+        for (int n = 0; n < numActiveSections; n++) {
+            auto& s = sections[activeSections[n]];
+            auto b0 = s.b0[ch], b1 = s.b1[ch], b2 = s.b2[ch], a1 = s.a1[ch], a2 = s.a2[ch];
+            auto z1 = s.z1[ch], z2 = s.z2[ch];
+
+            // Transposed direct form II, same as juce::dsp::IIR::Filter
+            for (int i = 0; i < numSamples; i++) {
+                auto x = data[i];
+                auto y = b0 * x + z1;
+                z1 = b1 * x - a1 * y + z2;
+                z2 = b2 * x - a2 * y;
+                data[i] = y;
+            }
+
+            s.z1[ch] = z1;
+            s.z2[ch] = z2;
+        }
+    }
+
+    if (midSide) {
+        for (int i = 0; i < numSamples; i++) {
+            auto m = channels[0][i], s = channels[1][i];
+            channels[0][i] = m + s;
+            channels[1][i] = m - s;
+        }
+    }
+
+    addLevels(outputLevels, channels, numChannels, numSamples);
+}
+
+// Vector kernels
+//==============================================================================
+// Every vector kernel works the same way: Width channels are interleaved into
+// scratch (metering the input and doing the M/S encode on the way), each
+// section then runs over the whole block with its coefficients and state held
+// in registers, and the result is de-interleaved again (doing the M/S decode
+// and metering the output).
+using RunSectionsFunction = void (*)(Section* sections,
+                                     const int* activeSections,
+                                     int numActiveSections,
+                                     int firstLane,
+                                     float* interleaved,
+                                     int numSamples);
+
+template<int Width, RunSectionsFunction runSections>
+static void processInterleaved(Section* sections,
+                               const int* activeSections,
+                               int numActiveSections,
+                               float* const* channels,
+                               int numChannels,
+                               int numSamples,
+                               bool midSide,
+                               float* scratch,
+                               Levels* inputLevels,
+                               Levels* outputLevels)
+{
+    for (int firstLane = 0; firstLane < numChannels; firstLane += Width) {
+        auto numLanes = juce::jmin(Width, numChannels - firstLane);
+        auto encode = midSide && firstLane == 0;
+
+        // Lanes past numLanes only ever see silence
+        LevelAccumulator<Width> input(inputLevels, firstLane);
+        for (int i = 0; i < numSamples; i++) {
+            auto* frame = scratch + i * Width;
+            for (int lane = 0; lane < Width; lane++) {
+                frame[lane] = lane < numLanes ? channels[firstLane + lane][i] : 0.f;
+            }
+            if (inputLevels != nullptr) {
+                input.add(frame);
+            }
+            if (encode) {
+                auto l = frame[0], r = frame[1];
+                frame[0] = 0.5f * (l + r);
+                frame[1] = 0.5f * (l - r);
+            }
+        }
+
+        input.store();
+
+        runSections(sections, activeSections, numActiveSections, firstLane, scratch, numSamples);
+
+        LevelAccumulator<Width> output(outputLevels, firstLane);
+        for (int i = 0; i < numSamples; i++) {
+            auto* frame = scratch + i * Width;
+            if (encode) {
+                auto m = frame[0], s = frame[1];
+                frame[0] = m + s;
+                frame[1] = m - s;
+            }
+            if (outputLevels != nullptr) {
+                output.add(frame);
+            }
+            for (int lane = 0; lane < numLanes; lane++) {
+                channels[firstLane + lane][i] = frame[lane];
+            }
+        }
+        output.store();
+    }
+}
+
+#if CASCADE_HAS_X86_KERNELS
+CASCADE_TARGET("sse2")
+static void runSectionsSSE2(Section* sections, const int* activeSections, int numActiveSections,
+                            int firstLane, float* interleaved, int numSamples)
+{
+    for (int n = 0; n < numActiveSections; n++) {
+        auto& s = sections[activeSections[n]];
+        auto b0 = _mm_load_ps(s.b0 + firstLane), b1 = _mm_load_ps(s.b1 + firstLane), b2 = _mm_load_ps(s.b2 + firstLane);
+        auto a1 = _mm_load_ps(s.a1 + firstLane), a2 = _mm_load_ps(s.a2 + firstLane);
+        auto z1 = _mm_load_ps(s.z1 + firstLane), z2 = _mm_load_ps(s.z2 + firstLane);
+
+        for (int i = 0; i < numSamples; i++) {
+            auto x = _mm_load_ps(interleaved + i * 4);
+            auto y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+            z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+            z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+            _mm_store_ps(interleaved + i * 4, y);
+        }
+
+        _mm_store_ps(s.z1 + firstLane, z1);
+        _mm_store_ps(s.z2 + firstLane, z2);
+    }
+}
+
+CASCADE_TARGET("avx2,fma")
+static void runSectionsAVX2(Section* sections, const int* activeSections, int numActiveSections,
+                            int firstLane, float* interleaved, int numSamples)
+{
+    for (int n = 0; n < numActiveSections; n++) {
+        auto& s = sections[activeSections[n]];
+        auto b0 = _mm256_load_ps(s.b0 + firstLane), b1 = _mm256_load_ps(s.b1 + firstLane), b2 = _mm256_load_ps(s.b2 + firstLane);
+        auto a1 = _mm256_load_ps(s.a1 + firstLane), a2 = _mm256_load_ps(s.a2 + firstLane);
+        auto z1 = _mm256_load_ps(s.z1 + firstLane), z2 = _mm256_load_ps(s.z2 + firstLane);
+
+        for (int i = 0; i < numSamples; i++) {
+            auto x = _mm256_load_ps(interleaved + i * 8);
+            auto y = _mm256_fmadd_ps(b0, x, z1);
+            z1 = _mm256_add_ps(_mm256_fnmadd_ps(a1, y, _mm256_mul_ps(b1, x)), z2);
+            z2 = _mm256_fnmadd_ps(a2, y, _mm256_mul_ps(b2, x));
+            _mm256_store_ps(interleaved + i * 8, y);
+        }
+
+        _mm256_store_ps(s.z1 + firstLane, z1);
+        _mm256_store_ps(s.z2 + firstLane, z2);
+    }
+}
+
+CASCADE_TARGET("avx512f")
+static void runSectionsAVX512(Section* sections, const int* activeSections, int numActiveSections,
+                              int firstLane, float* interleaved, int numSamples)
+{
+    for (int n = 0; n < numActiveSections; n++) {
+        auto& s = sections[activeSections[n]];
+        auto b0 = _mm512_load_ps(s.b0 + firstLane), b1 = _mm512_load_ps(s.b1 + firstLane), b2 = _mm512_load_ps(s.b2 + firstLane);
+        auto a1 = _mm512_load_ps(s.a1 + firstLane), a2 = _mm512_load_ps(s.a2 + firstLane);
+        auto z1 = _mm512_load_ps(s.z1 + firstLane), z2 = _mm512_load_ps(s.z2 + firstLane);
+
+        for (int i = 0; i < numSamples; i++) {
+            auto x = _mm512_load_ps(interleaved + i * 16);
+            auto y = _mm512_fmadd_ps(b0, x, z1);
+            z1 = _mm512_add_ps(_mm512_fnmadd_ps(a1, y, _mm512_mul_ps(b1, x)), z2);
+            z2 = _mm512_fnmadd_ps(a2, y, _mm512_mul_ps(b2, x));
+            _mm512_store_ps(interleaved + i * 16, y);
+        }
+
+        _mm512_store_ps(s.z1 + firstLane, z1);
+        _mm512_store_ps(s.z2 + firstLane, z2);
+    }
+}
+#endif
+
+#if CASCADE_HAS_NEON_KERNEL
+static void runSectionsNEON(Section* sections, const int* activeSections, int numActiveSections,
+                            int firstLane, float* interleaved, int numSamples)
+{
+    for (int n = 0; n < numActiveSections; n++) {
+        auto& s = sections[activeSections[n]];
+        auto b0 = vld1q_f32(s.b0 + firstLane), b1 = vld1q_f32(s.b1 + firstLane), b2 = vld1q_f32(s.b2 + firstLane);
+        auto a1 = vld1q_f32(s.a1 + firstLane), a2 = vld1q_f32(s.a2 + firstLane);
+        auto z1 = vld1q_f32(s.z1 + firstLane), z2 = vld1q_f32(s.z2 + firstLane);
+
+        for (int i = 0; i < numSamples; i++) {
+            auto x = vld1q_f32(interleaved + i * 4);
+            auto y = vmlaq_f32(z1, b0, x);
+            z1 = vaddq_f32(vmlsq_f32(vmulq_f32(b1, x), a1, y), z2);
+            z2 = vmlsq_f32(vmulq_f32(b2, x), a2, y);
+            vst1q_f32(interleaved + i * 4, y);
+        }
+
+        vst1q_f32(s.z1 + firstLane, z1);
+        vst1q_f32(s.z2 + firstLane, z2);
+    }
+}
+#endif
+
+// Dispatch
+//==============================================================================
+const char* getName(ISA isa)
+{
+    switch (isa) {
+        case ISA::Scalar: return "scalar";
+        case ISA::SSE2:   return "sse2";
+        case ISA::AVX2:   return "avx2";
+        case ISA::AVX512: return "avx512";
+        case ISA::NEON:   return "neon";
+        default: break;
+    }
+    return "";
+}
+
+int getWidth(ISA isa)
+{
+    switch (isa) {
+        case ISA::SSE2:   return 4;
+        case ISA::AVX2:   return 8;
+        case ISA::AVX512: return 16;
+        case ISA::NEON:   return 4;
+        default: break;
+    }
+    return 1;
+}
+
+ProcessFunction getKernel(ISA isa)
+{
+    switch (isa) {
+        case ISA::Scalar: return processScalar;
+       #if CASCADE_HAS_X86_KERNELS
+        case ISA::SSE2:   return processInterleaved<4, runSectionsSSE2>;
+        case ISA::AVX2:   return processInterleaved<8, runSectionsAVX2>;
+        case ISA::AVX512: return processInterleaved<16, runSectionsAVX512>;
+       #endif
+       #if CASCADE_HAS_NEON_KERNEL
+        case ISA::NEON:   return processInterleaved<4, runSectionsNEON>;
+       #endif
+        default: break;
+    }
+    return nullptr;
+}
+
+bool isSupported(ISA isa)
+{
+    if (getKernel(isa) == nullptr) {
+        return false;
+    }
+
+    switch (isa) {
+        case ISA::SSE2:   return juce::SystemStats::hasSSE2();
+        case ISA::AVX2:   return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3();
+        case ISA::AVX512: return juce::SystemStats::hasAVX512F();
+        default: break;
+    }
+    return true;
+}
+
+ISA getBestSupportedISA()
+{
+    for (auto isa : {ISA::AVX512, ISA::AVX2, ISA::SSE2, ISA::NEON}) {
+        if (isSupported(isa)) {
+            return isa;
+        }
+    }
+    return ISA::Scalar;
+}
+
+static ISA chooseStartupISA()
+{
+    auto best = getBestSupportedISA();
+
+    auto requested = juce::SystemStats::getEnvironmentVariable("FIRSTJUCE_CASCADE_ISA", {});
+    if (requested.isNotEmpty()) {
+        for (auto isa : {ISA::Scalar, ISA::SSE2, ISA::AVX2, ISA::AVX512, ISA::NEON}) {
+            if (requested.equalsIgnoreCase(getName(isa))) {
+                if (isSupported(isa)) {
+                    return isa;
+                }
+                DBG("FIRSTJUCE_CASCADE_ISA=" << requested << " is not supported here, using " << getName(best));
+            }
+        }
+    }
+
+    return best;
+}
+
+static std::atomic<ISA>& activeISA()
+{
+    static std::atomic<ISA> isa {chooseStartupISA()};
+    return isa;
+}
+
+ISA getActiveISA()
+{
+    return activeISA().load(std::memory_order_relaxed);
+}
+
+ProcessFunction getActiveKernel()
+{
+    return getKernel(getActiveISA());
+}
+
+void forceISA(ISA isa)
+{
+    jassert(isSupported(isa));
+    if (isSupported(isa)) {
+        activeISA().store(isa, std::memory_order_relaxed);
+    }
+}
+
+// Verification
+//==============================================================================
+float measureErrorAgainstScalar(ISA isa,
+                                const Section* sections,
+                                int numSections,
+                                const float* const* input,
+                                int numChannels,
+                                int numSamples,
+                                bool midSide)
+{
+    constexpr int maxSections = 16;
+    jassert(numSections <= maxSections && numChannels <= maxLanes);
+
+    if (!isSupported(isa) || numSections > maxSections || numChannels > maxLanes) {
+        return 0.f;
+    }
+
+    Section reference[maxSections], test[maxSections];
+    int activeSections[maxSections];
+    for (int n = 0; n < numSections; n++) {
+        reference[n] = test[n] = sections[n];
+        activeSections[n] = n;
+    }
+
+    float referenceFrame[maxLanes], testFrame[maxLanes];
+    float* referenceChannels[maxLanes];
+    float* testChannels[maxLanes];
+    for (int ch = 0; ch < maxLanes; ch++) {
+        referenceChannels[ch] = referenceFrame + ch;
+        testChannels[ch] = testFrame + ch;
+    }
+
+    alignas(64) float scratch[maxLanes];
+    auto scalar = getKernel(ISA::Scalar);
+    auto kernel = getKernel(isa);
+
+    float maxError = 0.f;
+
+    // One sample at a time, both starting from the variant's state, so this
+    // measures one step of the kernel's arithmetic. Over a whole block the
+    // filters themselves would amplify any rounding difference, a low, high-Q
+    // section by orders of magnitude, and hide a subtly wrong kernel behind
+    // a loose tolerance.
+    for (int i = 0; i < numSamples; i++) {
+        // Each channel's error is relative to the largest value in flight for it
+        float scale[maxLanes];
+
+        for (int ch = 0; ch < numChannels; ch++) {
+            referenceFrame[ch] = testFrame[ch] = input[ch][i];
+            scale[ch] = juce::jmax(1.f, std::abs(input[ch][i]));
+        }
+
+        for (int n = 0; n < numSections; n++) {
+            for (int ch = 0; ch < numChannels; ch++) {
+                reference[n].z1[ch] = test[n].z1[ch];
+                reference[n].z2[ch] = test[n].z2[ch];
+                scale[ch] = juce::jmax(scale[ch], std::abs(test[n].z1[ch]), std::abs(test[n].z2[ch]));
+            }
+        }
+
+        scalar(reference, activeSections, numSections, referenceChannels, numChannels, 1, midSide, scratch, nullptr, nullptr);
+        kernel(test, activeSections, numSections, testChannels, numChannels, 1, midSide, scratch, nullptr, nullptr);
+
+        auto addError = [&maxError, &scale](int ch, float expected, float actual) {
+            auto error = std::abs(expected - actual) / (scale[ch] * std::numeric_limits<float>::epsilon());
+            maxError = juce::jmax(maxError, error);
+        };
+
+        for (int ch = 0; ch < numChannels; ch++) {
+            scale[ch] = juce::jmax(scale[ch], std::abs(referenceFrame[ch]));
+        }
+        for (int n = 0; n < numSections; n++) {
+            for (int ch = 0; ch < numChannels; ch++) {
+                scale[ch] = juce::jmax(scale[ch], std::abs(reference[n].z1[ch]), std::abs(reference[n].z2[ch]));
+            }
+        }
+
+        for (int ch = 0; ch < numChannels; ch++) {
+            addError(ch, referenceFrame[ch], testFrame[ch]);
+            for (int n = 0; n < numSections; n++) {
+                addError(ch, reference[n].z1[ch], test[n].z1[ch]);
+                addError(ch, reference[n].z2[ch], test[n].z2[ch]);
+            }
+        }
+    }
+
+    return maxError;
+}
+
+}
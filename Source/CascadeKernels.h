@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    CascadeKernels.h
+
+    The inner loop of FilterCascade, built for several instruction sets inside
+    the one binary. The best variant this CPU supports is picked once, the
+    first time a kernel is asked for; FIRSTJUCE_CASCADE_ISA (scalar, sse2,
+    avx2, avx512 or neon) or forceISA() overrides that for testing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace CascadeKernels
+{
+    // Widest vector we have a kernel for (AVX-512, 16 floats)
+    static constexpr int maxLanes = 16;
+
+    // One biquad for every lane, stored lane-contiguous so a kernel can load
+    // a whole vector of coefficients or state at once
+    struct alignas(64) Section
+    {
+        float b0[maxLanes], b1[maxLanes], b2[maxLanes], a1[maxLanes], a2[maxLanes];
+        float z1[maxLanes], z2[maxLanes];
+    };
+
+    // Levels a kernel adds up, per lane, as it reads its input and as it
+    // writes its output, so metering needs no pass over the block of its own:
+    // the sample peak, the energy, and the energy through the two BS.1770
+    // K-weighting biquads (a high shelf then a high pass, the same for every
+    // lane, state per lane). LevelMeter sets the coefficients, then collects
+    // and clears the sums.
+    struct alignas(64) Levels
+    {
+        float peak[maxLanes], energy[maxLanes], weightedEnergy[maxLanes];
+        float z[4][maxLanes];
+        float shelf[5], highPass[5];
+    };
+
+    enum class ISA
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512,
+        NEON
+    };
+
+    // Runs channels [0, numChannels) in place through the listed sections.
+    // midSide encodes/decodes channels 0 and 1 around the cascade. scratch must
+    // be 64-byte aligned and hold getScratchFloatsNeeded(numSamples) floats.
+    // Levels the channels had on the way in and out are added to inputLevels
+    // and outputLevels, either of which can be nullptr.
+    using ProcessFunction = void (*)(Section* sections,
+                                     const int* activeSections,
+                                     int numActiveSections,
+                                     float* const* channels,
+                                     int numChannels,
+                                     int numSamples,
+                                     bool midSide,
+                                     float* scratch,
+                                     Levels* inputLevels,
+                                     Levels* outputLevels);
+
+    inline size_t getScratchFloatsNeeded(int numSamples) { return (size_t) numSamples * maxLanes; }
+
+    const char* getName(ISA isa);
+    // Number of channels a variant processes per vector
+    int getWidth(ISA isa);
+
+    // Compiled into this binary and supported by this CPU
+    bool isSupported(ISA isa);
+    ISA getBestSupportedISA();
+
+    ISA getActiveISA();
+    ProcessFunction getActiveKernel();
+    ProcessFunction getKernel(ISA isa);
+
+    // Switches every FilterCascade over, e.g. to compare variants. Only call
+    // this while no audio is being processed.
+    void forceISA(ISA isa);
+
+    // Largest difference between a variant and the scalar reference, running
+    // the given sections over the input one sample at a time from the same
+    // state. In units of float epsilon, relative to the largest input, output
+    // or state value of the step (or 1), so SSE2 gives 0 and the FMA variants
+    // a few per section. EngineConformance holds every variant to this.
+    float measureErrorAgainstScalar(ISA isa,
+                                    const Section* sections,
+                                    int numSections,
+                                    const float* const* input,
+                                    int numChannels,
+                                    int numSamples,
+                                    bool midSide);
+}
@@ -0,0 +1,210 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "ChannelWorkerPool.h"
+#include "TraceRecorder.h"
+
+// How long the audio thread busy-waits for the workers before it blocks
+static constexpr int SPIN_COUNT = 2000;
+
+// Work Stealing Deque Code
+//==============================================================================
+void WorkStealingDeque::push(int task) noexcept
+{
+    auto b = bottom.load(std::memory_order_relaxed);
+    jassert(b - top.load(std::memory_order_relaxed) < capacity);
+
+    tasks[b & mask].store(task, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+}
+
+bool WorkStealingDeque::pop(int& task) noexcept
+{
+    auto b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        // Already empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    task = tasks[b & mask].load(std::memory_order_relaxed);
+
+    if (t == b) {
+        // Last task left, race any thieves for it
+        bool won = top.compare_exchange_strong(t, t + 1,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    return true;
+}
+
+bool WorkStealingDeque::steal(int& task) noexcept
+{
+    auto t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b) {
+        return false;
+    }
+
+    task = tasks[t & mask].load(std::memory_order_relaxed);
+    return top.compare_exchange_strong(t, t + 1,
+                                       std::memory_order_seq_cst,
+                                       std::memory_order_relaxed);
+}
+
+// Worker Code
+//==============================================================================
+struct ChannelWorkerPool::Worker : juce::Thread
+{
+    Worker(ChannelWorkerPool& p, int participantIndex) :
+    juce::Thread("Channel Worker " + juce::String(participantIndex)),
+    pool(p), index(participantIndex),
+    seen(p.generation.load(std::memory_order_relaxed))
+    {
+        // seen is taken here rather than in run(), otherwise a thread that is slow
+        // to start could mistake the first block's work as already done
+    }
+
+    void run() override
+    {
+        // Blocks until there's work: run() signals every worker after it bumps
+        // the generation, and release() signals on the way out. The event stays
+        // set if that happens while a worker is still busy, so no wakeup is lost.
+        while (!threadShouldExit()) {
+            auto current = pool.generation.load(std::memory_order_acquire);
+            if (current == seen) {
+                wake.wait(-1);
+                continue;
+            }
+
+            seen = current;
+            pool.runTasks(index);
+            pool.finishParticipant();
+        }
+    }
+
+    ChannelWorkerPool& pool;
+    const int index;
+    juce::uint32 seen;
+    juce::WaitableEvent wake;
+};
+
+// Channel Worker Pool Code
+//==============================================================================
+ChannelWorkerPool::~ChannelWorkerPool()
+{
+    release();
+}
+
+void ChannelWorkerPool::prepare(int numWorkersToUse)
+{
+    numWorkersToUse = juce::jlimit(0, maxParticipants - 1, numWorkersToUse);
+    if (numWorkersToUse == workers.size()) {
+        return;
+    }
+
+    release();
+
+    for (int i = 0; i < numWorkersToUse; i++) {
+        // Participant 0 is always the audio thread
+        auto* worker = workers.add(new Worker(*this, i + 1));
+        worker->startRealtimeThread(juce::Thread::RealtimeOptions{});
+    }
+}
+
+void ChannelWorkerPool::release()
+{
+    for (auto* worker : workers) {
+        worker->signalThreadShouldExit();
+        worker->wake.signal();
+    }
+    for (auto* worker : workers) {
+        worker->stopThread(1000);
+    }
+    workers.clear();
+}
+
+void ChannelWorkerPool::run(int numTasks, TaskFunction function, void* context) noexcept
+{
+    if (workers.isEmpty() || numTasks < 2) {
+        for (int i = 0; i < numTasks; i++) {
+            function(context, i);
+        }
+        return;
+    }
+
+    auto numParticipants = workers.size() + 1;
+    jassert(numTasks <= WorkStealingDeque::capacity * numParticipants);
+
+    currentFunction = function;
+    currentContext = context;
+
+    // Everyone is idle here (the previous run only returned once they all
+    // finished), so it is safe to fill the other participants' deques
+    for (int i = 0; i < numTasks; i++) {
+        deques[i % numParticipants].push(i);
+    }
+
+    allDone.reset();
+    pendingParticipants.store(numParticipants, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+
+    for (auto* worker : workers) {
+        worker->wake.signal();
+    }
+
+    runTasks(0);
+    finishParticipant();
+
+    // Join: spin first, since the workers are usually only moments behind us
+    for (int spin = 0; spin < SPIN_COUNT; spin++) {
+        if (pendingParticipants.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+    // The last one to finish signals allDone. A signal left over from the
+    // previous block only costs one extra check.
+    while (pendingParticipants.load(std::memory_order_acquire) != 0) {
+        allDone.wait(-1);
+    }
+}
+
+void ChannelWorkerPool::runTasks(int participant) noexcept
+{
+    TRACE_SCOPE("runTasks");
+    auto numParticipants = workers.size() + 1;
+    int task;
+
+    while (deques[participant].pop(task)) {
+        currentFunction(currentContext, task);
+    }
+
+    // Own deque is empty, help everyone else out
+    for (int i = 1; i < numParticipants; i++) {
+        auto& victim = deques[(participant + i) % numParticipants];
+        while (victim.steal(task)) {
+            currentFunction(currentContext, task);
+        }
+    }
+}
+
+void ChannelWorkerPool::finishParticipant() noexcept
+{
+    if (pendingParticipants.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        allDone.signal();
+    }
+}
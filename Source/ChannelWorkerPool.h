@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.h
+
+    A small pool of realtime worker threads that shares independent per-channel
+    work with the audio thread. Tasks are spread over one lock-free work-stealing
+    deque per participant; the audio thread takes part in the work itself and
+    joins everyone at the end of the block with spin-then-wait synchronisation.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Fixed capacity Chase-Lev deque of task indices. The owner pushes and pops at
+// the bottom, any other participant steals from the top.
+struct WorkStealingDeque
+{
+    static constexpr int capacity = 128;   // must be a power of two
+
+    void push(int task) noexcept;
+    bool pop(int& task) noexcept;
+    bool steal(int& task) noexcept;
+
+private:
+    static constexpr juce::int64 mask = capacity - 1;
+
+    alignas(64) std::atomic<juce::int64> top {0};
+    alignas(64) std::atomic<juce::int64> bottom {0};
+    std::atomic<int> tasks[capacity] {};
+};
+
+class ChannelWorkerPool
+{
+public:
+    using TaskFunction = void (*)(void* context, int taskIndex);
+
+    // Audio thread plus up to 15 workers
+    static constexpr int maxParticipants = 16;
+
+    ChannelWorkerPool() = default;
+    ~ChannelWorkerPool();
+
+    // Message thread only: (re)starts the worker threads
+    void prepare(int numWorkersToUse);
+    // Message thread only: stops and deletes the worker threads
+    void release();
+
+    int getNumWorkers() const noexcept { return workers.size(); }
+
+    // Audio thread: runs every task in [0, numTasks) exactly once and returns
+    // when all of them have finished. The calling thread takes part.
+    void run(int numTasks, TaskFunction function, void* context) noexcept;
+
+private:
+    struct Worker;
+
+    void runTasks(int participant) noexcept;
+    void finishParticipant() noexcept;
+
+    juce::OwnedArray<Worker> workers;
+    WorkStealingDeque deques[maxParticipants];
+
+    TaskFunction currentFunction = nullptr;
+    void* currentContext = nullptr;
+
+    std::atomic<juce::uint32> generation {0};
+    std::atomic<int> pendingParticipants {0};
+    juce::WaitableEvent allDone;
+
+    JUCE_DECLARE_NON_COPYABLE(ChannelWorkerPool)
+};
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    DynamicPeak.cpp
+
+  ==============================================================================
+*/
+
+#include "DynamicPeak.h"
+
+// Below this the envelope counts as silence
+static constexpr float ENVELOPE_FLOOR_DB = -100.f;
+// ln(10) / 40, so exp(gain * this) is the peak filter's A = 10^(gain / 40)
+static constexpr float DB_TO_LOG_A = 0.0575646273f;
+
+static float getSmoothingCoefficient(float milliseconds, double sampleRate)
+{
+    auto samples = juce::jmax(1.0, milliseconds * 0.001 * sampleRate);
+    return (float) (1.0 - std::exp(-1.0 / samples));
+}
+
+void DynamicPeak::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    // Make the next setSettings() redesign for the new rate
+    designedFrequency = -1.f;
+    designedQuality = -1.f;
+    reset();
+}
+
+void DynamicPeak::reset() noexcept
+{
+    z1 = 0.f;
+    z2 = 0.f;
+    envelope = 0.f;
+    currentGainDb.store(settings.gainDb, std::memory_order_relaxed);
+}
+
+void DynamicPeak::setSettings(const Settings& newSettings) noexcept
+{
+    settings = newSettings;
+    settings.ratio = juce::jmax(1.f, settings.ratio);
+
+    if (settings.frequency != designedFrequency || settings.quality != designedQuality) {
+        designedFrequency = settings.frequency;
+        designedQuality = settings.quality;
+
+        // Same design as juce::dsp::IIR::Coefficients::makePeakFilter
+        auto omega = juce::MathConstants<double>::twoPi * juce::jmax(2.0, (double) settings.frequency) / sampleRate;
+        cosW0 = (float) std::cos(omega);
+        alpha = (float) (std::sin(omega) / (2.0 * settings.quality));
+
+        auto a0 = 1.f + alpha;
+        detectorB0 = alpha / a0;
+        detectorA1 = -2.f * cosW0 / a0;
+        detectorA2 = (1.f - alpha) / a0;
+    }
+
+    attackCoefficient = getSmoothingCoefficient(settings.attackMs, sampleRate);
+    releaseCoefficient = getSmoothingCoefficient(settings.releaseMs, sampleRate);
+}
+
+DynamicPeak::Coefficients DynamicPeak::makePeak(float gainDb) const noexcept
+{
+    if (settings.analogMatched) {
+        auto design = MatchedBiquad::peak(sampleRate, settings.frequency, settings.quality, juce::Decibels::decibelsToGain((double) gainDb));
+        return {(float) design.b0, (float) design.b1, (float) design.b2, (float) design.a1, (float) design.a2};
+    }
+
+    auto A = std::exp(gainDb * DB_TO_LOG_A);
+    auto alphaTimesA = alpha * A;
+    auto alphaOverA = alpha / A;
+    auto scale = 1.f / (1.f + alphaOverA);
+    auto c1 = -2.f * cosW0 * scale;
+
+    return {(1.f + alphaTimesA) * scale, c1, (1.f - alphaTimesA) * scale, c1, (1.f - alphaOverA) * scale};
+}
+
+void DynamicPeak::process(const float* detectorSignal, int numSamples, Coefficients* coefficientsPerSubBlock) noexcept
+{
+    auto slope = 1.f - 1.f / settings.ratio;
+    auto s1 = z1, s2 = z2, env = envelope;
+    auto gainDb = settings.gainDb;
+
+    for (int start = 0, subBlock = 0; start < numSamples; start += subBlockSize, subBlock++) {
+        auto end = juce::jmin(numSamples, start + subBlockSize);
+
+        for (int i = start; i < end; i++) {
+            auto x = detectorSignal[i];
+            auto y = detectorB0 * x + s1;
+            s1 = s2 - detectorA1 * y;
+            s2 = -detectorB0 * x - detectorA2 * y;
+
+            auto level = std::abs(y);
+            env += (level > env ? attackCoefficient : releaseCoefficient) * (level - env);
+        }
+
+        auto overDb = juce::Decibels::gainToDecibels(env, ENVELOPE_FLOOR_DB) - settings.thresholdDb;
+        gainDb = settings.gainDb;
+        if (overDb > 0.f) {
+            gainDb = juce::jmax(minGainDb, gainDb - overDb * slope);
+        }
+
+        coefficientsPerSubBlock[subBlock] = makePeak(gainDb);
+    }
+
+    z1 = s1;
+    z2 = s2;
+    envelope = env;
+    currentGainDb.store(gainDb, std::memory_order_relaxed);
+}
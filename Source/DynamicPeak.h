@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+    DynamicPeak.h
+
+    Turns the Peak band into a dynamic band. A band-pass at the band's own
+    frequency and Q feeds an envelope follower, and every subBlockSize
+    samples the envelope decides how far the band's gain is pulled down
+    from its static setting, compressor style.
+
+    The detector and the peak filter share cos(w0) and alpha, which only
+    change with frequency or Q. A sub-block's new peak coefficients are
+    then one exp and a divide, not a full filter design. An analog-matched
+    band's poles move with its gain, so that one is redesigned in full,
+    which is still only a few transcendentals per sub-block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MatchedBiquad.h"
+
+class DynamicPeak
+{
+public:
+    // The band's gain is recalculated this often
+    static constexpr int subBlockSize = 32;
+    static int getNumSubBlocks(int numSamples) { return (numSamples + subBlockSize - 1) / subBlockSize; }
+
+    // The bottom of the Peak Gain range, the dynamics never go further
+    static constexpr float minGainDb = -24.f;
+
+    struct Settings
+    {
+        bool enabled {false};
+        float frequency {750.f}, quality {1.f}, gainDb {0.f};
+        float thresholdDb {-24.f}, ratio {2.f}, attackMs {10.f}, releaseMs {150.f};
+        // Designs the band with MatchedBiquad instead of the bilinear transform
+        bool analogMatched {false};
+    };
+
+    // Normalised biquad, in the order FilterCascade::updateSection takes them
+    struct Coefficients
+    {
+        float b0, b1, b2, a1, a2;
+    };
+
+    // Message thread, from prepareToPlay
+    void prepare(double sampleRate);
+    void reset() noexcept;
+
+    // Audio thread, whenever the filters are updated
+    void setSettings(const Settings& newSettings) noexcept;
+    bool isEnabled() const noexcept { return settings.enabled; }
+
+    // Audio thread. Follows detectorSignal and writes the peak filter for each of
+    // its getNumSubBlocks(numSamples) sub-blocks.
+    void process(const float* detectorSignal, int numSamples, Coefficients* coefficientsPerSubBlock) noexcept;
+
+    // The band's gain as of the last sub-block, for display. Any thread.
+    float getCurrentGainDb() const noexcept { return currentGainDb.load(std::memory_order_relaxed); }
+
+private:
+    Coefficients makePeak(float gainDb) const noexcept;
+
+    double sampleRate {44100.0};
+    Settings settings;
+
+    // Shared by the detector and the peak filter
+    float cosW0 {1.f}, alpha {0.f};
+    float designedFrequency {-1.f}, designedQuality {-1.f};
+
+    // Constant 0 dB peak band-pass (b1 is 0 and b2 is -b0), transposed direct form II
+    float detectorB0 {0.f}, detectorA1 {0.f}, detectorA2 {0.f};
+    float z1 {0.f}, z2 {0.f};
+
+    float attackCoefficient {1.f}, releaseCoefficient {1.f};
+    float envelope {0.f};
+
+    std::atomic<float> currentGainDb {0.f};
+};
@@ -0,0 +1,249 @@
+/*
+  ==============================================================================
+
+    EditorBenchmark.cpp
+
+  ==============================================================================
+*/
+
+#include "EditorBenchmark.h"
+#include "PluginEditor.h"
+
+#ifndef FIRSTJUCE_COUNT_ALLOCATIONS
+ #define FIRSTJUCE_COUNT_ALLOCATIONS 0
+#endif
+
+// Share of the editor the response curve gets, as in the editor's resized()
+static constexpr float RESPONSE_HEIGHT_RATIO = 0.33f;
+
+#if FIRSTJUCE_COUNT_ALLOCATIONS
+// Per thread, so the LayerCache and spectrogram threads don't count
+static thread_local juce::int64 allocationCount = 0;
+
+void* operator new(std::size_t size)
+{
+    ++allocationCount;
+    if (auto* memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+static juce::int64 getAllocationCount() { return allocationCount; }
+#else
+static juce::int64 getAllocationCount() { return 0; }
+#endif
+
+namespace EditorBenchmark
+{
+
+namespace
+{
+    double microsecondsSince(juce::int64 startTicks)
+    {
+        return 1.0e6 * juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    // What the editor's timers would have done since the last frame
+    void tickTimers(juce::Component& component)
+    {
+        if (auto* timer = dynamic_cast<juce::Timer*>(&component)) {
+            if (timer->isTimerRunning()) {
+                timer->timerCallback();
+            }
+        }
+        for (auto* child : component.getChildren()) {
+            tickTimers(*child);
+        }
+    }
+
+    // The band parameters a user is most likely to drag, all moving at once
+    void setSweep(juce::AudioProcessorValueTreeState& apvts, double phase)
+    {
+        auto set = [&apvts](const juce::String& id, double value) {
+            if (auto* parameter = apvts.getParameter(id)) {
+                parameter->setValueNotifyingHost((float) juce::jlimit(0.0, 1.0, value));
+            }
+        };
+
+        using juce::MathConstants;
+        set("Peak Freq", 0.5 + 0.45 * std::sin(MathConstants<double>::twoPi * phase));
+        set("Peak Gain", 0.5 + 0.4 * std::sin(2.0 * MathConstants<double>::twoPi * phase));
+        set("Peak Quality", 0.3 + 0.2 * std::cos(MathConstants<double>::twoPi * phase));
+        set("LowCut Freq", 0.3 * phase);
+        set("HighCut Freq", 1.0 - 0.3 * phase);
+    }
+
+    juce::int64 countChangedPixels(const juce::Image& a, const juce::Image& b)
+    {
+        juce::Image::BitmapData first(a, juce::Image::BitmapData::readOnly);
+        juce::Image::BitmapData second(b, juce::Image::BitmapData::readOnly);
+
+        juce::int64 changed = 0;
+        for (int y = 0; y < first.height; y++) {
+            auto* rowA = reinterpret_cast<const juce::uint32*>(first.getLinePointer(y));
+            auto* rowB = reinterpret_cast<const juce::uint32*>(second.getLinePointer(y));
+            for (int x = 0; x < first.width; x++) {
+                changed += rowA[x] != rowB[x] ? 1 : 0;
+            }
+        }
+        return changed;
+    }
+
+    Result measure(const juce::String& target, juce::Component& component, juce::AudioProcessorValueTreeState& apvts,
+                   int width, int height, float scaleFactor, int numFrames)
+    {
+        Result result;
+        result.target = target;
+        result.width = width;
+        result.height = height;
+        result.scaleFactor = scaleFactor;
+
+        component.setBounds(0, 0, width, height);
+        auto layoutStart = juce::Time::getHighResolutionTicks();
+        component.resized();
+        result.layoutMicroseconds = microsecondsSince(layoutStart);
+
+        auto pixelWidth = juce::roundToInt(width * scaleFactor);
+        auto pixelHeight = juce::roundToInt(height * scaleFactor);
+        juce::Image image(juce::Image::ARGB, pixelWidth, pixelHeight, true, juce::SoftwareImageType());
+        juce::Image previous;
+
+        std::vector<double> frameMicroseconds;
+        double updateMicroseconds = 0;
+        juce::int64 allocations = 0, changedPixels = 0;
+
+        for (int frame = 0; frame < numFrames; frame++) {
+            auto allocationsBefore = getAllocationCount();
+            auto updateStart = juce::Time::getHighResolutionTicks();
+            setSweep(apvts, (double) frame / (double) numFrames);
+            tickTimers(component);
+            auto update = microsecondsSince(updateStart);
+
+            image.clear(image.getBounds());
+            auto start = juce::Time::getHighResolutionTicks();
+            {
+                juce::Graphics g(image);
+                g.addTransform(juce::AffineTransform::scale(scaleFactor));
+                component.paintEntireComponent(g, true);
+            }
+            auto microseconds = microsecondsSince(start);
+
+            if (frame == 0) {
+                result.firstFrameMicroseconds = microseconds;
+            } else {
+                frameMicroseconds.push_back(microseconds);
+                updateMicroseconds += update;
+                result.maxUpdateMicroseconds = juce::jmax(result.maxUpdateMicroseconds, update);
+                // The image clear doesn't allocate, so this is the component's alone
+                allocations += getAllocationCount() - allocationsBefore;
+                changedPixels += countChangedPixels(image, previous);
+            }
+            previous = image.createCopy();
+        }
+
+        if (!frameMicroseconds.empty()) {
+            auto numMeasured = (double) frameMicroseconds.size();
+            result.meanMicroseconds = std::accumulate(frameMicroseconds.begin(), frameMicroseconds.end(), 0.0) / numMeasured;
+            std::sort(frameMicroseconds.begin(), frameMicroseconds.end());
+            result.p99Microseconds = frameMicroseconds[(size_t) juce::jmin(numMeasured - 1.0, std::ceil(0.99 * numMeasured) - 1.0)];
+            result.maxMicroseconds = frameMicroseconds.back();
+            result.meanUpdateMicroseconds = updateMicroseconds / numMeasured;
+            result.changedPixelsPerFrame = (double) changedPixels / numMeasured;
+           #if FIRSTJUCE_COUNT_ALLOCATIONS
+            result.allocationsPerFrame = (double) allocations / numMeasured;
+           #else
+            juce::ignoreUnused(allocations);
+           #endif
+        }
+        result.pixelsPerFrame = (double) pixelWidth * (double) pixelHeight;
+
+        return result;
+    }
+}
+
+Report run(const Options& options)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    Report report;
+
+    for (auto size : options.editorSizes) {
+        for (auto scaleFactor : options.scaleFactors) {
+            // New components for every case, so the first frame is a real
+            // first frame with every cache empty
+            {
+                FirstJUCEpluginAudioProcessor processor;
+                ResponseCurveComponent curve(processor);
+                report.results.add(measure("ResponseCurveComponent", curve, processor.apvts,
+                                           size.x, juce::roundToInt(size.y * RESPONSE_HEIGHT_RATIO),
+                                           scaleFactor, options.numFrames));
+            }
+            {
+                FirstJUCEpluginAudioProcessor processor;
+                RotarySliderWithLabels slider(*processor.apvts.getParameter("Peak Freq"), "Hz");
+                slider.labels.add({0.f, "20Hz"});
+                slider.labels.add({1.f, "20kHz"});
+                juce::AudioProcessorValueTreeState::SliderAttachment attachment(processor.apvts, "Peak Freq", slider);
+                report.results.add(measure("RotarySliderWithLabels", slider, processor.apvts,
+                                           size.x / 3, size.y / 5, scaleFactor, options.numFrames));
+            }
+            {
+                FirstJUCEpluginAudioProcessor processor;
+                std::unique_ptr<juce::AudioProcessorEditor> editor(processor.createEditor());
+                report.results.add(measure("Editor", *editor, processor.apvts,
+                                           size.x, size.y, scaleFactor, options.numFrames));
+            }
+        }
+    }
+
+    return report;
+}
+
+juce::String Report::toString() const
+{
+    juce::String text;
+
+    for (auto& result : results) {
+        text << result.target.paddedRight(' ', 24)
+             << (juce::String(result.width) + "x" + juce::String(result.height) + " @" + juce::String(result.scaleFactor, 1)).paddedRight(' ', 16)
+             << "layout " << juce::String(result.layoutMicroseconds, 0) << " us  "
+             << "first " << juce::String(result.firstFrameMicroseconds, 0) << " us  "
+             << "mean " << juce::String(result.meanMicroseconds, 0) << " us  "
+             << "p99 " << juce::String(result.p99Microseconds, 0) << " us  "
+             << "max " << juce::String(result.maxMicroseconds, 0) << " us  "
+             << "update " << juce::String(result.meanUpdateMicroseconds, 0) << " us (max "
+             << juce::String(result.maxUpdateMicroseconds, 0) << ")  ";
+
+        if (result.allocationsPerFrame >= 0) {
+            text << juce::String(result.allocationsPerFrame, 1) << " allocs/frame  ";
+        }
+
+        auto changedPercent = result.pixelsPerFrame > 0 ? 100.0 * result.changedPixelsPerFrame / result.pixelsPerFrame : 0.0;
+        text << juce::String(result.pixelsPerFrame / 1.0e6, 2) << " Mpx/frame, "
+             << juce::String(changedPercent, 1) << "% changed" << juce::newLine;
+    }
+
+    return text;
+}
+
+bool Report::writeCsv(const juce::File& file) const
+{
+    juce::String csv;
+    csv << "target,width,height,scale,layout_us,first_us,mean_us,p99_us,max_us,update_mean_us,update_max_us,allocs_per_frame,pixels_per_frame,changed_pixels_per_frame" << juce::newLine;
+
+    for (auto& result : results) {
+        csv << result.target << "," << result.width << "," << result.height << "," << result.scaleFactor << ","
+            << result.layoutMicroseconds << "," << result.firstFrameMicroseconds << ","
+            << result.meanMicroseconds << "," << result.p99Microseconds << "," << result.maxMicroseconds << ","
+            << result.meanUpdateMicroseconds << "," << result.maxUpdateMicroseconds << ","
+            << result.allocationsPerFrame << "," << result.pixelsPerFrame << "," << result.changedPixelsPerFrame << juce::newLine;
+    }
+
+    return file.replaceWithText(csv);
+}
+
+}
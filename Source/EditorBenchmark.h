@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    EditorBenchmark.h
+
+    Measures what the GUI costs, so a slow paint() or resized() shows up
+    before users notice a sluggish host. ResponseCurveComponent, a
+    RotarySliderWithLabels and the whole editor are rendered offscreen,
+    with JUCE's software renderer into an Image, at several sizes and
+    display scales while the band parameters sweep. Every frame's update
+    (parameter listeners and timer callbacks) and paint are timed apart,
+    and so is each layout.
+
+    Nothing goes near a window or the host: the components are never put on
+    the desktop, and they run against a processor of their own, so a sweep
+    can't change what an open session sounds like. Like EngineConformance
+    it can be called from a debugger, and the harness's editor-bench
+    command runs it from the terminal.
+
+    Allocations are only counted in builds with FIRSTJUCE_COUNT_ALLOCATIONS=1,
+    which replaces the global operator new, so never ship one of those. The
+    harness is built with it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace EditorBenchmark
+{
+    struct Options
+    {
+        // Editor sizes; the curve and the slider get their share of each,
+        // as the editor's layout would give them
+        juce::Array<juce::Point<int>> editorSizes {{600, 450}, {800, 600}, {1200, 900}, {1600, 1200}};
+        juce::Array<float> scaleFactors {1.f, 2.f};
+        // Frames per size and scale. The first one is reported on its own,
+        // since that's where every LayerCache renders.
+        int numFrames {120};
+    };
+
+    struct Result
+    {
+        juce::String target;
+        int width {0}, height {0};
+        float scaleFactor {1.f};
+
+        double layoutMicroseconds {0};
+        double firstFrameMicroseconds {0};
+        // Painting the frames after the first
+        double meanMicroseconds {0}, p99Microseconds {0}, maxMicroseconds {0};
+        // Everything before each of those paints: the parameter changes
+        // reaching the component's listeners and its timer callbacks
+        double meanUpdateMicroseconds {0}, maxUpdateMicroseconds {0};
+        // Over update and paint together, -1 unless built with FIRSTJUCE_COUNT_ALLOCATIONS
+        double allocationsPerFrame {-1};
+        // Physical pixels painted per frame, and how many of them changed
+        // from the frame before, which is what a finer repaint could save
+        double pixelsPerFrame {0}, changedPixelsPerFrame {0};
+    };
+
+    struct Report
+    {
+        juce::Array<Result> results;
+
+        juce::String toString() const;
+        bool writeCsv(const juce::File& file) const;
+    };
+
+    // Message thread. Takes a second or two with the default options.
+    Report run(const Options& options = {});
+}
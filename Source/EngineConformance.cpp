@@ -0,0 +1,687 @@
+/*
+  ==============================================================================
+
+    EngineConformance.cpp
+
+  ==============================================================================
+*/
+
+#include "EngineConformance.h"
+
+namespace EngineConformance
+{
+
+// Reference Code
+//==============================================================================
+// The same designs as the plugin, but in double precision all the way through
+struct ReferenceChain
+{
+    using DoubleFilter = juce::dsp::IIR::Filter<double>;
+    using DoubleCoefficients = juce::dsp::IIR::Coefficients<double>;
+
+    ReferenceChain(const ChainSettings& settings, double sampleRate)
+    {
+        filters.reserve(9);
+
+        // MatchedBiquad designs in double already, the plugin only rounds them to float
+        if (settings.filterDesign == Design_AnalogMatched) {
+            auto lowCutOrder = 2 * (settings.lowCutSlope + 1);
+            for (int i = 0; i <= settings.lowCutSlope; i++) {
+                add(MatchedBiquad::highPass(sampleRate, settings.lowCutFreq, MatchedBiquad::getButterworthQuality(i, lowCutOrder)));
+            }
+            add(MatchedBiquad::peak(sampleRate,
+                                    settings.peakFreq,
+                                    settings.peakQuality,
+                                    juce::Decibels::decibelsToGain((double) settings.peakGainInDecibels)));
+            auto highCutOrder = 2 * (settings.highCutSlope + 1);
+            for (int i = 0; i <= settings.highCutSlope; i++) {
+                add(MatchedBiquad::lowPass(sampleRate, settings.highCutFreq, MatchedBiquad::getButterworthQuality(i, highCutOrder)));
+            }
+            return;
+        }
+
+        auto lowCut = juce::dsp::FilterDesign<double>::designIIRHighpassHighOrderButterworthMethod(
+            settings.lowCutFreq, sampleRate, 2 * (settings.lowCutSlope + 1));
+        auto highCut = juce::dsp::FilterDesign<double>::designIIRLowpassHighOrderButterworthMethod(
+            settings.highCutFreq, sampleRate, 2 * (settings.highCutSlope + 1));
+
+        for (int i = 0; i <= settings.lowCutSlope; i++) {
+            add(lowCut[i]);
+        }
+        add(DoubleCoefficients::makePeakFilter(sampleRate,
+                                               settings.peakFreq,
+                                               settings.peakQuality,
+                                               juce::Decibels::decibelsToGain((double) settings.peakGainInDecibels)));
+        for (int i = 0; i <= settings.highCutSlope; i++) {
+            add(highCut[i]);
+        }
+    }
+
+    void add(DoubleCoefficients::Ptr coefficients)
+    {
+        auto& filter = filters.emplace_back();
+        filter.coefficients = coefficients;
+        filter.reset();
+    }
+
+    void add(const MatchedBiquad::Design& design)
+    {
+        add(new DoubleCoefficients(design.b0, design.b1, design.b2, 1.0, design.a1, design.a2));
+    }
+
+    void reset()
+    {
+        for (auto& filter : filters) {
+            filter.reset();
+        }
+    }
+
+    double processSample(double x)
+    {
+        for (auto& filter : filters) {
+            x = filter.processSample(x);
+        }
+        return x;
+    }
+
+    std::vector<DoubleFilter> filters;
+};
+
+// Engine Code
+//==============================================================================
+// Anything that can run the chain. New engines only need adding to makeEngines()
+struct Engine
+{
+    virtual ~Engine() = default;
+
+    virtual juce::String getName() const = 0;
+    // Channels it runs at once, which is how it's timed
+    virtual int getNumChannels() const = 0;
+
+    // Sets every channel to these settings and clears the filter state
+    virtual void prepare(const ChainSettings& settings, double sampleRate, int blockSize) = 0;
+    virtual void process(float* const* channels, int numSamples) = 0;
+};
+
+struct MonoChainEngine : Engine
+{
+    juce::String getName() const override { return "MonoChain"; }
+    int getNumChannels() const override { return 1; }
+
+    void prepare(const ChainSettings& settings, double sampleRate, int blockSize) override
+    {
+        juce::dsp::ProcessSpec spec;
+        spec.sampleRate = sampleRate;
+        spec.maximumBlockSize = (juce::uint32) blockSize;
+        spec.numChannels = 1;
+        chain.prepare(spec);
+
+        // juce::dsp's own designs, as the editor's response curve has them.
+        // The cascades are held to this, so it stays independent of BandDesign.
+        updateCoefficients(chain.get<ChainPositions::Peak>().coefficients, makePeakFilter(settings, sampleRate));
+        updateCutFilter(chain.get<ChainPositions::LowCut>(), makeLowCutFilter(settings, sampleRate), settings.lowCutSlope);
+        updateCutFilter(chain.get<ChainPositions::HighCut>(), makeHighCutFilter(settings, sampleRate), settings.highCutSlope);
+
+        chain.reset();
+    }
+
+    void process(float* const* channels, int numSamples) override
+    {
+        juce::dsp::AudioBlock<float> block(channels, 1, (size_t) numSamples);
+        chain.process(juce::dsp::ProcessContextReplacing<float>(block));
+    }
+
+    MonoChain chain;
+};
+
+struct CascadeEngine : Engine
+{
+    explicit CascadeEngine(CascadeKernels::ISA isaToUse)
+        : isa(isaToUse),
+          kernel(CascadeKernels::getKernel(isaToUse)),
+          numChannels(juce::jlimit(4, FilterCascade::maxLanes, CascadeKernels::getWidth(isaToUse)))
+    {
+    }
+
+    juce::String getName() const override { return juce::String("FilterCascade ") + CascadeKernels::getName(isa); }
+    int getNumChannels() const override { return numChannels; }
+
+    void prepare(const ChainSettings& settings, double sampleRate, int blockSize) override
+    {
+        // Exactly as the processor's updateBands sets its cascades up
+        auto bands = BandDesign::design(settings, sampleRate);
+        for (int lane = 0; lane < numChannels; lane++) {
+            cascade.setBands(lane, bands);
+        }
+
+        cascade.reset();
+
+        auto floatsNeeded = CascadeKernels::getScratchFloatsNeeded(blockSize) + 16;
+        if (scratchSize < floatsNeeded) {
+            storage.allocate(floatsNeeded, false);
+            scratchSize = floatsNeeded;
+        }
+    }
+
+    void process(float* const* channels, int numSamples) override
+    {
+        auto* scratch = juce::snapPointerToAlignment(storage.get(), (size_t) 64);
+        cascade.process(channels, numChannels, numSamples, false, scratch, kernel);
+    }
+
+    CascadeKernels::ISA isa;
+    CascadeKernels::ProcessFunction kernel;
+    int numChannels;
+
+    FilterCascade cascade;
+    juce::HeapBlock<float> storage;
+    size_t scratchSize {0};
+};
+
+static std::vector<std::unique_ptr<Engine>> makeEngines()
+{
+    std::vector<std::unique_ptr<Engine>> engines;
+
+    // MonoChain first, it's the baseline the others are held to
+    engines.push_back(std::make_unique<MonoChainEngine>());
+
+    using CascadeKernels::ISA;
+    for (auto isa : {ISA::Scalar, ISA::SSE2, ISA::AVX2, ISA::AVX512, ISA::NEON}) {
+        if (CascadeKernels::isSupported(isa)) {
+            engines.push_back(std::make_unique<CascadeEngine>(isa));
+        }
+    }
+
+    return engines;
+}
+
+// Sweep Code
+//==============================================================================
+struct Case
+{
+    ChainSettings settings;
+    juce::String description;
+};
+
+static juce::Array<Case> makeCases(double sampleRate, const Options& options)
+{
+    // Parameter defaults from createParameterLayout; each case moves one band
+    ChainSettings defaults;
+    defaults.lowCutFreq = MIN_FREQ;
+    defaults.highCutFreq = MAX_FREQ;
+    defaults.peakFreq = 750.f;
+    defaults.peakGainInDecibels = 0.f;
+    defaults.peakQuality = 1.f;
+
+    juce::Array<float> frequencies;
+    auto steps = juce::jmax(2, options.frequencySteps);
+    for (int i = 0; i < steps; i++) {
+        auto frequency = MIN_FREQ * std::pow(MAX_FREQ / MIN_FREQ, (float) i / (float) (steps - 1));
+        // Stay clear of Nyquist at rates below 44.1 kHz
+        frequencies.add(juce::jmin(frequency, (float) (0.45 * sampleRate)));
+    }
+
+    juce::Array<float> gains {MIN_GAIN, -12.f, -3.f, 3.f, 12.f, MAX_GAIN};
+    juce::Array<float> qualities {0.1f, 0.5f, 1.f, 3.f, 10.f};
+    if (options.quickGainAndQuality) {
+        gains = {MIN_GAIN, MAX_GAIN};
+        qualities = {0.1f, 10.f};
+    }
+
+    juce::Array<Case> cases;
+
+    for (auto design : options.designs) {
+        defaults.filterDesign = design;
+        juce::String suffix = design == Design_AnalogMatched ? " matched" : "";
+
+        for (auto frequency : frequencies) {
+            for (auto slope : {Slope_12, Slope_24, Slope_36, Slope_48}) {
+                auto lowCut = defaults;
+                lowCut.lowCutFreq = frequency;
+                lowCut.lowCutSlope = slope;
+                cases.add({lowCut, "LowCut " + juce::String(frequency, 1) + " Hz " + juce::String(12 * (slope + 1)) + " dB/Oct" + suffix});
+
+                auto highCut = defaults;
+                highCut.highCutFreq = frequency;
+                highCut.highCutSlope = slope;
+                cases.add({highCut, "HighCut " + juce::String(frequency, 1) + " Hz " + juce::String(12 * (slope + 1)) + " dB/Oct" + suffix});
+            }
+
+            for (auto gain : gains) {
+                for (auto quality : qualities) {
+                    auto peak = defaults;
+                    peak.peakFreq = frequency;
+                    peak.peakGainInDecibels = gain;
+                    peak.peakQuality = quality;
+                    cases.add({peak, "Peak " + juce::String(frequency, 1) + " Hz " + juce::String(gain, 1) + " dB Q " + juce::String(quality, 2) + suffix});
+                }
+            }
+        }
+    }
+
+    return cases;
+}
+
+// Everything measured for one engine on one case, in dB
+struct Measurement
+{
+    double impulseErrorDb, magnitudeErrorDb, noiseFloorDb;
+    juce::int64 ticks;
+};
+
+static double powerRatioToDecibels(double ratio)
+{
+    return 10.0 * std::log10(juce::jmax(ratio, 1.0e-40));
+}
+
+class Sweep
+{
+public:
+    Sweep(double rate, const Options& optionsToUse)
+        : sampleRate(rate),
+          options(optionsToUse),
+          // Long enough for a 20 Hz, 48 dB/Oct cut to ring down most of the way
+          fftOrder(juce::jmax(12, (int) std::ceil(std::log2(sampleRate / 4.0)))),
+          length(1 << fftOrder),
+          noiseLength(juce::jmax(8192, length / 4)),
+          fft(fftOrder),
+          buffer(FilterCascade::maxLanes, length),
+          spectrum((size_t) 2 * (size_t) length),
+          referenceImpulse((size_t) length),
+          referenceSpectrum((size_t) length),
+          noise((size_t) noiseLength),
+          referenceNoise((size_t) noiseLength)
+    {
+        juce::Random random(0x5eed);
+        for (auto& x : noise) {
+            x = random.nextFloat() - 0.5f;
+        }
+    }
+
+    void prepareReference(const ChainSettings& settings)
+    {
+        ReferenceChain reference(settings, sampleRate);
+
+        for (int i = 0; i < length; i++) {
+            referenceImpulse[(size_t) i] = reference.processSample(i == 0 ? 1.0 : 0.0);
+        }
+
+        std::copy(referenceImpulse.begin(), referenceImpulse.end(), spectrum.begin());
+        std::fill(spectrum.begin() + length, spectrum.end(), 0.f);
+        fft.performFrequencyOnlyForwardTransform(spectrum.data());
+        std::copy(spectrum.begin(), spectrum.begin() + length, referenceSpectrum.begin());
+
+        reference.reset();
+        for (int i = 0; i < noiseLength; i++) {
+            referenceNoise[(size_t) i] = reference.processSample((double) noise[(size_t) i]);
+        }
+    }
+
+    Measurement measure(Engine& engine, const ChainSettings& settings)
+    {
+        Measurement m;
+        auto numChannels = engine.getNumChannels();
+
+        // Impulse response, in blocks
+        engine.prepare(settings, sampleRate, options.blockSize);
+        buffer.clear();
+        for (int ch = 0; ch < numChannels; ch++) {
+            buffer.setSample(ch, 0, 1.f);
+        }
+        processInBlocks(engine, length);
+
+        double errorEnergy = 0, referenceEnergy = 0;
+        auto* impulse = buffer.getReadPointer(0);
+        for (int i = 0; i < length; i++) {
+            auto difference = (double) impulse[i] - referenceImpulse[(size_t) i];
+            errorEnergy += difference * difference;
+            referenceEnergy += referenceImpulse[(size_t) i] * referenceImpulse[(size_t) i];
+        }
+        m.impulseErrorDb = powerRatioToDecibels(errorEnergy / referenceEnergy);
+
+        // Magnitude response over the audible range, from the same impulse
+        // responses so truncation doesn't count against the engine
+        std::copy(impulse, impulse + length, spectrum.begin());
+        std::fill(spectrum.begin() + length, spectrum.end(), 0.f);
+        fft.performFrequencyOnlyForwardTransform(spectrum.data());
+
+        m.magnitudeErrorDb = 0;
+        auto firstBin = (int) std::ceil(MIN_FREQ * length / sampleRate);
+        auto lastBin = juce::jmin(length / 2, (int) (MAX_FREQ * length / sampleRate));
+        for (int bin = firstBin; bin <= lastBin; bin++) {
+            auto referenceDb = juce::Decibels::gainToDecibels(referenceSpectrum[(size_t) bin], -400.f);
+            if (referenceDb < options.tolerances.magnitudeFloorDb) {
+                continue;
+            }
+            auto engineDb = juce::Decibels::gainToDecibels(spectrum[(size_t) bin], -400.f);
+            m.magnitudeErrorDb = juce::jmax(m.magnitudeErrorDb, (double) std::abs(engineDb - referenceDb));
+        }
+
+        // Noise floor on a full-band signal, which is also what gets timed
+        engine.prepare(settings, sampleRate, options.blockSize);
+        for (int ch = 0; ch < numChannels; ch++) {
+            buffer.copyFrom(ch, 0, noise.data(), noiseLength);
+        }
+        auto start = juce::Time::getHighResolutionTicks();
+        processInBlocks(engine, noiseLength);
+        m.ticks = juce::Time::getHighResolutionTicks() - start;
+
+        errorEnergy = 0;
+        auto* output = buffer.getReadPointer(0);
+        for (int i = 0; i < noiseLength; i++) {
+            auto difference = (double) output[i] - referenceNoise[(size_t) i];
+            errorEnergy += difference * difference;
+        }
+        m.noiseFloorDb = powerRatioToDecibels(errorEnergy / noiseLength);
+
+        return m;
+    }
+
+    int getNoiseLength() const { return noiseLength; }
+
+private:
+    void processInBlocks(Engine& engine, int numSamples)
+    {
+        float* channels[FilterCascade::maxLanes];
+
+        for (int start = 0; start < numSamples; start += options.blockSize) {
+            auto blockLength = juce::jmin(options.blockSize, numSamples - start);
+            for (int ch = 0; ch < engine.getNumChannels(); ch++) {
+                channels[ch] = buffer.getWritePointer(ch, start);
+            }
+            engine.process(channels, blockLength);
+        }
+    }
+
+    double sampleRate;
+    const Options& options;
+    int fftOrder, length, noiseLength;
+
+    juce::dsp::FFT fft;
+    juce::AudioBuffer<float> buffer;
+    std::vector<float> spectrum;
+
+    std::vector<double> referenceImpulse;
+    std::vector<float> referenceSpectrum;
+    std::vector<float> noise;
+    std::vector<double> referenceNoise;
+};
+
+// Kernel Code
+//==============================================================================
+// Every vector kernel against the scalar one on the plugin's own designs.
+// Each case gets a lane, so one cascade holds maxLanes of them.
+static KernelResult checkKernel(CascadeKernels::ISA isa, double sampleRate, const juce::Array<Case>& cases, const Tolerances& tolerances)
+{
+    constexpr int numSamples = 1024;
+    constexpr int maxLanes = FilterCascade::maxLanes;
+
+    KernelResult result;
+    result.kernel = CascadeKernels::getName(isa);
+    result.sampleRate = sampleRate;
+    // Sections a lane doesn't use pass the signal through exactly, so every
+    // section counts towards the depth
+    result.toleranceEpsilons = tolerances.kernelEpsilonsPerSection * FilterCascade::maxSections;
+
+    juce::AudioBuffer<float> input(maxLanes, numSamples);
+    juce::Random random(0x5eed);
+    for (int ch = 0; ch < maxLanes; ch++) {
+        for (int i = 0; i < numSamples; i++) {
+            input.setSample(ch, i, random.nextFloat() - 0.5f);
+        }
+    }
+
+    for (int first = 0; first < cases.size(); first += maxLanes) {
+        auto numLanes = juce::jmin(maxLanes, cases.size() - first);
+
+        FilterCascade cascade;
+        for (int lane = 0; lane < numLanes; lane++) {
+            cascade.setBands(lane, BandDesign::design(cases.getReference(first + lane).settings, sampleRate));
+        }
+
+        // The first two lanes in M/S as well, the encode/decode is part of the kernel
+        for (auto midSide : {false, true}) {
+            if (midSide && numLanes < 2) {
+                continue;
+            }
+
+            auto numChannels = midSide ? 2 : numLanes;
+            auto error = (double) CascadeKernels::measureErrorAgainstScalar(isa, cascade.getSections(), FilterCascade::maxSections,
+                                                                            input.getArrayOfReadPointers(), numChannels, numSamples, midSide);
+            if (error > result.errorEpsilons) {
+                result.errorEpsilons = error;
+                result.worstCase = "cases " + cases.getReference(first).description + " to "
+                                 + cases.getReference(first + numChannels - 1).description + (midSide ? " in M/S" : "");
+            }
+        }
+
+        result.numCases += numLanes;
+    }
+
+    return result;
+}
+
+// Analog Code
+//==============================================================================
+// The analog-matched Peak against its analog prototype where bilinear is
+// furthest off, high up, boosted and cut, wide to narrow. The designs are
+// BandDesign's, in double, so this is the design alone and not the engines.
+static AnalogResult checkAnalog(double sampleRate, const Tolerances& tolerances)
+{
+    constexpr int numPoints = 2000;
+
+    AnalogResult result;
+    result.sampleRate = sampleRate;
+    result.toleranceDb = tolerances.analogMatchedPeakErrorDb;
+    result.bilinearMinErrorDb = std::numeric_limits<double>::max();
+
+    auto top = juce::jmin((double) MAX_FREQ, 0.49 * sampleRate);
+
+    auto digitalDb = [sampleRate](const BandDesign::Biquad& biquad, double frequency) {
+        auto z = std::polar(1.0, -juce::MathConstants<double>::twoPi * frequency / sampleRate);
+        auto numerator = biquad.b0 + (biquad.b1 + biquad.b2 * z) * z;
+        auto denominator = 1.0 + (biquad.a1 + biquad.a2 * z) * z;
+        return 20.0 * std::log10(std::abs(numerator / denominator));
+    };
+
+    // makePeakFilter's prototype, (s^2 + s A / Q + 1) / (s^2 + s / (A Q) + 1)
+    auto analogDb = [](double frequency, double centre, double quality, double A) {
+        std::complex<double> s(0.0, frequency / centre);
+        return 20.0 * std::log10(std::abs((s * s + s * A / quality + 1.0) / (s * s + s / (A * quality) + 1.0)));
+    };
+
+    for (auto frequency : {10000.f, 16000.f}) {
+        if (frequency >= 0.45 * sampleRate) {
+            continue;
+        }
+
+        for (auto gain : {-12.f, 12.f}) {
+            for (auto quality : {0.5f, 2.f, 8.f}) {
+                ChainSettings settings;
+                settings.peakFreq = frequency;
+                settings.peakGainInDecibels = gain;
+                settings.peakQuality = quality;
+
+                settings.filterDesign = Design_AnalogMatched;
+                auto matched = BandDesign::designPeak(settings, sampleRate);
+                settings.filterDesign = Design_Bilinear;
+                auto bilinear = BandDesign::designPeak(settings, sampleRate);
+
+                auto A = std::sqrt(juce::Decibels::decibelsToGain((double) gain));
+                double matchedError = 0, bilinearError = 0;
+
+                for (int i = 0; i < numPoints; i++) {
+                    auto f = MIN_FREQ * std::pow(top / MIN_FREQ, (double) i / (numPoints - 1));
+                    auto analog = analogDb(f, frequency, quality, A);
+                    matchedError = juce::jmax(matchedError, std::abs(digitalDb(matched, f) - analog));
+                    bilinearError = juce::jmax(bilinearError, std::abs(digitalDb(bilinear, f) - analog));
+                }
+
+                result.numCases++;
+                result.bilinearMinErrorDb = juce::jmin(result.bilinearMinErrorDb, bilinearError);
+                result.bilinearMaxErrorDb = juce::jmax(result.bilinearMaxErrorDb, bilinearError);
+                if (matchedError >= bilinearError) {
+                    result.numNotBetter++;
+                }
+                if (matchedError > result.matchedErrorDb) {
+                    result.matchedErrorDb = matchedError;
+                    result.worstCase = "Peak " + juce::String(frequency, 1) + " Hz " + juce::String(gain, 1) + " dB Q " + juce::String(quality, 2);
+                }
+            }
+        }
+    }
+
+    if (result.numCases == 0) {
+        result.bilinearMinErrorDb = 0;
+    }
+    return result;
+}
+
+// Report Code
+//==============================================================================
+Report run(const Options& options)
+{
+    Report report;
+    auto engines = makeEngines();
+    const auto& tolerances = options.tolerances;
+
+    for (auto sampleRate : options.sampleRates) {
+        Sweep sweep(sampleRate, options);
+        auto cases = makeCases(sampleRate, options);
+
+        std::vector<EngineResult> results(engines.size());
+        std::vector<juce::int64> ticks(engines.size(), 0);
+        for (size_t e = 0; e < engines.size(); e++) {
+            results[e].engine = engines[e]->getName();
+            results[e].isBaseline = e == 0;
+            results[e].sampleRate = sampleRate;
+        }
+
+        for (const auto& c : cases) {
+            sweep.prepareReference(c.settings);
+
+            Measurement baseline {};
+
+            for (size_t e = 0; e < engines.size(); e++) {
+                auto m = sweep.measure(*engines[e], c.settings);
+                if (e == 0) {
+                    baseline = m;
+                }
+
+                auto& result = results[e];
+                result.numCases++;
+                result.impulseErrorDb = juce::jmax(result.impulseErrorDb, m.impulseErrorDb);
+                result.magnitudeErrorDb = juce::jmax(result.magnitudeErrorDb, m.magnitudeErrorDb);
+                result.noiseFloorDb = juce::jmax(result.noiseFloorDb, m.noiseFloorDb);
+                ticks[e] += m.ticks;
+
+                // The baseline is only held to the absolute limits
+                auto exceeds = [isBaseline = result.isBaseline](double value, double limit, double baselineValue, double margin) {
+                    return value > limit && (isBaseline || value > baselineValue + margin);
+                };
+
+                auto failed = exceeds(m.impulseErrorDb, tolerances.impulseErrorDb, baseline.impulseErrorDb, tolerances.baselineMarginDb)
+                           || exceeds(m.magnitudeErrorDb, tolerances.magnitudeErrorDb, baseline.magnitudeErrorDb, tolerances.baselineMagnitudeMarginDb)
+                           || exceeds(m.noiseFloorDb, tolerances.noiseFloorDb, baseline.noiseFloorDb, tolerances.baselineMarginDb);
+
+                if (failed) {
+                    result.numFailures++;
+                    if (result.firstFailure.isEmpty()) {
+                        result.firstFailure = c.description;
+                    }
+                }
+            }
+        }
+
+        for (size_t e = 0; e < engines.size(); e++) {
+            auto seconds = juce::Time::highResolutionTicksToSeconds(ticks[e]);
+            auto samples = (double) cases.size() * sweep.getNoiseLength() * engines[e]->getNumChannels();
+            results[e].nanosecondsPerSample = samples > 0 ? 1.0e9 * seconds / samples : 0.0;
+            report.results.add(results[e]);
+        }
+
+        using CascadeKernels::ISA;
+        for (auto isa : {ISA::SSE2, ISA::AVX2, ISA::AVX512, ISA::NEON}) {
+            if (CascadeKernels::isSupported(isa)) {
+                report.kernels.add(checkKernel(isa, sampleRate, cases, tolerances));
+            }
+        }
+
+        report.analog.add(checkAnalog(sampleRate, tolerances));
+    }
+
+    return report;
+}
+
+bool Report::passed() const
+{
+    for (const auto& result : results) {
+        if (!result.isBaseline && result.numFailures > 0) {
+            return false;
+        }
+    }
+    for (const auto& kernel : kernels) {
+        if (!kernel.passed()) {
+            return false;
+        }
+    }
+    for (const auto& result : analog) {
+        if (!result.passed()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+juce::String Report::toString() const
+{
+    juce::String text;
+
+    for (const auto& result : results) {
+        text << juce::String(result.sampleRate / 1000.0, 1) << " kHz  "
+             << (result.isBaseline ? result.engine + " (baseline)" : result.engine).paddedRight(' ', 24)
+             << juce::String(result.nanosecondsPerSample, 2) << " ns/sample  "
+             << "impulse " << juce::String(result.impulseErrorDb, 1) << " dB  "
+             << "magnitude " << juce::String(result.magnitudeErrorDb, 3) << " dB  "
+             << "noise " << juce::String(result.noiseFloorDb, 1) << " dBFS  "
+             << result.numFailures << "/" << result.numCases << " failed";
+
+        if (result.firstFailure.isNotEmpty()) {
+            text << " (first: " << result.firstFailure << ")";
+        }
+        text << juce::newLine;
+    }
+
+    for (const auto& kernel : kernels) {
+        text << juce::String(kernel.sampleRate / 1000.0, 1) << " kHz  "
+             << (kernel.kernel + " vs scalar").paddedRight(' ', 24)
+             << juce::String(kernel.errorEpsilons, 2) << " eps (limit " << juce::String(kernel.toleranceEpsilons, 1) << ") over "
+             << kernel.numCases << " cases";
+
+        if (!kernel.passed()) {
+            text << " FAILED, worst " << kernel.worstCase;
+        }
+        text << juce::newLine;
+    }
+
+    for (const auto& result : analog) {
+        text << juce::String(result.sampleRate / 1000.0, 1) << " kHz  "
+             << juce::String("Matched vs analog").paddedRight(' ', 24)
+             << juce::String(result.matchedErrorDb, 2) << " dB (limit " << juce::String(result.toleranceDb, 2) << "), bilinear "
+             << juce::String(result.bilinearMinErrorDb, 2) << " to " << juce::String(result.bilinearMaxErrorDb, 2) << " dB over "
+             << result.numCases << " cases";
+
+        if (!result.passed()) {
+            text << " FAILED, worst " << result.worstCase;
+            if (result.numNotBetter > 0) {
+                text << ", " << result.numNotBetter << " no closer than bilinear";
+            }
+        }
+        text << juce::newLine;
+    }
+
+    text << (passed() ? "PASSED" : "FAILED") << juce::newLine;
+    return text;
+}
+
+}
@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    EngineConformance.h
+
+    Holds every filter engine to a double-precision reference of the
+    LowCut/Peak/HighCut chain. Each band is swept over its parameter range at
+    44.1 to 192 kHz; for every setting the engine's impulse response, its
+    magnitude response and the noise it adds to a full-band signal are
+    compared with the reference, and its speed is measured in ns/sample.
+    Every case is run with both FilterDesigns, each held to a reference of
+    its own design. Every vector kernel is also checked against the scalar
+    one on the same cascades, to within a few float epsilon per section.
+
+    The analog-matched designs are also held to the analog prototype they
+    approximate: high Peak bands, where the bilinear transform is furthest
+    off, must be within a fixed bound of it and closer than bilinear.
+
+    run() is self-contained (it needs no processor or host), so it can be
+    called from a debugger, or from the harness (Tools/Harness), whose
+    conformance command fails when the report does.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+namespace EngineConformance
+{
+    // An engine passes a case if it's within these of the reference, or no
+    // worse than MonoChain plus the margin. The margin exists because float
+    // coefficients alone already put MonoChain over the absolute limits for
+    // very low cutoffs at high sample rates (over 1 dB at 20 Hz, 192 kHz).
+    struct Tolerances
+    {
+        // RMS difference of the impulse responses, relative to the reference's RMS
+        double impulseErrorDb {-60.0};
+        // Largest magnitude difference between 20 Hz and 20 kHz, wherever the
+        // reference is above magnitudeFloorDb
+        double magnitudeErrorDb {0.1};
+        double magnitudeFloorDb {-60.0};
+        // RMS difference on half-scale white noise, dBFS
+        double noiseFloorDb {-80.0};
+
+        // How much worse than MonoChain an engine may be, for the impulse and
+        // noise errors and for the magnitude error
+        double baselineMarginDb {6.0};
+        double baselineMagnitudeMarginDb {0.01};
+
+        // How far a vector kernel may be from the scalar one, in float
+        // epsilon per section in the cascade, see measureErrorAgainstScalar.
+        // SSE2 is bit exact, the FMA kernels measure around half of this.
+        double kernelEpsilonsPerSection {2.0};
+
+        // Largest magnitude difference from the analog prototype, 20 Hz to
+        // 20 kHz, for an analog-matched Peak at 10 or 16 kHz. The worst is
+        // 1.79 dB (16 kHz, -12 dB, Q 2 at 44.1 kHz), where bilinear is 6.6 dB
+        // off; bilinear is 2.0 to 7.0 dB off over the same cases.
+        double analogMatchedPeakErrorDb {1.85};
+    };
+
+    struct Options
+    {
+        juce::Array<double> sampleRates {44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0};
+        // Points per parameter in the sweep. Fewer makes for a quick smoke test.
+        int frequencySteps {8};
+        bool quickGainAndQuality {false};
+        // Each case is run once per design
+        juce::Array<FilterDesign> designs {Design_Bilinear, Design_AnalogMatched};
+        // Processed in blocks this size so state carried between blocks is covered
+        int blockSize {512};
+        Tolerances tolerances;
+    };
+
+    struct EngineResult
+    {
+        juce::String engine;
+        // MonoChain. Its failures are against the absolute limits only and
+        // don't fail the report.
+        bool isBaseline {false};
+        double sampleRate {0};
+        int numCases {0}, numFailures {0};
+
+        // Worst over all cases, in dB
+        double impulseErrorDb {-400}, magnitudeErrorDb {0}, noiseFloorDb {-400};
+        // Settings of the first failing case, empty if none failed
+        juce::String firstFailure;
+
+        double nanosecondsPerSample {0};
+    };
+
+    struct KernelResult
+    {
+        juce::String kernel;
+        double sampleRate {0};
+        int numCases {0};
+        // Worst over all cases, and the limit, in float epsilon
+        double errorEpsilons {0}, toleranceEpsilons {0};
+        juce::String worstCase;
+
+        bool passed() const { return errorEpsilons <= toleranceEpsilons; }
+    };
+
+    struct AnalogResult
+    {
+        double sampleRate {0};
+        int numCases {0};
+        // Worst matched error over all cases and its limit, and the range
+        // of the bilinear errors on the same cases, in dB
+        double matchedErrorDb {0}, toleranceDb {0};
+        double bilinearMinErrorDb {0}, bilinearMaxErrorDb {0};
+        juce::String worstCase;
+        // Cases where matched wasn't closer than bilinear
+        int numNotBetter {0};
+
+        bool passed() const { return matchedErrorDb <= toleranceDb && numNotBetter == 0; }
+    };
+
+    struct Report
+    {
+        juce::Array<EngineResult> results;
+        // One per vector kernel this CPU supports and sample rate
+        juce::Array<KernelResult> kernels;
+        // One per sample rate
+        juce::Array<AnalogResult> analog;
+
+        bool passed() const;
+        juce::String toString() const;
+    };
+
+    // Runs MonoChain and FilterCascade with every kernel this CPU supports.
+    // Message thread or a background thread. The default sweep takes tens of
+    // seconds; frequencySteps = 3 with quickGainAndQuality is a few.
+    Report run(const Options& options = {});
+}
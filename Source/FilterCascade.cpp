@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    FilterCascade.cpp
+
+  ==============================================================================
+*/
+
+#include "FilterCascade.h"
+
+FilterCascade::FilterCascade()
+{
+    for (int section = 0; section < maxSections; section++) {
+        for (int lane = 0; lane < maxLanes; lane++) {
+            clearSection(lane, section);
+        }
+    }
+    reset();
+}
+
+void FilterCascade::reset() noexcept
+{
+    for (auto& section : sections) {
+        std::fill(std::begin(section.z1), std::end(section.z1), 0.f);
+        std::fill(std::begin(section.z2), std::end(section.z2), 0.f);
+    }
+}
+
+void FilterCascade::setSection(int lane, int section, const BiquadCoefficients& coefficients)
+{
+    jassert(coefficients.getFilterOrder() == 2);
+
+    // JUCE stores a normalised biquad as b0, b1, b2, a1, a2
+    auto* c = coefficients.getRawCoefficients();
+    setSection(lane, section, c[0], c[1], c[2], c[3], c[4]);
+}
+
+void FilterCascade::setSection(int lane, int section, float b0, float b1, float b2, float a1, float a2) noexcept
+{
+    auto& s = sections[section];
+    s.b0[lane] = b0;
+    s.b1[lane] = b1;
+    s.b2[lane] = b2;
+    s.a1[lane] = a1;
+    s.a2[lane] = a2;
+
+    if (!laneActive[section][lane]) {
+        laneActive[section][lane] = true;
+        updateActiveSections();
+    }
+}
+
+void FilterCascade::clearSection(int lane, int section)
+{
+    // A pass-through biquad, so the other lanes can keep using this section
+    auto& s = sections[section];
+    s.b0[lane] = 1.f;
+    s.b1[lane] = 0.f;
+    s.b2[lane] = 0.f;
+    s.a1[lane] = 0.f;
+    s.a2[lane] = 0.f;
+
+    if (laneActive[section][lane]) {
+        laneActive[section][lane] = false;
+        updateActiveSections();
+    }
+}
+
+void FilterCascade::setBands(int lane, const BandDesign::Sections& bands) noexcept
+{
+    auto setBiquad = [this, lane](int section, const BandDesign::Biquad& biquad) {
+        setSection(lane, section, (float) biquad.b0, (float) biquad.b1, (float) biquad.b2, (float) biquad.a1, (float) biquad.a2);
+    };
+
+    for (int i = 0; i < 4; i++) {
+        if (i < bands.numLowCut) {
+            setBiquad(lowCutSection + i, bands.lowCut[i]);
+        } else {
+            clearSection(lane, lowCutSection + i);
+        }
+
+        if (i < bands.numHighCut) {
+            setBiquad(highCutSection + i, bands.highCut[i]);
+        } else {
+            clearSection(lane, highCutSection + i);
+        }
+    }
+
+    setBiquad(peakSection, bands.peak);
+}
+
+void FilterCascade::updateSection(int lane, int section, float b0, float b1, float b2, float a1, float a2) noexcept
+{
+    jassert(laneActive[section][lane]);
+
+    auto& s = sections[section];
+    s.b0[lane] = b0;
+    s.b1[lane] = b1;
+    s.b2[lane] = b2;
+    s.a1[lane] = a1;
+    s.a2[lane] = a2;
+}
+
+void FilterCascade::updateActiveSections()
+{
+    numActiveSections = 0;
+
+    for (int section = 0; section < maxSections; section++) {
+        bool active = false;
+        for (int lane = 0; lane < maxLanes; lane++) {
+            active = active || laneActive[section][lane];
+        }
+
+        if (active) {
+            activeSections[numActiveSections++] = section;
+        } else {
+            // Don't let stale state come back when the section is switched on again
+            std::fill(std::begin(sections[section].z1), std::end(sections[section].z1), 0.f);
+            std::fill(std::begin(sections[section].z2), std::end(sections[section].z2), 0.f);
+        }
+    }
+}
+
+void FilterCascade::process(float* const* channels, int numChannels, int numSamples, bool midSide, float* scratch) noexcept
+{
+    process(channels, numChannels, numSamples, midSide, scratch, CascadeKernels::getActiveKernel());
+}
+
+void FilterCascade::process(float* const* channels, int numChannels, int numSamples, bool midSide, float* scratch,
+                            CascadeKernels::ProcessFunction kernel) noexcept
+{
+    jassert(numChannels <= maxLanes);
+    jassert(!midSide || numChannels == 2);
+
+    kernel(sections, activeSections, numActiveSections,
+           channels, numChannels, numSamples, midSide, scratch,
+           metering ? &inputLevels : nullptr, metering ? &outputLevels : nullptr);
+}
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    FilterCascade.h
+
+    Up to CascadeKernels::maxLanes channels run through the biquad cascade
+    together, one vector lane each, using whichever kernel CascadeKernels
+    picked for this CPU. Mid/side encoding and decoding for a stereo pair
+    happens inside the same pass, so an M/S setup only costs a few adds on
+    top of plain stereo processing. Metering rides along in the same pass
+    too, see setMetering().
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CascadeKernels.h"
+#include "BandDesign.h"
+
+struct FilterCascade
+{
+    using BiquadCoefficients = juce::dsp::IIR::Coefficients<float>;
+
+    static constexpr int maxLanes = CascadeKernels::maxLanes;
+    static constexpr int maxSections = 9;
+
+    // Where each band lives, the same in every cascade: four low cut
+    // sections, the Peak, then four high cut sections
+    static constexpr int lowCutSection = 0;
+    static constexpr int peakSection = 4;
+    static constexpr int highCutSection = 5;
+
+    FilterCascade();
+
+    // Clears the filter state of every section
+    void reset() noexcept;
+
+    // For a stereo pair lane 0 is left (or mid), lane 1 is right (or side)
+    void setSection(int lane, int section, const BiquadCoefficients& coefficients);
+    // Same, from a normalised biquad, so the audio thread can call it
+    void setSection(int lane, int section, float b0, float b1, float b2, float a1, float a2) noexcept;
+    void clearSection(int lane, int section);
+    // Every band of one lane, as BandDesign designed them. Cut sections past
+    // the slope are cleared. Allocation free, so the audio thread can call it.
+    void setBands(int lane, const BandDesign::Sections& bands) noexcept;
+    // Audio thread: new coefficients for a section the lane already uses, e.g.
+    // to modulate it between sub-blocks. Keeps the filter state.
+    void updateSection(int lane, int section, float b0, float b1, float b2, float a1, float a2) noexcept;
+
+    // channels holds one pointer per lane in use. scratch must be 64-byte aligned,
+    // see CascadeKernels::getScratchFloatsNeeded
+    void process(float* const* channels, int numChannels, int numSamples, bool midSide, float* scratch) noexcept;
+    // Same, with a specific kernel rather than the active one, e.g. to compare variants
+    void process(float* const* channels, int numChannels, int numSamples, bool midSide, float* scratch,
+                 CascadeKernels::ProcessFunction kernel) noexcept;
+
+    // Every section, for comparing kernels on the same coefficients and state
+    const CascadeKernels::Section* getSections() const noexcept { return sections; }
+
+    // Audio thread. While on, process() adds each lane's levels on the way
+    // in and on the way out to these, for LevelMeter to collect.
+    void setMetering(bool shouldMeter) noexcept { metering = shouldMeter; }
+    bool isMetering() const noexcept { return metering; }
+    CascadeKernels::Levels& getInputLevels() noexcept { return inputLevels; }
+    CascadeKernels::Levels& getOutputLevels() noexcept { return outputLevels; }
+
+private:
+    void updateActiveSections();
+
+    CascadeKernels::Section sections[maxSections];
+    bool laneActive[maxSections][maxLanes] {};
+
+    // Only sections used by at least one lane get processed, in order
+    int activeSections[maxSections] {};
+    int numActiveSections = 0;
+
+    CascadeKernels::Levels inputLevels {}, outputLevels {};
+    bool metering = false;
+};
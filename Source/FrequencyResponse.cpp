@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    FrequencyResponse.cpp
+
+  ==============================================================================
+*/
+
+#include "FrequencyResponse.h"
+#include "PluginProcessor.h"
+
+// Stops a zero right on the unit circle dividing by nothing
+static constexpr double MIN_SQUARED_MAGNITUDE = 1e-300;
+
+namespace FrequencyResponse
+{
+
+void Snapshot::addSection(const juce::dsp::IIR::Coefficients<float>& coefficients)
+{
+    jassert(coefficients.getFilterOrder() == 2);
+    jassert(numSections < maxSections);
+
+    // JUCE stores a normalised biquad as b0, b1, b2, a1, a2
+    auto* c = coefficients.getRawCoefficients();
+    sections[numSections++] = {c[0], c[1], c[2], c[3], c[4]};
+}
+
+Snapshot Snapshot::fromSettings(const ChainSettings& settings, double sampleRate)
+{
+    Snapshot snapshot;
+    snapshot.sampleRate = sampleRate;
+
+    auto lowCut = makeLowCutFilter(settings, sampleRate);
+    for (int i = 0; i <= settings.lowCutSlope; i++) {
+        snapshot.addSection(*lowCut[i]);
+    }
+
+    snapshot.addSection(*makePeakFilter(settings, sampleRate));
+
+    auto highCut = makeHighCutFilter(settings, sampleRate);
+    for (int i = 0; i <= settings.highCutSlope; i++) {
+        snapshot.addSection(*highCut[i]);
+    }
+
+    return snapshot;
+}
+
+// Evaluation Code
+//==============================================================================
+// For each frequency the running product H of the sections so far and the
+// sum of their group delays. With z = e^jw, a polynomial P = sum p[k] z^-k
+// has group delay Re(Q / P) where Q = sum k p[k] z^-k, and a section's is
+// its numerator's less its denominator's.
+static void evaluateRange(const Snapshot& snapshot, const double* frequencies, int start, int end,
+                          double* magnitudeDb, double* phase, double* groupDelay)
+{
+    using juce::MathConstants;
+    auto radiansPerHz = MathConstants<double>::twoPi / snapshot.sampleRate;
+
+    alignas(64) double cos1[blockSize], sin1[blockSize], cos2[blockSize], sin2[blockSize];
+    alignas(64) double hr[blockSize], hi[blockSize], delay[blockSize];
+
+    for (int blockStart = start; blockStart < end; blockStart += blockSize) {
+        auto n = juce::jmin(blockSize, end - blockStart);
+
+        // A short last block is padded with DC, so every loop below is a full block
+        for (int i = 0; i < blockSize; i++) {
+            auto omega = i < n ? frequencies[blockStart + i] * radiansPerHz : 0.0;
+            cos1[i] = std::cos(omega);
+            sin1[i] = std::sin(omega);
+            cos2[i] = 2.0 * cos1[i] * cos1[i] - 1.0;
+            sin2[i] = 2.0 * sin1[i] * cos1[i];
+            hr[i] = 1.0;
+            hi[i] = 0.0;
+            delay[i] = 0.0;
+        }
+
+        for (int s = 0; s < snapshot.numSections; s++) {
+            auto b0 = snapshot.sections[s].b0, b1 = snapshot.sections[s].b1, b2 = snapshot.sections[s].b2;
+            auto a1 = snapshot.sections[s].a1, a2 = snapshot.sections[s].a2;
+
+            for (int i = 0; i < blockSize; i++) {
+                auto nr = b0 + b1 * cos1[i] + b2 * cos2[i];
+                auto ni = -(b1 * sin1[i] + b2 * sin2[i]);
+                auto qr = b1 * cos1[i] + 2.0 * b2 * cos2[i];
+                auto qi = -(b1 * sin1[i] + 2.0 * b2 * sin2[i]);
+
+                auto dr = 1.0 + a1 * cos1[i] + a2 * cos2[i];
+                auto di = -(a1 * sin1[i] + a2 * sin2[i]);
+                auto er = a1 * cos1[i] + 2.0 * a2 * cos2[i];
+                auto ei = -(a1 * sin1[i] + 2.0 * a2 * sin2[i]);
+
+                auto n2 = std::max(nr * nr + ni * ni, MIN_SQUARED_MAGNITUDE);
+                auto d2 = std::max(dr * dr + di * di, MIN_SQUARED_MAGNITUDE);
+
+                delay[i] += (qr * nr + qi * ni) / n2 - (er * dr + ei * di) / d2;
+
+                // H *= N / D = N * conj(D) / |D|^2
+                auto xr = (nr * dr + ni * di) / d2;
+                auto xi = (ni * dr - nr * di) / d2;
+                auto r = hr[i] * xr - hi[i] * xi;
+                hi[i] = hr[i] * xi + hi[i] * xr;
+                hr[i] = r;
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            auto index = blockStart + i;
+            if (magnitudeDb != nullptr) {
+                magnitudeDb[index] = 10.0 * std::log10(std::max(hr[i] * hr[i] + hi[i] * hi[i], MIN_SQUARED_MAGNITUDE));
+            }
+            if (phase != nullptr) {
+                phase[index] = std::atan2(hi[i], hr[i]);
+            }
+            if (groupDelay != nullptr) {
+                groupDelay[index] = delay[i] / snapshot.sampleRate;
+            }
+        }
+    }
+}
+
+namespace
+{
+    struct RangeJob : juce::ThreadPoolJob
+    {
+        RangeJob(const Snapshot& s, const double* f, int startIndex, int endIndex, double* m, double* p, double* g)
+            : juce::ThreadPoolJob("Frequency response"),
+              snapshot(s), frequencies(f), start(startIndex), end(endIndex), magnitudeDb(m), phase(p), groupDelay(g)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            evaluateRange(snapshot, frequencies, start, end, magnitudeDb, phase, groupDelay);
+            return jobHasFinished;
+        }
+
+        const Snapshot& snapshot;
+        const double* frequencies;
+        int start, end;
+        double *magnitudeDb, *phase, *groupDelay;
+    };
+}
+
+void evaluate(const Snapshot& snapshot,
+              const double* frequencies,
+              int numFrequencies,
+              double* magnitudeDb,
+              double* phase,
+              double* groupDelay,
+              juce::ThreadPool* pool)
+{
+    if (pool == nullptr || numFrequencies < parallelThreshold || pool->getNumThreads() < 2) {
+        evaluateRange(snapshot, frequencies, 0, numFrequencies, magnitudeDb, phase, groupDelay);
+        return;
+    }
+
+    // Whole blocks per job, so only the last one is ever short
+    auto numJobs = pool->getNumThreads();
+    auto blocksPerJob = (numFrequencies / blockSize + numJobs) / numJobs;
+    auto perJob = blocksPerJob * blockSize;
+
+    juce::OwnedArray<RangeJob> jobs;
+    for (int start = 0; start < numFrequencies; start += perJob) {
+        auto* job = jobs.add(new RangeJob(snapshot, frequencies, start, juce::jmin(numFrequencies, start + perJob),
+                                          magnitudeDb, phase, groupDelay));
+        pool->addJob(job, false);
+    }
+
+    for (auto* job : jobs) {
+        pool->waitForJobToFinish(job, -1);
+    }
+}
+
+std::vector<double> makeLogFrequencies(int numFrequencies, double minFrequency, double maxFrequency)
+{
+    std::vector<double> frequencies ((size_t) juce::jmax(0, numFrequencies));
+    for (int i = 0; i < numFrequencies; i++) {
+        auto proportion = numFrequencies > 1 ? (double) i / (double) (numFrequencies - 1) : 0.0;
+        frequencies[(size_t) i] = juce::mapToLog10(proportion, minFrequency, maxFrequency);
+    }
+    return frequencies;
+}
+
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    FrequencyResponse.h
+
+    Magnitude, phase and group delay of a chain for any number of
+    frequencies in one call, evaluated from a Snapshot of its coefficients
+    rather than a live filter, so it's safe on any thread.
+
+    Frequencies are done blockSize at a time, with every section applied
+    across the whole block before the next one. The inner loops have a
+    fixed length and no branches, so they vectorise. Grids big enough to be
+    worth it can be split over a thread pool.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct ChainSettings;
+
+namespace FrequencyResponse
+{
+    // Frequencies evaluated together
+    static constexpr int blockSize = 16;
+    // Grids smaller than this aren't worth waking a pool for
+    static constexpr int parallelThreshold = 8192;
+
+    // A normalised biquad, widened to double
+    struct Section
+    {
+        double b0 {1}, b1 {0}, b2 {0}, a1 {0}, a2 {0};
+    };
+
+    struct Snapshot
+    {
+        // Enough for every band at its steepest
+        static constexpr int maxSections = 9;
+
+        Section sections[maxSections];
+        int numSections {0};
+        double sampleRate {44100.0};
+
+        void addSection(const juce::dsp::IIR::Coefficients<float>& coefficients);
+
+        // The bands as the plugin designs them for these settings
+        static Snapshot fromSettings(const ChainSettings& settings, double sampleRate);
+    };
+
+    // Evaluates every frequency (in Hz) in one go: magnitude in dB, phase in
+    // radians (wrapped to -pi..pi) and group delay in seconds. Any output
+    // can be nullptr; the others need numFrequencies entries each. With a
+    // pool, grids of at least parallelThreshold points are split over its
+    // threads, and this waits for them.
+    void evaluate(const Snapshot& snapshot,
+                  const double* frequencies,
+                  int numFrequencies,
+                  double* magnitudeDb,
+                  double* phase,
+                  double* groupDelay,
+                  juce::ThreadPool* pool = nullptr);
+
+    // numFrequencies log-spaced points from minFrequency to maxFrequency
+    std::vector<double> makeLogFrequencies(int numFrequencies, double minFrequency, double maxFrequency);
+}
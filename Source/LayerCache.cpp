@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    LayerCache.cpp
+
+  ==============================================================================
+*/
+
+#include "LayerCache.h"
+#include "TraceRecorder.h"
+
+LayerCache::LayerCache(juce::Component& ownerToRepaint, RenderFunction function)
+    : owner(ownerToRepaint), renderFunction(std::move(function))
+{
+}
+
+LayerCache::~LayerCache()
+{
+    // A render still running only holds copies, and its result gets dropped
+    // once it finds this has gone
+}
+
+juce::Image LayerCache::render(const RenderFunction& renderFunction, Target target)
+{
+    TRACE_SCOPE("LayerCache::render");
+    juce::Image newImage(juce::Image::ARGB, target.pixelWidth, target.pixelHeight, true, juce::SoftwareImageType());
+
+    juce::Graphics g(newImage);
+    g.addTransform(juce::AffineTransform::scale(target.pixelWidth / target.width, target.pixelHeight / target.height));
+    renderFunction(g, {target.width, target.height});
+
+    return newImage;
+}
+
+void LayerCache::draw(juce::Graphics& g, juce::Rectangle<float> area)
+{
+    if (area.isEmpty()) {
+        return;
+    }
+
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    Target target;
+    target.width = area.getWidth();
+    target.height = area.getHeight();
+    target.pixelWidth = juce::jmax(1, juce::roundToInt(area.getWidth() * scale));
+    target.pixelHeight = juce::jmax(1, juce::roundToInt(area.getHeight() * scale));
+
+    if (image.isNull()) {
+        // Nothing to stretch yet
+        image = render(renderFunction, target);
+        current = wanted = target;
+    } else if (target != wanted) {
+        // Restarted on every change, so a drag only renders once it stops
+        wanted = target;
+        startTimer(SETTLE_MILLISECONDS);
+    }
+
+    g.drawImage(image, area);
+}
+
+void LayerCache::timerCallback()
+{
+    stopTimer();
+
+    if (wanted == current) {
+        return;
+    }
+
+    juce::WeakReference<LayerCache> weakThis(this);
+    auto function = renderFunction;
+    auto target = wanted;
+
+    renderThread->addJob([weakThis, function, target] {
+        // The pool's thread is only called "Pool" otherwise
+        TraceRecorder::setThreadName("Layer Render");
+        auto newImage = render(function, target);
+
+        juce::MessageManager::callAsync([weakThis, newImage, target] {
+            if (auto* cache = weakThis.get()) {
+                cache->renderFinished(newImage, target);
+            }
+        });
+    });
+}
+
+void LayerCache::renderFinished(juce::Image newImage, Target target)
+{
+    // Something newer is on its way, this one would just be stretched again
+    if (target != wanted) {
+        return;
+    }
+
+    image = newImage;
+    current = target;
+    owner.repaint();
+}
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    LayerCache.h
+
+    A cached image of something that only changes with its size, rendered at
+    the display's physical pixel scale so it stays sharp on HiDPI screens.
+
+    When the size or scale changes the old image is stretched to fit while a
+    new one is rendered on a background thread, and that only starts once
+    the change has settled (e.g. the end of a resize drag), so resizing
+    never waits on a full redraw. Only the very first draw renders in place.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class LayerCache : private juce::Timer
+{
+public:
+    // Draws the layer into bounds, in logical pixels starting at 0, 0. Runs on
+    // a background thread, so it mustn't touch any component; everything it
+    // needs has to be captured by value.
+    using RenderFunction = std::function<void(juce::Graphics&, juce::Rectangle<float> bounds)>;
+
+    LayerCache(juce::Component& owner, RenderFunction renderFunction);
+    ~LayerCache() override;
+
+    // Message thread, from owner's paint
+    void draw(juce::Graphics& g, juce::Rectangle<float> area);
+
+private:
+    // Logical size and the pixel size it's rendered at
+    struct Target
+    {
+        float width {0}, height {0};
+        int pixelWidth {0}, pixelHeight {0};
+
+        bool operator== (const Target& other) const
+        {
+            return width == other.width && height == other.height
+                && pixelWidth == other.pixelWidth && pixelHeight == other.pixelHeight;
+        }
+        bool operator!= (const Target& other) const { return !operator==(other); }
+    };
+
+    static juce::Image render(const RenderFunction& renderFunction, Target target);
+
+    void timerCallback() override;
+    void renderFinished(juce::Image newImage, Target target);
+
+    // Wait this long after the last change before rendering
+    static constexpr int SETTLE_MILLISECONDS = 150;
+
+    juce::Component& owner;
+    RenderFunction renderFunction;
+
+    juce::Image image;
+    Target current, wanted;
+
+    // One low priority thread shared by every cache
+    struct RenderThread : juce::ThreadPool
+    {
+        RenderThread() : juce::ThreadPool(1, 0, juce::Thread::Priority::low) {}
+    };
+    juce::SharedResourcePointer<RenderThread> renderThread;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(LayerCache)
+};
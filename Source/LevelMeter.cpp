@@ -0,0 +1,250 @@
+/*
+  ==============================================================================
+
+    LevelMeter.cpp
+
+  ==============================================================================
+*/
+
+#include "LevelMeter.h"
+
+// Raises an atomic to value if it's higher, safe against the editor resetting it
+static void storeMax(std::atomic<float>& target, float value) noexcept
+{
+    auto current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+static float energyToLoudness(double meanSquare)
+{
+    return meanSquare > 0 ? (float) (-0.691 + 10.0 * std::log10(meanSquare)) : LevelMeter::SILENCE;
+}
+
+void LevelMeter::prepare(double sampleRate, int numChannels)
+{
+    channelStates.assign((size_t) numChannels, ChannelState());
+    bucketLength = juce::jmax(1, juce::roundToInt(sampleRate * 0.1));
+
+    using namespace juce;
+
+    // BS.1770 K-weighting, with the 48 kHz reference filters redesigned for this
+    // sample rate (the same derivation libebur128 uses)
+    {
+        auto f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+        auto k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+        auto vh = std::pow(10.0, gainDb / 20.0);
+        auto vb = std::pow(vh, 0.4996667741545416);
+        auto a0 = 1.0 + k / q + k * k;
+        shelf[0] = (float) ((vh + vb * k / q + k * k) / a0);
+        shelf[1] = (float) (2.0 * (k * k - vh) / a0);
+        shelf[2] = (float) ((vh - vb * k / q + k * k) / a0);
+        shelf[3] = (float) (2.0 * (k * k - 1.0) / a0);
+        shelf[4] = (float) ((1.0 - k / q + k * k) / a0);
+    }
+    {
+        auto f0 = 38.13547087602444, q = 0.5003270373238773;
+        auto k = std::tan(MathConstants<double>::pi * f0 / sampleRate);
+        auto a0 = 1.0 + k / q + k * k;
+        highPass[0] = 1.f;
+        highPass[1] = -2.f;
+        highPass[2] = 1.f;
+        highPass[3] = (float) (2.0 * (k * k - 1.0) / a0);
+        highPass[4] = (float) ((1.0 - k / q + k * k) / a0);
+    }
+
+    // 48 tap windowed-sinc interpolator split into four phases, each phase
+    // normalised to unity gain at DC
+    constexpr int numTaps = OVERSAMPLING * TAPS_PER_PHASE;
+    for (int phase = 0; phase < OVERSAMPLING; phase++) {
+        double sum = 0;
+        double taps[TAPS_PER_PHASE];
+
+        for (int k = 0; k < TAPS_PER_PHASE; k++) {
+            auto n = phase + OVERSAMPLING * k;
+            auto t = (n - (numTaps - 1) / 2.0) / OVERSAMPLING;
+            auto sinc = std::abs(t) < 1.0e-9 ? 1.0 : std::sin(MathConstants<double>::pi * t) / (MathConstants<double>::pi * t);
+            auto w = 2.0 * MathConstants<double>::pi * n / (numTaps - 1);
+            auto blackman = 0.42 - 0.5 * std::cos(w) + 0.08 * std::cos(2.0 * w);
+            taps[k] = sinc * blackman;
+            sum += taps[k];
+        }
+        for (int k = 0; k < TAPS_PER_PHASE; k++) {
+            truePeakTaps[phase][k] = (float) (taps[k] / sum);
+        }
+    }
+
+    reset();
+}
+
+void LevelMeter::prepareLevels(CascadeKernels::Levels& levels) const
+{
+    levels = CascadeKernels::Levels();
+    std::copy(std::begin(shelf), std::end(shelf), levels.shelf);
+    std::copy(std::begin(highPass), std::end(highPass), levels.highPass);
+}
+
+void LevelMeter::reset()
+{
+    for (auto& state : channelStates) {
+        state = ChannelState();
+    }
+
+    bucketFill = 0;
+    bucketIndex = 0;
+    bucketWeightedEnergy = 0;
+    bucketEnergy = 0;
+    std::fill(std::begin(weightedBuckets), std::end(weightedBuckets), 0.0);
+    std::fill(std::begin(buckets), std::end(buckets), 0.0);
+    std::fill(std::begin(bucketSamples), std::end(bucketSamples), 0);
+
+    readings.peak = 0;
+    readings.truePeak = 0;
+    readings.rms = 0;
+    readings.momentaryLoudness = SILENCE;
+    readings.shortTermLoudness = SILENCE;
+}
+
+void LevelMeter::measureTruePeak(const float* const* channels, int numChannels, int numSamples, float* scratch) noexcept
+{
+    numChannels = juce::jmin(numChannels, (int) channelStates.size());
+    if (!truePeakEnabled || scratch == nullptr) {
+        return;
+    }
+
+    float truePeak = 0;
+    for (int ch = 0; ch < numChannels; ch++) {
+        truePeak = juce::jmax(truePeak, measureTruePeak(channels[ch], channelStates[(size_t) ch], numSamples, scratch));
+    }
+    storeMax(readings.truePeak, truePeak);
+}
+
+void LevelMeter::collect(CascadeKernels::Levels& levels, int numLanes) noexcept
+{
+    float peak = 0;
+    double energy = 0, weightedEnergy = 0;
+
+    for (int lane = 0; lane < numLanes; lane++) {
+        peak = juce::jmax(peak, levels.peak[lane]);
+        energy += levels.energy[lane];
+        weightedEnergy += levels.weightedEnergy[lane];
+    }
+
+    // The filter state carries on into the next pass
+    std::fill(std::begin(levels.peak), std::end(levels.peak), 0.f);
+    std::fill(std::begin(levels.energy), std::end(levels.energy), 0.f);
+    std::fill(std::begin(levels.weightedEnergy), std::end(levels.weightedEnergy), 0.f);
+
+    bucketEnergy += energy;
+    bucketWeightedEnergy += weightedEnergy;
+
+    storeMax(readings.peak, peak);
+    if (truePeakEnabled) {
+        // The interpolator rolls off slightly, never report less than the samples themselves
+        storeMax(readings.truePeak, peak);
+    }
+}
+
+void LevelMeter::advance(int numSamples) noexcept
+{
+    bucketFill += numSamples;
+    if (bucketFill >= bucketLength) {
+        finishBucket();
+    }
+}
+
+float LevelMeter::measureTruePeak(const float* data, ChannelState& state, int numSamples, float* scratch) noexcept
+{
+    // Lay the history and the block out back to back so every output can read
+    // its taps straight from one buffer, then work through the block a chunk
+    // at a time with all four phases' accumulators kept in registers. The
+    // fixed-size inner loops are what the compiler vectorises.
+    constexpr int chunk = 16;
+    auto* input = scratch;
+
+    std::copy(std::begin(state.history), std::end(state.history), input);
+    std::copy(data, data + numSamples, input + TAPS_PER_PHASE);
+
+    // Tap k of output i reads input[i + TAPS_PER_PHASE - k]
+    float peaks[chunk] {};
+    int i = 0;
+
+    for (; i + chunk <= numSamples; i += chunk) {
+        float acc[OVERSAMPLING][chunk] {};
+
+        for (int k = 0; k < TAPS_PER_PHASE; k++) {
+            auto* x = input + i + TAPS_PER_PHASE - k;
+            for (int phase = 0; phase < OVERSAMPLING; phase++) {
+                auto tap = truePeakTaps[phase][k];
+                for (int j = 0; j < chunk; j++) {
+                    acc[phase][j] += tap * x[j];
+                }
+            }
+        }
+
+        for (int phase = 0; phase < OVERSAMPLING; phase++) {
+            for (int j = 0; j < chunk; j++) {
+                peaks[j] = juce::jmax(peaks[j], std::abs(acc[phase][j]));
+            }
+        }
+    }
+
+    float truePeak = *std::max_element(std::begin(peaks), std::end(peaks));
+
+    for (; i < numSamples; i++) {
+        for (int phase = 0; phase < OVERSAMPLING; phase++) {
+            float y = 0;
+            for (int k = 0; k < TAPS_PER_PHASE; k++) {
+                y += truePeakTaps[phase][k] * input[i + TAPS_PER_PHASE - k];
+            }
+            truePeak = juce::jmax(truePeak, std::abs(y));
+        }
+    }
+
+    std::copy(input + numSamples, input + numSamples + TAPS_PER_PHASE, state.history);
+
+    return truePeak;
+}
+
+void LevelMeter::finishBucket() noexcept
+{
+    weightedBuckets[bucketIndex] = bucketWeightedEnergy;
+    buckets[bucketIndex] = bucketEnergy;
+    bucketSamples[bucketIndex] = bucketFill;
+    bucketIndex = (bucketIndex + 1) % NUM_BUCKETS;
+
+    bucketFill = 0;
+    bucketWeightedEnergy = 0;
+    bucketEnergy = 0;
+
+    // Loudness sums channel energies, RMS averages them
+    auto numChannels = juce::jmax(1, (int) channelStates.size());
+    auto momentary = getWindowEnergy(weightedBuckets, 4 * bucketLength);
+    auto shortTerm = getWindowEnergy(weightedBuckets, NUM_BUCKETS * bucketLength);
+    auto rms = getWindowEnergy(buckets, 3 * bucketLength);
+
+    readings.momentaryLoudness.store(energyToLoudness(momentary / (4.0 * bucketLength)), std::memory_order_relaxed);
+    readings.shortTermLoudness.store(energyToLoudness(shortTerm / ((double) NUM_BUCKETS * bucketLength)), std::memory_order_relaxed);
+    readings.rms.store((float) std::sqrt(rms / (3.0 * bucketLength * numChannels)), std::memory_order_relaxed);
+}
+
+double LevelMeter::getWindowEnergy(const double* energies, int windowSamples) const noexcept
+{
+    // Newest bucket first. The oldest one the window reaches into only counts
+    // for the part of it inside the window.
+    double energy = 0;
+    auto remaining = windowSamples;
+
+    for (int age = 0; age < NUM_BUCKETS && remaining > 0; age++) {
+        auto i = (bucketIndex - 1 - age + NUM_BUCKETS) % NUM_BUCKETS;
+        if (bucketSamples[i] == 0) {
+            break;
+        }
+
+        auto taken = juce::jmin(remaining, bucketSamples[i]);
+        energy += energies[i] * taken / bucketSamples[i];
+        remaining -= taken;
+    }
+
+    return energy;
+}
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    LevelMeter.h
+
+    Sample peak, RMS, true peak (4x polyphase interpolation) and K-weighted
+    momentary/short-term loudness (ITU-R BS.1770) for one bus. Everything
+    but true peak comes out of the cascade pass itself: the kernels add up
+    each lane's peak, energy and K-weighted energy as they load their input
+    or store their output (CascadeKernels::Levels), and this only collects
+    those sums between passes. True peak needs a pass over the block of its
+    own, which is why it's the first thing the QualityGovernor sheds.
+    Results go out through atomics the editor can poll. The harness's
+    metering command measures what it costs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CascadeKernels.h"
+
+class LevelMeter
+{
+public:
+    struct Readings
+    {
+        // Highest since the editor last took them (with exchange), linear
+        std::atomic<float> peak {0}, truePeak {0};
+        // Latest values. RMS is linear over 300 ms, loudness in LUFS
+        std::atomic<float> rms {0};
+        std::atomic<float> momentaryLoudness {SILENCE}, shortTermLoudness {SILENCE};
+    };
+
+    static constexpr float SILENCE = -100.f;
+
+    // Message thread only
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+    // Message thread only: this sample rate's K-weighting for a cascade to
+    // meter with, every sum and state cleared
+    void prepareLevels(CascadeKernels::Levels& levels) const;
+
+    // True peak is by far the most expensive part, so it can be turned off on its own
+    void setTruePeakEnabled(bool shouldBeEnabled) noexcept { truePeakEnabled = shouldBeEnabled; }
+    bool isTruePeakEnabled() const noexcept { return truePeakEnabled; }
+
+    // Audio thread, only while true peak is enabled. scratch must hold
+    // getScratchFloatsNeeded(numSamples) floats.
+    void measureTruePeak(const float* const* channels, int numChannels, int numSamples, float* scratch) noexcept;
+
+    // Audio thread, after a cascade pass: adds what the kernels accumulated
+    // in lanes [0, numLanes) and clears it. Once every cascade is collected,
+    // advance() by the number of samples the pass covered.
+    void collect(CascadeKernels::Levels& levels, int numLanes) noexcept;
+    void advance(int numSamples) noexcept;
+
+    static size_t getScratchFloatsNeeded(int numSamples) { return (size_t) numSamples + TAPS_PER_PHASE; }
+
+    const Readings& getReadings() const noexcept { return readings; }
+    Readings& getReadings() noexcept { return readings; }
+
+    size_t getMemoryFootprint() const noexcept { return channelStates.capacity() * sizeof(ChannelState); }
+
+private:
+    static constexpr int OVERSAMPLING = 4;
+    static constexpr int TAPS_PER_PHASE = 12;
+    // Loudness windows are built from 100 ms buckets, 30 of them for short-term
+    static constexpr int NUM_BUCKETS = 30;
+
+    struct ChannelState
+    {
+        // Last TAPS_PER_PHASE input samples, oldest first
+        float history[TAPS_PER_PHASE] {};
+    };
+
+    float measureTruePeak(const float* data, ChannelState& state, int numSamples, float* scratch) noexcept;
+    void finishBucket() noexcept;
+    double getWindowEnergy(const double* energies, int windowSamples) const noexcept;
+
+    std::vector<ChannelState> channelStates;
+
+    // K-weighting: high shelf then RLB high pass
+    float shelf[5] {}, highPass[5] {};
+    float truePeakTaps[OVERSAMPLING][TAPS_PER_PHASE] {};
+    bool truePeakEnabled {true};
+
+    // A bucket can only finish between cascade passes, so each one runs from
+    // bucketLength to a pass longer; bucketSamples has how long it really was
+    int bucketLength {4800}, bucketFill {0};
+    double bucketWeightedEnergy {0}, bucketEnergy {0};
+    double weightedBuckets[NUM_BUCKETS] {}, buckets[NUM_BUCKETS] {};
+    int bucketSamples[NUM_BUCKETS] {};
+    int bucketIndex {0};
+
+    Readings readings;
+};
@@ -0,0 +1,576 @@
+/*
+  ==============================================================================
+
+    MatchAnalysis.cpp
+
+  ==============================================================================
+*/
+
+#include "MatchAnalysis.h"
+
+// 8192 points with 50% overlap, about 6 Hz per bin at 48 kHz
+static constexpr int FFT_ORDER = 13;
+static constexpr int FFT_SIZE = 1 << FFT_ORDER;
+static constexpr int HOP_SIZE = FFT_SIZE / 2;
+static constexpr int NUM_BINS = FFT_SIZE / 2 + 1;
+
+// Frames each pool job takes. Chunks overlap by FFT_SIZE - HOP_SIZE samples.
+static constexpr int FRAMES_PER_CHUNK = 32;
+static constexpr int CHUNK_SAMPLES = FRAMES_PER_CHUNK * HOP_SIZE + FFT_SIZE - HOP_SIZE;
+// Chunks in flight per pool thread, which is all the memory a file ever takes
+static constexpr int CHUNKS_PER_THREAD = 2;
+
+// Each point averages the bins within this many octaves either side
+static constexpr double POINT_HALF_WIDTH_OCTAVES = 1.0 / 12.0;
+static constexpr double SILENCE_DB = -200.0;
+// Quieter than this in either file and a point is left out of the fit
+static constexpr double FIT_FLOOR_DB = -90.0;
+
+// Peak search grid, see fitPeak
+static constexpr int PEAK_FREQUENCY_STEP = 4;
+static constexpr int GAIN_SEARCH_ITERATIONS = 24;
+// A band only moves if that takes at least this much off the error (dB squared),
+// so identical files leave everything flat rather than chasing the cuts' own edges
+static constexpr double MIN_IMPROVEMENT = 0.5;
+
+namespace MatchAnalysis
+{
+
+double getPointFrequency(int point)
+{
+    return juce::mapToLog10((double) point / (double) (numPoints - 1), (double) MIN_FREQ, (double) MAX_FREQ);
+}
+
+// Analysis Code
+//==============================================================================
+namespace
+{
+    // One chunk's worth of mono samples, and the power summed from every chunk
+    // this slot has processed so far. Slots are reused, so nothing is
+    // allocated once a file is under way.
+    struct ChunkSlot
+    {
+        ChunkSlot() : samples(CHUNK_SAMPLES), fftData(2 * FFT_SIZE), power(NUM_BINS, 0.0) {}
+
+        // The fallback engine takes a lock while it runs, so one each
+        juce::dsp::FFT fft {FFT_ORDER};
+        std::vector<float> samples, fftData;
+        std::vector<double> power;
+        juce::int64 numFramesSummed {0};
+
+        int numFrames {0};
+        std::atomic<bool> busy {false};
+    };
+
+    void processChunk(ChunkSlot& slot, const std::vector<float>& window)
+    {
+        for (int frame = 0; frame < slot.numFrames; frame++) {
+            juce::FloatVectorOperations::multiply(slot.fftData.data(),
+                                                  slot.samples.data() + frame * HOP_SIZE,
+                                                  window.data(),
+                                                  FFT_SIZE);
+            slot.fft.performFrequencyOnlyForwardTransform(slot.fftData.data(), true);
+
+            for (int bin = 0; bin < NUM_BINS; bin++) {
+                auto magnitude = (double) slot.fftData[(size_t) bin];
+                slot.power[(size_t) bin] += magnitude * magnitude;
+            }
+        }
+
+        slot.numFramesSummed += slot.numFrames;
+    }
+
+    // Averages the bins around every point, or interpolates between the two
+    // nearest where a point is narrower than a bin
+    std::vector<double> powerToPoints(const std::vector<double>& power, double sampleRate)
+    {
+        std::vector<double> levelsDb((size_t) numPoints, SILENCE_DB);
+        auto binWidth = sampleRate / FFT_SIZE;
+        auto halfWidth = std::pow(2.0, POINT_HALF_WIDTH_OCTAVES);
+
+        for (int point = 0; point < numPoints; point++) {
+            auto frequency = getPointFrequency(point);
+            if (frequency * halfWidth >= sampleRate / 2) {
+                break;
+            }
+
+            auto first = (int) std::ceil(frequency / halfWidth / binWidth);
+            auto last = (int) std::floor(frequency * halfWidth / binWidth);
+            double average = 0;
+
+            if (last >= first) {
+                for (int bin = first; bin <= last; bin++) {
+                    average += power[(size_t) bin];
+                }
+                average /= (last - first + 1);
+            } else {
+                auto position = frequency / binWidth;
+                auto below = (int) position;
+                auto fraction = position - below;
+                average = power[(size_t) below] * (1.0 - fraction) + power[(size_t) below + 1] * fraction;
+            }
+
+            levelsDb[(size_t) point] = juce::jmax(SILENCE_DB, 10.0 * std::log10(average + 1e-30));
+        }
+
+        return levelsDb;
+    }
+}
+
+Spectrum analyseFile(const juce::File& file,
+                     juce::AudioFormatManager& formatManager,
+                     juce::ThreadPool& pool,
+                     const std::function<bool(double progress)>& progress)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->numChannels == 0 || reader->sampleRate <= 0) {
+        return {};
+    }
+
+    auto length = reader->lengthInSamples;
+    auto numChannels = (int) reader->numChannels;
+    auto totalFrames = length <= FFT_SIZE ? (juce::int64) 1 : 1 + (length - FFT_SIZE) / HOP_SIZE;
+    auto numChunks = (totalFrames + FRAMES_PER_CHUNK - 1) / FRAMES_PER_CHUNK;
+
+    std::vector<float> window ((size_t) FFT_SIZE);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t) FFT_SIZE,
+                                                             juce::dsp::WindowingFunction<float>::hann, false);
+
+    juce::OwnedArray<ChunkSlot> slots;
+    for (int i = 0; i < juce::jmax(1, pool.getNumThreads()) * CHUNKS_PER_THREAD; i++) {
+        slots.add(new ChunkSlot());
+    }
+    juce::WaitableEvent slotFreed;
+    juce::AudioBuffer<float> readBuffer (numChannels, CHUNK_SAMPLES);
+
+    auto findFreeSlot = [&slots]() -> ChunkSlot* {
+        for (auto* slot : slots) {
+            if (!slot->busy.load(std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+        return nullptr;
+    };
+
+    bool cancelled = false;
+
+    for (juce::int64 chunk = 0; chunk < numChunks && !cancelled; chunk++) {
+        auto* slot = findFreeSlot();
+        while (slot == nullptr && !cancelled) {
+            slotFreed.wait(50);
+            slot = findFreeSlot();
+            cancelled = !progress((double) chunk / (double) numChunks);
+        }
+        if (cancelled) {
+            break;
+        }
+
+        // Read and mix down here, the format reader isn't safe to share
+        auto firstFrame = chunk * FRAMES_PER_CHUNK;
+        slot->numFrames = (int) juce::jmin((juce::int64) FRAMES_PER_CHUNK, totalFrames - firstFrame);
+        auto numSamples = slot->numFrames * HOP_SIZE + FFT_SIZE - HOP_SIZE;
+
+        // Reading past the end fills with zeros
+        reader->read(&readBuffer, 0, numSamples, firstFrame * HOP_SIZE, true, true);
+
+        auto gain = 1.f / (float) numChannels;
+        juce::FloatVectorOperations::copyWithMultiply(slot->samples.data(), readBuffer.getReadPointer(0), gain, numSamples);
+        for (int ch = 1; ch < numChannels; ch++) {
+            juce::FloatVectorOperations::addWithMultiply(slot->samples.data(), readBuffer.getReadPointer(ch), gain, numSamples);
+        }
+
+        slot->busy.store(true, std::memory_order_release);
+        pool.addJob([slot, &window, &slotFreed] {
+            processChunk(*slot, window);
+            slot->busy.store(false, std::memory_order_release);
+            slotFreed.signal();
+        });
+
+        cancelled = !progress((double) chunk / (double) numChunks);
+    }
+
+    // The jobs use the slots and slotFreed, so they all have to be done even
+    // when cancelling. The pool only counts a job as gone once it's returned.
+    while (pool.getNumJobs() > 0) {
+        slotFreed.wait(50);
+    }
+
+    if (cancelled) {
+        return {};
+    }
+
+    std::vector<double> power ((size_t) NUM_BINS, 0.0);
+    juce::int64 numFramesSummed = 0;
+    for (auto* slot : slots) {
+        for (int bin = 0; bin < NUM_BINS; bin++) {
+            power[(size_t) bin] += slot->power[(size_t) bin];
+        }
+        numFramesSummed += slot->numFramesSummed;
+    }
+
+    // A full scale sine comes out at 0 dB: the Hann window's gain is 1/2,
+    // and each side of the spectrum gets half the amplitude
+    auto scale = 1.0 / (juce::jmax((juce::int64) 1, numFramesSummed) * (FFT_SIZE / 4.0) * (FFT_SIZE / 4.0));
+    for (auto& p : power) {
+        p *= scale;
+    }
+
+    progress(1.0);
+
+    Spectrum spectrum;
+    spectrum.sampleRate = reader->sampleRate;
+    spectrum.lengthInSamples = length;
+    spectrum.levelsDb = powerToPoints(power, reader->sampleRate);
+    return spectrum;
+}
+
+// Fitting Code
+//==============================================================================
+namespace
+{
+    using Curve = std::vector<double>;
+
+    // What the fit is trying to match, and which points count
+    struct Target
+    {
+        Curve levelsDb;
+        std::vector<bool> used;
+        int numUsed {0};
+    };
+
+    // The response in dB at every point of a band, as the plugin will design it
+    template<typename CoefficientType>
+    void addResponse(Curve& curve, const CoefficientType& coefficients, double sampleRate)
+    {
+        for (int point = 0; point < numPoints; point++) {
+            auto magnitude = coefficients.getMagnitudeForFrequency(getPointFrequency(point), sampleRate);
+            curve[(size_t) point] += juce::Decibels::gainToDecibels(magnitude, SILENCE_DB);
+        }
+    }
+
+    Curve getLowCutResponse(const ChainSettings& settings, double sampleRate)
+    {
+        Curve curve ((size_t) numPoints, 0.0);
+        auto coefficients = makeLowCutFilter(settings, sampleRate);
+        for (int i = 0; i <= settings.lowCutSlope; i++) {
+            addResponse(curve, *coefficients[i], sampleRate);
+        }
+        return curve;
+    }
+
+    Curve getHighCutResponse(const ChainSettings& settings, double sampleRate)
+    {
+        Curve curve ((size_t) numPoints, 0.0);
+        auto coefficients = makeHighCutFilter(settings, sampleRate);
+        for (int i = 0; i <= settings.highCutSlope; i++) {
+            addResponse(curve, *coefficients[i], sampleRate);
+        }
+        return curve;
+    }
+
+    Curve getPeakResponse(const ChainSettings& settings, double sampleRate)
+    {
+        Curve curve ((size_t) numPoints, 0.0);
+        addResponse(curve, *makePeakFilter(settings, sampleRate), sampleRate);
+        return curve;
+    }
+
+    // Variance over the points in use of target minus everything in curves.
+    // The bands can't change the overall level, so whatever constant offset
+    // fits best is never counted against them.
+    double getError(const Target& target, std::initializer_list<const Curve*> curves)
+    {
+        double sum = 0, sumOfSquares = 0;
+        for (int point = 0; point < numPoints; point++) {
+            if (!target.used[(size_t) point]) {
+                continue;
+            }
+            auto error = target.levelsDb[(size_t) point];
+            for (auto* curve : curves) {
+                error -= (*curve)[(size_t) point];
+            }
+            sum += error;
+            sumOfSquares += error * error;
+        }
+
+        auto n = (double) juce::jmax(1, target.numUsed);
+        auto mean = sum / n;
+        return sumOfSquares / n - mean * mean;
+    }
+
+    Curve add(const Curve& a, const Curve& b)
+    {
+        Curve sum (a);
+        for (size_t i = 0; i < sum.size(); i++) {
+            sum[i] += b[i];
+        }
+        return sum;
+    }
+
+    // Tries every slope at each candidate frequency, keeping the current
+    // setting unless something beats it
+    template<typename ApplyFunction, typename ResponseFunction>
+    void fitCut(ChainSettings& settings, float minFrequency, float maxFrequency,
+                ApplyFunction apply, ResponseFunction getResponse,
+                const Target& target, const Curve& others, double sampleRate)
+    {
+        static constexpr int NUM_FREQUENCIES = 48;
+
+        auto best = settings;
+        auto response = getResponse(settings, sampleRate);
+        auto currentError = getError(target, {&others, &response});
+        auto bestError = currentError;
+
+        for (int i = 0; i < NUM_FREQUENCIES; i++) {
+            auto frequency = juce::mapToLog10((double) i / (NUM_FREQUENCIES - 1), (double) minFrequency, (double) maxFrequency);
+
+            for (auto slope : {Slope_12, Slope_24, Slope_36, Slope_48}) {
+                auto trial = settings;
+                apply(trial, (float) frequency, slope);
+                response = getResponse(trial, sampleRate);
+
+                auto error = getError(target, {&others, &response});
+                if (error < bestError) {
+                    bestError = error;
+                    best = trial;
+                }
+            }
+        }
+
+        if (bestError < currentError - MIN_IMPROVEMENT) {
+            settings = best;
+        }
+    }
+
+    // Every PEAK_FREQUENCY_STEP-th point and a spread of Qs, each with the
+    // best gain found by golden section search. No gain at all is the
+    // setting to beat.
+    void fitPeak(ChainSettings& settings, const Target& target, const Curve& others, double sampleRate)
+    {
+        static constexpr float qualities[] = {0.3f, 0.5f, 0.7f, 1.f, 1.4f, 2.f, 3.f, 4.f, 6.f, 8.f};
+        static const double goldenRatio = (std::sqrt(5.0) - 1.0) / 2.0;
+
+        auto best = settings;
+        best.peakGainInDecibels = 0.f;
+        auto flatError = getError(target, {&others});
+        auto bestError = flatError;
+
+        for (int point = 0; point < numPoints; point += PEAK_FREQUENCY_STEP) {
+            auto frequency = getPointFrequency(point);
+            if (frequency >= sampleRate * 0.45) {
+                break;
+            }
+
+            for (auto quality : qualities) {
+                auto trial = settings;
+                trial.peakFreq = (float) frequency;
+                trial.peakQuality = quality;
+
+                auto errorForGain = [&trial, &target, &others, sampleRate](double gain) {
+                    trial.peakGainInDecibels = (float) gain;
+                    auto response = getPeakResponse(trial, sampleRate);
+                    return getError(target, {&others, &response});
+                };
+
+                double low = MIN_GAIN, high = MAX_GAIN;
+                auto x1 = high - goldenRatio * (high - low), x2 = low + goldenRatio * (high - low);
+                auto e1 = errorForGain(x1), e2 = errorForGain(x2);
+
+                for (int i = 0; i < GAIN_SEARCH_ITERATIONS; i++) {
+                    if (e1 < e2) {
+                        high = x2;
+                        x2 = x1;
+                        e2 = e1;
+                        x1 = high - goldenRatio * (high - low);
+                        e1 = errorForGain(x1);
+                    } else {
+                        low = x1;
+                        x1 = x2;
+                        e1 = e2;
+                        x2 = low + goldenRatio * (high - low);
+                        e2 = errorForGain(x2);
+                    }
+                }
+
+                auto gain = e1 < e2 ? x1 : x2;
+                auto error = juce::jmin(e1, e2);
+                if (error < bestError) {
+                    bestError = error;
+                    best = trial;
+                    best.peakGainInDecibels = (float) gain;
+                }
+            }
+        }
+
+        if (bestError < flatError - MIN_IMPROVEMENT) {
+            settings = best;
+        } else {
+            settings.peakGainInDecibels = 0.f;
+        }
+    }
+}
+
+ChainSettings fitChainSettings(const Spectrum& mix, const Spectrum& reference, double sampleRate, FilterDesign design)
+{
+    // Starts flat: cuts at the ends of their range, no peak gain
+    ChainSettings settings;
+    settings.filterDesign = design;
+    settings.lowCutFreq = MIN_FREQ;
+    settings.highCutFreq = MAX_FREQ;
+    settings.peakFreq = 750.f;
+
+    if (!mix.isValid() || !reference.isValid()) {
+        return settings;
+    }
+
+    // What the bands have to add to the mix. The overall level difference
+    // doesn't matter, see getError.
+    Target target;
+    target.levelsDb.resize((size_t) numPoints, 0.0);
+    target.used.resize((size_t) numPoints, false);
+
+    for (int point = 0; point < numPoints; point++) {
+        auto i = (size_t) point;
+        auto frequency = getPointFrequency(point);
+        if (mix.levelsDb[i] < FIT_FLOOR_DB || reference.levelsDb[i] < FIT_FLOOR_DB || frequency >= sampleRate * 0.45) {
+            continue;
+        }
+
+        target.levelsDb[i] = reference.levelsDb[i] - mix.levelsDb[i];
+        target.used[i] = true;
+        target.numUsed++;
+    }
+
+    if (target.numUsed == 0) {
+        return settings;
+    }
+
+    auto applyLowCut = [](ChainSettings& s, float frequency, Slope slope) { s.lowCutFreq = frequency; s.lowCutSlope = slope; };
+    auto applyHighCut = [](ChainSettings& s, float frequency, Slope slope) { s.highCutFreq = frequency; s.highCutSlope = slope; };
+
+    auto lowCut = getLowCutResponse(settings, sampleRate);
+    auto highCut = getHighCutResponse(settings, sampleRate);
+    Curve peak ((size_t) numPoints, 0.0);
+
+    // Each band against what the others leave, twice round so they can settle
+    for (int round = 0; round < 2; round++) {
+        fitCut(settings, MIN_FREQ, 2000.f, applyLowCut, getLowCutResponse, target, add(highCut, peak), sampleRate);
+        lowCut = getLowCutResponse(settings, sampleRate);
+
+        fitCut(settings, 1000.f, MAX_FREQ, applyHighCut, getHighCutResponse, target, add(lowCut, peak), sampleRate);
+        highCut = getHighCutResponse(settings, sampleRate);
+
+        fitPeak(settings, target, add(lowCut, highCut), sampleRate);
+        peak = getPeakResponse(settings, sampleRate);
+    }
+
+    return settings;
+}
+
+void applyToParameters(const ChainSettings& settings, juce::AudioProcessorValueTreeState& apvts, ChainPaths path)
+{
+    auto set = [&apvts, path](const juce::String& name, float value) {
+        if (auto* parameter = apvts.getParameter(getParameterID(name, path))) {
+            parameter->beginChangeGesture();
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+            parameter->endChangeGesture();
+        }
+    };
+
+    set("LowCut Freq", settings.lowCutFreq);
+    set("LowCut Slope", (float) settings.lowCutSlope);
+    set("Peak Freq", settings.peakFreq);
+    set("Peak Gain", settings.peakGainInDecibels);
+    set("Peak Quality", settings.peakQuality);
+    set("HighCut Freq", settings.highCutFreq);
+    set("HighCut Slope", (float) settings.highCutSlope);
+}
+
+// Task Code
+//==============================================================================
+Task::Task() : juce::Thread("Match analysis")
+{
+}
+
+Task::~Task()
+{
+    cancel();
+}
+
+void Task::start(const juce::File& newMixFile, const juce::File& newReferenceFile, double newSampleRate,
+                 FilterDesign newDesign, Callback onFinished)
+{
+    cancel();
+
+    mixFile = newMixFile;
+    referenceFile = newReferenceFile;
+    sampleRate = newSampleRate;
+    design = newDesign;
+    callback = std::move(onFinished);
+    progress = 0;
+
+    startThread(juce::Thread::Priority::low);
+}
+
+void Task::cancel()
+{
+    // Every wait in the analysis checks back at least every 50 ms
+    stopThread(5000);
+}
+
+void Task::run()
+{
+    TRACE_SCOPE("MatchAnalysis::Task::run");
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    // Leaves a core for the host and the audio thread
+    juce::ThreadPool pool (juce::jmax(1, juce::SystemStats::getNumCpus() - 1), 0, juce::Thread::Priority::low);
+
+    const juce::File* files[] = {&mixFile, &referenceFile};
+    Spectrum spectra[2];
+
+    for (int i = 0; i < 2; i++) {
+        spectra[i] = analyseFile(*files[i], formatManager, pool, [this, i](double fileProgress) {
+            progress.store((i + fileProgress) / 2.0, std::memory_order_relaxed);
+            return !threadShouldExit();
+        });
+
+        if (threadShouldExit()) {
+            return;
+        }
+        if (!spectra[i].isValid()) {
+            finished(false, {});
+            return;
+        }
+    }
+
+    // Before the plugin's been prepared, the mix's own rate is the best guess
+    auto settings = fitChainSettings(spectra[0], spectra[1], sampleRate > 0 ? sampleRate : spectra[0].sampleRate, design);
+
+    DBG("Match analysis: "
+        << spectra[0].lengthInSamples / spectra[0].sampleRate << " s and "
+        << spectra[1].lengthInSamples / spectra[1].sampleRate << " s of audio in "
+        << juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) << " s");
+
+    if (!threadShouldExit()) {
+        finished(true, settings);
+    }
+}
+
+void Task::finished(bool succeeded, const ChainSettings& settings)
+{
+    juce::WeakReference<Task> weakThis(this);
+
+    juce::MessageManager::callAsync([weakThis, succeeded, settings] {
+        if (auto* task = weakThis.get()) {
+            if (task->callback) {
+                task->callback(succeeded, settings);
+            }
+        }
+    });
+}
+
+}
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    MatchAnalysis.h
+
+    Offline match EQ: finds the band settings that bring a mix's tonal
+    balance closest to a reference track's.
+
+    Each file is streamed through juce_audio_formats one chunk at a time.
+    The chunks' FFT frames are spread over a thread pool and summed into a
+    long-term average spectrum, with only a fixed number of chunks in
+    memory however long the file is. The LowCut, Peak and HighCut settings
+    are then fitted to the difference between the two spectra.
+
+    Nothing in here runs on, or waits for, the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+namespace MatchAnalysis
+{
+    // The spectra are compared at this many log-spaced points from 20 Hz to 20 kHz
+    static constexpr int numPoints = 240;
+    double getPointFrequency(int point);
+
+    struct Spectrum
+    {
+        // Long-term average level around each point (1/6 octave), dB
+        // relative to a full scale sine. Points above Nyquist are silent.
+        std::vector<double> levelsDb;
+        double sampleRate {0};
+        juce::int64 lengthInSamples {0};
+
+        bool isValid() const { return !levelsDb.empty(); }
+    };
+
+    // Any thread but the audio thread, blocks until done. progress is called
+    // regularly with 0 to 1 and can return false to cancel. Returns an
+    // invalid Spectrum if the file can't be read or it was cancelled.
+    Spectrum analyseFile(const juce::File& file,
+                         juce::AudioFormatManager& formatManager,
+                         juce::ThreadPool& pool,
+                         const std::function<bool(double progress)>& progress);
+
+    // Band settings that turn mix's spectrum into reference's as closely as the
+    // bands allow, designed for sampleRate with the given FilterDesign. Overall
+    // level is ignored, and a band that doesn't help is left flat.
+    ChainSettings fitChainSettings(const Spectrum& mix, const Spectrum& reference, double sampleRate,
+                                   FilterDesign design = Design_Bilinear);
+
+    // Message thread. Sets the band parameters of one path as a host-visible change.
+    void applyToParameters(const ChainSettings& settings, juce::AudioProcessorValueTreeState& apvts, ChainPaths path);
+
+    // Analyses both files and fits the result on a background thread, with a
+    // thread pool of its own that only exists while it runs
+    class Task : private juce::Thread
+    {
+    public:
+        // Called on the message thread, unless the task is cancelled or destroyed first
+        using Callback = std::function<void(bool succeeded, const ChainSettings& settings)>;
+
+        Task();
+        ~Task() override;
+
+        // Message thread. Cancels any match still running.
+        void start(const juce::File& mixFile, const juce::File& referenceFile, double sampleRate,
+                   FilterDesign design, Callback onFinished);
+        void cancel();
+
+        bool isRunning() const { return isThreadRunning(); }
+        double getProgress() const { return progress.load(std::memory_order_relaxed); }
+
+    private:
+        void run() override;
+        void finished(bool succeeded, const ChainSettings& settings);
+
+        juce::File mixFile, referenceFile;
+        double sampleRate {44100.0};
+        FilterDesign design {Design_Bilinear};
+        Callback callback;
+        std::atomic<double> progress {0};
+
+        JUCE_DECLARE_WEAK_REFERENCEABLE(Task)
+    };
+}
@@ -0,0 +1,167 @@
+/*
+  ==============================================================================
+
+    MatchedBiquad.cpp
+
+  ==============================================================================
+*/
+
+#include "MatchedBiquad.h"
+
+// Keeps the centre frequency just under Nyquist, where the design still holds
+static constexpr double MAX_OMEGA = 0.9999 * juce::MathConstants<double>::pi;
+
+namespace MatchedBiquad
+{
+
+namespace
+{
+    // The digital magnitude squared at w, for a numerator or denominator
+    // b0 + b1 z^-1 + b2 z^-2, is B0 phi0 + B1 phi1 + B2 phi2 where
+    // B0 = (b0 + b1 + b2)^2, B1 = (b0 - b1 + b2)^2 and B2 = -4 b0 b2
+    struct Phi
+    {
+        double phi0, phi1, phi2;
+
+        explicit Phi(double omega)
+        {
+            auto s = std::sin(0.5 * omega);
+            phi1 = s * s;
+            phi0 = 1.0 - phi1;
+            phi2 = 4.0 * phi0 * phi1;
+        }
+
+        double weigh(double x0, double x1, double x2) const { return x0 * phi0 + x1 * phi1 + x2 * phi2; }
+    };
+
+    double getOmega(double sampleRate, double frequency)
+    {
+        return juce::jlimit(1.0e-6, MAX_OMEGA, juce::MathConstants<double>::twoPi * frequency / sampleRate);
+    }
+
+    // Poles of 1 / (s^2 + s / Q + 1) at w0, mapped by z = e^sT
+    void setPoles(Design& design, double omega, double quality)
+    {
+        auto zeta = 0.5 / quality;
+        auto decay = std::exp(-zeta * omega);
+
+        if (zeta <= 1.0) {
+            design.a1 = -2.0 * decay * std::cos(std::sqrt(1.0 - zeta * zeta) * omega);
+        } else {
+            design.a1 = -2.0 * decay * std::cosh(std::sqrt(zeta * zeta - 1.0) * omega);
+        }
+        design.a2 = decay * decay;
+    }
+
+    // The denominator's A0, A1 and A2 weighed at w0
+    double getDenominatorPower(const Design& design, const Phi& phi)
+    {
+        auto sum = 1.0 + design.a1 + design.a2;
+        auto difference = 1.0 - design.a1 + design.a2;
+        return phi.weigh(sum * sum, difference * difference, -4.0 * design.a2);
+    }
+}
+
+Design peak(double sampleRate, double frequency, double quality, double gainFactor) noexcept
+{
+    // makePeakFilter's prototype is (s^2 + s A / Q + 1) / (s^2 + s / (A Q) + 1)
+    // with A = sqrt(gain), so its poles have a Q of A Q
+    auto omega = getOmega(sampleRate, frequency);
+    auto A = std::sqrt(juce::jmax(1.0e-6, gainFactor));
+    Phi phi(omega);
+
+    Design design;
+    setPoles(design, omega, A * quality);
+
+    auto sum = 1.0 + design.a1 + design.a2;
+    auto difference = 1.0 - design.a1 + design.a2;
+    auto A0 = sum * sum, A1 = difference * difference, A2 = -4.0 * design.a2;
+    auto G2 = gainFactor * gainFactor;
+
+    // Unity at DC, the full gain at w0, and flat there (the peak's top)
+    auto R1 = phi.weigh(A0, A1, A2) * G2;
+    auto R2 = (-A0 + A1 + 4.0 * (phi.phi0 - phi.phi1) * A2) * G2;
+
+    auto B0 = A0;
+    auto B2 = (R1 - R2 * phi.phi1 - B0) / (4.0 * phi.phi1 * phi.phi1);
+    auto B1 = juce::jmax(0.0, R2 + B0 + 4.0 * (phi.phi1 - phi.phi0) * B2);
+
+    // Back from the squared magnitudes to b0, b1 and b2
+    auto W = 0.5 * (std::sqrt(B0) + std::sqrt(B1));
+    design.b0 = 0.5 * (W + std::sqrt(juce::jmax(0.0, W * W + B2)));
+    design.b1 = 0.5 * (std::sqrt(B0) - std::sqrt(B1));
+    design.b2 = -B2 / (4.0 * design.b0);
+    return design;
+}
+
+Design lowPass(double sampleRate, double frequency, double quality) noexcept
+{
+    auto omega = getOmega(sampleRate, frequency);
+    Phi phi(omega);
+
+    Design design;
+    setPoles(design, omega, quality);
+
+    // Unity at DC and Q at w0, with b2 = 0
+    auto sum = 1.0 + design.a1 + design.a2;
+    auto B0 = sum * sum;
+    auto R1 = getDenominatorPower(design, phi) * quality * quality;
+    auto B1 = juce::jmax(0.0, (R1 - B0 * phi.phi0) / phi.phi1);
+
+    design.b0 = 0.5 * (std::sqrt(B0) + std::sqrt(B1));
+    design.b1 = std::sqrt(B0) - design.b0;
+    design.b2 = 0.0;
+    return design;
+}
+
+Design highPass(double sampleRate, double frequency, double quality) noexcept
+{
+    auto omega = getOmega(sampleRate, frequency);
+    Phi phi(omega);
+
+    Design design;
+    setPoles(design, omega, quality);
+
+    // A double zero at DC, scaled for Q at w0
+    design.b0 = quality * std::sqrt(getDenominatorPower(design, phi)) / (4.0 * phi.phi1);
+    design.b1 = -2.0 * design.b0;
+    design.b2 = design.b0;
+    return design;
+}
+
+juce::dsp::IIR::Coefficients<float>::Ptr toCoefficients(const Design& design)
+{
+    return new juce::dsp::IIR::Coefficients<float>((float) design.b0, (float) design.b1, (float) design.b2,
+                                                    1.f, (float) design.a1, (float) design.a2);
+}
+
+// Butterworth Code
+//==============================================================================
+double getButterworthQuality(int section, int order) noexcept
+{
+    return 1.0 / (2.0 * std::cos((2.0 * section + 1.0) * juce::MathConstants<double>::pi / (order * 2.0)));
+}
+
+juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<float>> makeButterworthLowPass(float frequency, double sampleRate, int order)
+{
+    jassert(order > 0 && order % 2 == 0);
+
+    juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<float>> sections;
+    for (int i = 0; i < order / 2; i++) {
+        sections.add(toCoefficients(lowPass(sampleRate, frequency, getButterworthQuality(i, order))));
+    }
+    return sections;
+}
+
+juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<float>> makeButterworthHighPass(float frequency, double sampleRate, int order)
+{
+    jassert(order > 0 && order % 2 == 0);
+
+    juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<float>> sections;
+    for (int i = 0; i < order / 2; i++) {
+        sections.add(toCoefficients(highPass(sampleRate, frequency, getButterworthQuality(i, order))));
+    }
+    return sections;
+}
+
+}
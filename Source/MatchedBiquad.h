@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    MatchedBiquad.h
+
+    Second order sections that follow their analog prototype all the way up
+    to Nyquist, after Vicanek's "Matched Second Order Digital Filters". The
+    bilinear transform squashes the whole analog frequency axis below
+    Nyquist, so high peaks come out narrower and lopsided, and high cuts
+    fall to nothing at Nyquist instead of following their slope.
+
+    Here the poles are the analog poles mapped exactly (z = e^sT), and the
+    zeros are solved for so the magnitude matches the prototype's at DC,
+    at the centre or cutoff frequency and, for the peak, in its slope
+    there too. The result is still one biquad per section, so it costs
+    nothing extra to run, unlike oversampling.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace MatchedBiquad
+{
+    // Normalised biquad, b0 + b1 z^-1 + b2 z^-2 over 1 + a1 z^-1 + a2 z^-2
+    struct Design
+    {
+        double b0 {1}, b1 {0}, b2 {0}, a1 {0}, a2 {0};
+    };
+
+    // The same prototypes as juce::dsp::IIR::Coefficients' makePeakFilter,
+    // makeLowPass and makeHighPass. Cheap enough for the audio thread.
+    Design peak(double sampleRate, double frequency, double quality, double gainFactor) noexcept;
+    Design lowPass(double sampleRate, double frequency, double quality) noexcept;
+    Design highPass(double sampleRate, double frequency, double quality) noexcept;
+
+    juce::dsp::IIR::Coefficients<float>::Ptr toCoefficients(const Design& design);
+
+    // juce::dsp::FilterDesign's Q for each section of an even order Butterworth
+    double getButterworthQuality(int section, int order) noexcept;
+
+    // Drop-in for juce::dsp::FilterDesign's Butterworth methods, same
+    // sections and Qs, for an even order
+    juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<float>> makeButterworthLowPass(float frequency, double sampleRate, int order);
+    juce::ReferenceCountedArray<juce::dsp::IIR::Coefficients<float>> makeButterworthHighPass(float frequency, double sampleRate, int order);
+}
@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    MetricsExporter.cpp
+
+  ==============================================================================
+*/
+
+#include "MetricsExporter.h"
+
+bool MetricsExporter::open(const juce::String& segmentName)
+{
+    close();
+
+    layout = MetricsSegment::map(segmentName.toRawUTF8(), true);
+    if (layout == nullptr) {
+        DBG("Couldn't map metrics segment " << segmentName);
+        return false;
+    }
+
+    // Random, so instances stay apart even across processes that reuse a pid
+    auto instanceId = (juce::uint64) juce::Random::getSystemRandom().nextInt64();
+    slot = MetricsSegment::claim(*layout, instanceId);
+    if (slot == nullptr) {
+        DBG("Every slot of metrics segment " << segmentName << " is taken");
+        MetricsSegment::unmap(layout);
+        layout = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void MetricsExporter::close()
+{
+    // The processor only opens and closes from its constructor and
+    // destructor, when the audio thread can't be publishing
+    if (slot != nullptr) {
+        MetricsSegment::release(*slot);
+        slot = nullptr;
+    }
+    MetricsSegment::unmap(layout);
+    layout = nullptr;
+}
+
+void MetricsExporter::publish(const MetricsSegment::Metrics& metrics) noexcept
+{
+    if (slot != nullptr) {
+        MetricsSegment::write(*slot, metrics, juce::Time::currentTimeMillis());
+    }
+}
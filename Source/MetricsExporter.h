@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+    MetricsExporter.h
+
+    Publishes one processor instance's metrics into a slot of the shared
+    memory segment described in MetricsSegment.h, for
+    Tools/MetricsCollector.cpp to summarise across every host process on
+    the machine. Opt-in: the processor only opens one when
+    FIRSTJUCE_METRICS is set.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MetricsSegment.h"
+
+class MetricsExporter
+{
+public:
+    ~MetricsExporter() { close(); }
+
+    // Message thread. Maps the segment, creating it if this is the first
+    // instance to get there, and claims a slot. False if the segment
+    // can't be mapped or every slot is taken.
+    bool open(const juce::String& segmentName);
+    void close();
+    bool isOpen() const noexcept { return slot != nullptr; }
+
+    // Audio thread. Wait-free, a copy between two sequence bumps.
+    void publish(const MetricsSegment::Metrics& metrics) noexcept;
+
+private:
+    MetricsSegment::Layout* layout {nullptr};
+    MetricsSegment::Slot* slot {nullptr};
+};
@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    MetricsSegment.cpp
+
+  ==============================================================================
+*/
+
+#include "MetricsSegment.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MetricsSegment
+{
+
+// Header::magic while its creator is still filling it in
+static constexpr uint32_t INITIALISING = 1;
+// How long another process gets to finish creating the segment
+static constexpr int INITIALISE_WAIT_MS = 1000;
+
+// Mapping Code
+//==============================================================================
+Layout* map(const char* name, bool create)
+{
+    auto fd = shm_open(name, create ? (O_CREAT | O_RDWR) : O_RDONLY, 0644);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    // Whoever finds it empty sizes it. macOS only lets that happen once and
+    // says EINVAL to anyone who loses the race, which is fine.
+    struct stat status;
+    auto sized = fstat(fd, &status) == 0;
+    if (sized && status.st_size == 0 && create) {
+        if (ftruncate(fd, (off_t) sizeof(Layout)) != 0 && errno != EINVAL) {
+            close(fd);
+            return nullptr;
+        }
+        sized = fstat(fd, &status) == 0;
+    }
+
+    // macOS rounds the size up to whole pages
+    if (!sized || status.st_size < (off_t) sizeof(Layout)) {
+        close(fd);
+        return nullptr;
+    }
+
+    auto protection = create ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    auto* memory = mmap(nullptr, sizeof(Layout), protection, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto* layout = static_cast<Layout*>(memory);
+    auto& header = layout->header;
+
+    if (create) {
+        uint32_t expected = 0;
+        if (header.magic.compare_exchange_strong(expected, INITIALISING, std::memory_order_acq_rel)) {
+            header.formatVersion = formatVersion;
+            header.numSlots = (uint32_t) maxSlots;
+            header.slotBytes = (uint32_t) sizeof(Slot);
+            header.magic.store(magic, std::memory_order_release);
+        }
+    }
+
+    for (int i = 0; i < INITIALISE_WAIT_MS && header.magic.load(std::memory_order_acquire) == INITIALISING; i++) {
+        usleep(1000);
+    }
+
+    // Left behind by a different version, or never finished
+    if (header.magic.load(std::memory_order_acquire) != magic || header.formatVersion != formatVersion
+        || header.numSlots != (uint32_t) maxSlots || header.slotBytes != (uint32_t) sizeof(Slot)) {
+        unmap(layout);
+        return nullptr;
+    }
+
+    return layout;
+}
+
+void unmap(Layout* layout)
+{
+    if (layout != nullptr) {
+        munmap(layout, sizeof(Layout));
+    }
+}
+
+bool unlink(const char* name)
+{
+    return shm_unlink(name) == 0;
+}
+
+bool isProcessAlive(int32_t pid)
+{
+    // EPERM means it exists, it just belongs to someone else
+    return pid > 0 && (kill((pid_t) pid, 0) == 0 || errno == EPERM);
+}
+
+// Slot Code
+//==============================================================================
+Slot* claim(Layout& layout, uint64_t instanceId)
+{
+    auto pid = (int32_t) getpid();
+
+    for (auto& slot : layout.slots) {
+        auto owner = slot.pid.load(std::memory_order_acquire);
+        if (owner != 0 && isProcessAlive(owner)) {
+            continue;
+        }
+
+        if (slot.pid.compare_exchange_strong(owner, pid, std::memory_order_acq_rel)) {
+            // A process that died mid-write leaves the sequence odd
+            auto sequence = slot.sequence.load(std::memory_order_relaxed);
+            if ((sequence & 1) != 0) {
+                slot.sequence.store(sequence + 1, std::memory_order_release);
+            }
+
+            slot.instanceId.store(instanceId, std::memory_order_relaxed);
+            write(slot, Metrics(), 0);
+            layout.header.numClaims.fetch_add(1, std::memory_order_relaxed);
+            return &slot;
+        }
+    }
+
+    return nullptr;
+}
+
+void release(Slot& slot)
+{
+    slot.pid.store(0, std::memory_order_release);
+}
+
+void write(Slot& slot, const Metrics& metrics, int64_t nowMilliseconds) noexcept
+{
+    auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(&slot.metrics, &metrics, sizeof(Metrics));
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    slot.publishedMilliseconds.store(nowMilliseconds, std::memory_order_relaxed);
+}
+
+bool read(const Slot& slot, Metrics& metrics, int64_t& publishedMilliseconds, int maxAttempts) noexcept
+{
+    for (int attempt = 0; attempt < maxAttempts; attempt++) {
+        auto before = slot.sequence.load(std::memory_order_acquire);
+        if ((before & 1) != 0) {
+            continue;
+        }
+
+        std::memcpy(&metrics, &slot.metrics, sizeof(Metrics));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot.sequence.load(std::memory_order_relaxed) == before) {
+            publishedMilliseconds = slot.publishedMilliseconds.load(std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
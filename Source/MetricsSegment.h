@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    MetricsSegment.h
+
+    The layout of the POSIX shared memory segment MetricsExporter publishes
+    into and the metrics collector (Tools/MetricsCollector.cpp) reads. Every
+    processor instance on the machine claims one slot, so one read of the
+    segment shows the load of every instance in every host process.
+
+    A slot is written by its instance's audio thread and nobody else, under
+    a sequence number: odd while a write is in progress. Writing is a copy
+    between two increments, so it never waits; a reader copies the slot
+    out and tries again if the sequence moved underneath it.
+
+    No JUCE in here, so the collector builds on its own.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace MetricsSegment
+{
+    static constexpr uint32_t magic = 0x534d4a46; // "FJMS"
+    static constexpr uint32_t formatVersion = 1;
+    static constexpr int maxSlots = 256;
+    // macOS allows 31 characters at most
+    static constexpr const char* defaultName = "/firstjuce-metrics";
+
+    // One path's bands as the processor last designed them
+    struct Bands
+    {
+        float lowCutFreq, peakFreq, peakGainDb, peakQuality, highCutFreq;
+        // 12, 24, 36 or 48 dB/Oct
+        int32_t lowCutSlope, highCutSlope;
+        int32_t peakDynamic;
+    };
+
+    // Everything an instance publishes, plain data so it can be copied
+    // in and out in one go
+    struct Metrics
+    {
+        double sampleRate;
+        int32_t maxBlockSize, lastBlockSize, numChannels;
+        // StereoMode and FilterDesign, as the processor has them
+        int32_t stereoMode, filterDesign;
+        // 1 for linked stereo, otherwise the right/side path is bands[1]
+        int32_t numPaths;
+        Bands bands[2];
+
+        // See ProcessingStats::Snapshot
+        int64_t numBlocks, deadlineMisses;
+        double lastLoad, meanLoad, maxLoad;
+        double meanBlockMicroseconds, maxBlockMicroseconds;
+        int32_t qualityTier;
+        int64_t qualityTierChanges;
+    };
+
+    struct alignas(64) Slot
+    {
+        // The owning process, 0 while the slot is free
+        std::atomic<int32_t> pid;
+        std::atomic<uint64_t> instanceId;
+        std::atomic<uint32_t> sequence;
+        // Wall clock, so a collector can tell a host that stopped processing
+        std::atomic<int64_t> publishedMilliseconds;
+        Metrics metrics;
+    };
+
+    struct Header
+    {
+        // 0 until the creator has filled in the rest
+        std::atomic<uint32_t> magic;
+        uint32_t formatVersion, numSlots, slotBytes;
+        // Every slot ever claimed, reclaimed ones included
+        std::atomic<uint32_t> numClaims;
+    };
+
+    struct Layout
+    {
+        Header header;
+        Slot slots[maxSlots];
+    };
+
+    static_assert(std::atomic<int32_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free
+                  && std::atomic<int64_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+                  "Atomics in shared memory have to be lock free to work across processes");
+
+    // Maps the segment, creating it first if asked to. nullptr on failure.
+    Layout* map(const char* name, bool create);
+    void unmap(Layout* layout);
+    // Removes the name; processes that have it mapped keep their mapping
+    bool unlink(const char* name);
+
+    // A free slot, or one whose process has died, for this process.
+    // nullptr if all of them are taken.
+    Slot* claim(Layout& layout, uint64_t instanceId);
+    void release(Slot& slot);
+
+    // Owner's audio thread only. Wait-free.
+    void write(Slot& slot, const Metrics& metrics, int64_t nowMilliseconds) noexcept;
+    // Any process. False if the slot kept changing for every attempt.
+    bool read(const Slot& slot, Metrics& metrics, int64_t& publishedMilliseconds, int maxAttempts = 16) noexcept;
+
+    // Whether pid still exists, as far as this process can tell
+    bool isProcessAlive(int32_t pid);
+}
@@ -0,0 +1,374 @@
+/*
+  ==============================================================================
+
+    MidiControl.cpp
+
+  ==============================================================================
+*/
+
+#include "MidiControl.h"
+
+// Controllers with a fixed meaning in the (N)RPN protocol
+static constexpr int CC_DATA_ENTRY_MSB = 6;
+static constexpr int CC_DATA_ENTRY_LSB = 38;
+static constexpr int CC_NRPN_LSB = 98;
+static constexpr int CC_NRPN_MSB = 99;
+static constexpr int CC_RPN_LSB = 100;
+static constexpr int CC_RPN_MSB = 101;
+
+static constexpr float MAX_7_BIT = 127.f;
+static constexpr float MAX_14_BIT = 16383.f;
+
+// How often the parameters catch up with MIDI on the message thread
+static constexpr int NOTIFY_HOST_HZ = 30;
+// Normalised values are never negative
+static constexpr float NO_PENDING_VALUE = -1.f;
+
+juce::String MidiControl::Source::getDescription() const
+{
+    switch (type) {
+        case Source_CC7: return "CC " + juce::String(number) + ", channel " + juce::String(channel);
+        case Source_CC14: return "CC " + juce::String(number) + " (14-bit), channel " + juce::String(channel);
+        case Source_NRPN: return "NRPN " + juce::String(number) + ", channel " + juce::String(channel);
+        default: break;
+    }
+    return {};
+}
+
+juce::uint32 MidiControl::pack(SourceType type, int channel, int number) noexcept
+{
+    return 0x80000000u | ((juce::uint32) type << 24) | ((juce::uint32) (channel - 1) << 16) | (juce::uint32) number;
+}
+
+MidiControl::Source MidiControl::unpack(juce::uint32 packed) noexcept
+{
+    return {static_cast<SourceType>((packed >> 24) & 0x7f), (int) ((packed >> 16) & 0xff) + 1, (int) (packed & 0xffff)};
+}
+
+void MidiControl::setParameters(const juce::Array<juce::AudioProcessorParameter*>& newParameters,
+                                juce::AudioProcessorValueTreeState& apvts)
+{
+    parameters = newParameters;
+    mappings.reset(new std::atomic<juce::uint32>[(size_t) parameters.size()]);
+    pendingValues.reset(new std::atomic<float>[(size_t) parameters.size()]);
+    rawValues.assign((size_t) parameters.size(), nullptr);
+    rangedParameters.assign((size_t) parameters.size(), nullptr);
+
+    for (int i = 0; i < parameters.size(); i++) {
+        mappings[(size_t) i].store(0, std::memory_order_relaxed);
+        pendingValues[(size_t) i].store(NO_PENDING_VALUE, std::memory_order_relaxed);
+
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameters.getUnchecked(i))) {
+            rangedParameters[(size_t) i] = ranged;
+            rawValues[(size_t) i] = apvts.getRawParameterValue(ranged->getParameterID());
+        }
+    }
+
+    startTimerHz(NOTIFY_HOST_HZ);
+}
+
+void MidiControl::prepare(int maxBlockSize)
+{
+    // A segment can only start every minSegmentSamples, and each one holds
+    // at most one change per parameter, so these never run out
+    segments.resize((size_t) (maxBlockSize / minSegmentSamples + 1));
+    changes.resize(segments.size() * (size_t) juce::jmax(1, parameters.size()));
+
+    for (auto& channel : channels) {
+        channel = ChannelState();
+    }
+}
+
+// Mapping Code
+//==============================================================================
+bool MidiControl::getMapping(int parameterIndex, Source& source) const noexcept
+{
+    if (!juce::isPositiveAndBelow(parameterIndex, parameters.size())) {
+        return false;
+    }
+
+    auto packed = mappings[(size_t) parameterIndex].load(std::memory_order_acquire);
+    if (packed == 0) {
+        return false;
+    }
+    source = unpack(packed);
+    return true;
+}
+
+void MidiControl::removeMapping(int parameterIndex) noexcept
+{
+    if (juce::isPositiveAndBelow(parameterIndex, parameters.size())) {
+        mappings[(size_t) parameterIndex].store(0, std::memory_order_release);
+    }
+}
+
+juce::uint32 MidiControl::getPackedMapping(int parameterIndex) const noexcept
+{
+    return juce::isPositiveAndBelow(parameterIndex, parameters.size()) ? mappings[(size_t) parameterIndex].load(std::memory_order_acquire) : 0;
+}
+
+void MidiControl::setPackedMapping(int parameterIndex, juce::uint32 packed) noexcept
+{
+    if (juce::isPositiveAndBelow(parameterIndex, parameters.size())) {
+        mappings[(size_t) parameterIndex].store(packed, std::memory_order_release);
+    }
+}
+
+static juce::String getParameterId(juce::AudioProcessorParameter* parameter)
+{
+    if (auto* withId = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter)) {
+        return withId->getParameterID();
+    }
+    return {};
+}
+
+juce::ValueTree MidiControl::toValueTree() const
+{
+    juce::ValueTree tree(treeType);
+
+    for (int i = 0; i < parameters.size(); i++) {
+        Source source;
+        if (getMapping(i, source)) {
+            juce::ValueTree mapping("Mapping");
+            mapping.setProperty("id", getParameterId(parameters.getUnchecked(i)), nullptr);
+            mapping.setProperty("type", (int) source.type, nullptr);
+            mapping.setProperty("channel", source.channel, nullptr);
+            mapping.setProperty("number", source.number, nullptr);
+            tree.appendChild(mapping, nullptr);
+        }
+    }
+
+    return tree;
+}
+
+void MidiControl::fromValueTree(const juce::ValueTree& tree)
+{
+    for (int i = 0; i < parameters.size(); i++) {
+        mappings[(size_t) i].store(0, std::memory_order_release);
+    }
+
+    for (auto mapping : tree) {
+        auto id = mapping.getProperty("id").toString();
+        auto type = (int) mapping.getProperty("type", -1);
+        auto channel = (int) mapping.getProperty("channel", 0);
+        auto number = (int) mapping.getProperty("number", -1);
+
+        // Skips anything a newer version wrote that this one doesn't know
+        if (type < Source_CC7 || type > Source_NRPN || channel < 1 || channel > 16 || number < 0 || number > 16383) {
+            continue;
+        }
+
+        for (int i = 0; i < parameters.size(); i++) {
+            if (getParameterId(parameters.getUnchecked(i)) == id) {
+                mappings[(size_t) i].store(pack(static_cast<SourceType>(type), channel, number), std::memory_order_release);
+                break;
+            }
+        }
+    }
+}
+
+// Event Code
+//==============================================================================
+int MidiControl::process(const juce::MidiBuffer& midi, int numSamples) noexcept
+{
+    jassert(!segments.empty());
+
+    blockSamples = numSamples;
+    segments[0] = {0, numSamples, 0, 0};
+    numSegments = 1;
+    numChanges = 0;
+
+    for (const auto metadata : midi) {
+        // Raw bytes, so nothing here builds a MidiMessage
+        auto* data = metadata.data;
+        if (metadata.numBytes < 3 || (data[0] & 0xf0) != 0xb0) {
+            continue;
+        }
+
+        auto channel = (data[0] & 0x0f) + 1;
+        auto controller = (int) data[1];
+        auto value = (int) data[2];
+        auto& state = channels[channel - 1];
+        auto sample = metadata.samplePosition;
+
+        switch (controller) {
+            case CC_NRPN_MSB:
+                state.nrpnMsb = value;
+                state.rpnSelected = false;
+                continue;
+            case CC_NRPN_LSB:
+                state.nrpnLsb = value;
+                state.rpnSelected = false;
+                continue;
+            case CC_RPN_MSB:
+            case CC_RPN_LSB:
+                // RPNs are for pitch bend range and the like, not for us
+                state.rpnSelected = true;
+                continue;
+            default:
+                break;
+        }
+
+        auto nrpnSelected = !state.rpnSelected && state.nrpnMsb >= 0 && state.nrpnLsb >= 0;
+        auto isDataEntry = controller == CC_DATA_ENTRY_MSB || controller == CC_DATA_ENTRY_LSB;
+
+        if (isDataEntry && (nrpnSelected || state.rpnSelected)) {
+            if (state.rpnSelected) {
+                continue;
+            }
+            auto number = (state.nrpnMsb << 7) | state.nrpnLsb;
+            if (controller == CC_DATA_ENTRY_MSB) {
+                state.dataMsb = value;
+                controllerChanged(sample, Source_NRPN, channel, number, (float) (value << 7) / MAX_14_BIT);
+            } else {
+                controllerChanged(sample, Source_NRPN, channel, number, (float) ((state.dataMsb << 7) | value) / MAX_14_BIT);
+            }
+            continue;
+        }
+
+        if (controller < 32) {
+            // An MSB on its own counts as the LSB being 0
+            state.ccMsb[controller] = value;
+            controllerChanged(sample, Source_CC7, channel, controller, (float) value / MAX_7_BIT);
+            controllerChanged(sample, Source_CC14, channel, controller, (float) (value << 7) / MAX_14_BIT);
+        } else if (controller < 64) {
+            auto msbController = controller - 32;
+
+            // Its MSB's 7-bit mappings turn out to be 14-bit
+            auto upgraded = pack(Source_CC14, channel, msbController);
+            for (int i = 0; i < parameters.size(); i++) {
+                auto expected = pack(Source_CC7, channel, msbController);
+                mappings[(size_t) i].compare_exchange_strong(expected, upgraded, std::memory_order_acq_rel);
+            }
+
+            auto combined = (state.ccMsb[msbController] << 7) | value;
+            controllerChanged(sample, Source_CC14, channel, msbController, (float) combined / MAX_14_BIT);
+            controllerChanged(sample, Source_CC7, channel, controller, (float) value / MAX_7_BIT);
+        } else {
+            controllerChanged(sample, Source_CC7, channel, controller, (float) value / MAX_7_BIT);
+        }
+    }
+
+    for (int i = 0; i < numSegments; i++) {
+        auto end = i + 1 < numSegments ? segments[(size_t) i + 1].start : numSamples;
+        segments[(size_t) i].numSamples = end - segments[(size_t) i].start;
+    }
+
+    return numSegments;
+}
+
+void MidiControl::controllerChanged(int sample, SourceType type, int channel, int number, float value) noexcept
+{
+    auto key = pack(type, channel, number);
+
+    // A 14-bit CC is learnt as 7-bit from its MSB, and upgraded when its LSB arrives
+    auto learnable = type != Source_CC14;
+    if (learnable && learningParameter.load(std::memory_order_relaxed) >= 0) {
+        auto parameterIndex = learningParameter.exchange(-1, std::memory_order_acq_rel);
+        if (juce::isPositiveAndBelow(parameterIndex, parameters.size())) {
+            // One controller drives one parameter
+            for (int i = 0; i < parameters.size(); i++) {
+                auto expected = key;
+                mappings[(size_t) i].compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+            }
+            mappings[(size_t) parameterIndex].store(key, std::memory_order_release);
+        }
+    }
+
+    for (int i = 0; i < parameters.size(); i++) {
+        if (mappings[(size_t) i].load(std::memory_order_relaxed) == key) {
+            addChange(sample, i, value);
+        }
+    }
+}
+
+void MidiControl::addChange(int sample, int parameterIndex, float value) noexcept
+{
+    sample = juce::jlimit(0, juce::jmax(0, blockSamples - 1), sample);
+
+    // A new segment only once the current one is long enough, otherwise the
+    // change joins it and happens a little early
+    if (sample - segments[(size_t) numSegments - 1].start >= minSegmentSamples && numSegments < (int) segments.size()) {
+        segments[(size_t) numSegments++] = {sample, 0, numChanges, 0};
+    }
+
+    auto& segment = segments[(size_t) numSegments - 1];
+    for (int i = segment.firstChange; i < segment.firstChange + segment.numChanges; i++) {
+        if (changes[(size_t) i].parameterIndex == parameterIndex) {
+            changes[(size_t) i].value = value;
+            return;
+        }
+    }
+
+    if (numChanges < (int) changes.size()) {
+        changes[(size_t) numChanges++] = {parameterIndex, value};
+        segment.numChanges++;
+    }
+}
+
+bool MidiControl::applyChanges(int segmentIndex) noexcept
+{
+    auto& segment = segments[(size_t) segmentIndex];
+    for (int i = segment.firstChange; i < segment.firstChange + segment.numChanges; i++) {
+        auto& change = changes[(size_t) i];
+        auto index = (size_t) change.parameterIndex;
+
+        // Pending first, then what processBlock reads, straight away; apvts
+        // does the same conversion when the parameter catches up. notifyHost()
+        // relies on this order (see restoreLatest()).
+        pendingValues[index].store(change.value, std::memory_order_seq_cst);
+        if (auto* raw = rawValues[index]) {
+            raw->store(rangedParameters[index]->convertFrom0to1(change.value), std::memory_order_seq_cst);
+        }
+    }
+
+    if (segment.numChanges > 0) {
+        notificationPending.store(true, std::memory_order_release);
+    }
+    return segment.numChanges > 0;
+}
+
+// Notification Code
+//==============================================================================
+void MidiControl::notifyHost()
+{
+    if (!notificationPending.exchange(false, std::memory_order_acquire)) {
+        return;
+    }
+
+    for (int i = 0; i < parameters.size(); i++) {
+        auto value = pendingValues[(size_t) i].exchange(NO_PENDING_VALUE, std::memory_order_seq_cst);
+        if (value != NO_PENDING_VALUE) {
+            parameters.getUnchecked(i)->setValueNotifyingHost(value);
+            restoreLatest(i);
+        }
+    }
+}
+
+void MidiControl::restoreLatest(int parameterIndex) noexcept
+{
+    auto* raw = rawValues[(size_t) parameterIndex];
+    if (raw == nullptr) {
+        return;
+    }
+
+    // setValueNotifyingHost() has just had apvts write this value to the raw
+    // value, from here. If the audio thread moved the parameter on meanwhile
+    // its newer raw value may have landed first and been overwritten, and
+    // processBlock would hear the old one until the next notifyHost().
+    // Any raw value the audio thread wrote before ours had its pending value
+    // stored before it, so it shows up here; keep putting back the latest
+    // until that stops changing.
+    auto& pending = pendingValues[(size_t) parameterIndex];
+    auto latest = pending.load(std::memory_order_seq_cst);
+
+    while (latest != NO_PENDING_VALUE) {
+        raw->store(rangedParameters[(size_t) parameterIndex]->convertFrom0to1(latest), std::memory_order_seq_cst);
+
+        auto again = pending.load(std::memory_order_seq_cst);
+        if (again == latest) {
+            break;
+        }
+        latest = again;
+    }
+}
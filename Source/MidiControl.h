@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    MidiControl.h
+
+    MIDI learn for every parameter: 7-bit CCs, 14-bit CCs (MSB 0-31 with
+    its LSB 32-63) and NRPNs. A parameter learns from the next controller
+    that arrives; a 7-bit CC mapping becomes 14-bit by itself as soon as
+    the matching LSB shows up.
+
+    Each block's controller changes become segments, so processBlock can
+    set the parameters and redesign the filters exactly at the sample a
+    change arrived. Changes closer together than minSegmentSamples go into
+    the same segment, applied at its start, so a dense controller stream
+    costs no more than a redesign every minSegmentSamples.
+
+    The mappings are plain atomics, one per parameter, so the message
+    thread and the audio thread never wait for each other.
+
+    A change sets the parameter's raw value in the AudioProcessorValueTreeState
+    on the audio thread, which is all processBlock reads. The parameter
+    itself, and through it the host and the editor, only follows from the
+    message thread, where a timer passes on the latest value of everything
+    MIDI has moved since it last ran.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class MidiControl : private juce::Timer
+{
+public:
+    static constexpr int minSegmentSamples = 32;
+
+    enum SourceType
+    {
+        Source_CC7,
+        Source_CC14,
+        Source_NRPN
+    };
+
+    // What a parameter listens to. channel is 1-16; number is the CC
+    // (the MSB for 14-bit) or the NRPN number.
+    struct Source
+    {
+        SourceType type {Source_CC7};
+        int channel {1};
+        int number {0};
+
+        juce::String getDescription() const;
+    };
+
+    struct Change
+    {
+        int parameterIndex;
+        float value;
+    };
+
+    struct Segment
+    {
+        int start, numSamples;
+        int firstChange, numChanges;
+    };
+
+    // Message thread, from the processor's constructor. Parameters apvts
+    // doesn't have are still notified, they just lag the audio.
+    void setParameters(const juce::Array<juce::AudioProcessorParameter*>& parameters,
+                       juce::AudioProcessorValueTreeState& apvts);
+    // Message thread, from prepareToPlay
+    void prepare(int maxBlockSize);
+
+    // Message thread. The next controller to arrive is mapped to the parameter.
+    void startLearning(int parameterIndex) noexcept { learningParameter.store(parameterIndex, std::memory_order_release); }
+    void stopLearning() noexcept { learningParameter.store(-1, std::memory_order_release); }
+    int getLearningParameter() const noexcept { return learningParameter.load(std::memory_order_acquire); }
+
+    // Message thread
+    bool getMapping(int parameterIndex, Source& source) const noexcept;
+    void removeMapping(int parameterIndex) noexcept;
+    juce::ValueTree toValueTree() const;
+    void fromValueTree(const juce::ValueTree& tree);
+
+    // A mapping as one word, 0 for none, for SessionCapture to log and
+    // SessionReplay to restore. Any thread.
+    int getNumParameters() const noexcept { return parameters.size(); }
+    juce::uint32 getPackedMapping(int parameterIndex) const noexcept;
+    void setPackedMapping(int parameterIndex, juce::uint32 packed) noexcept;
+
+    // Message thread. Sets every parameter MIDI has moved since the last
+    // call, notifying the host; the timer started by setParameters calls it.
+    // SessionReplay stops the timer, since a capture already holds the
+    // parameter changes it led to, at the blocks they happened before.
+    void notifyHost();
+    void stopNotificationTimer() { stopTimer(); }
+
+    // Audio thread. Splits the block at its controller changes and returns
+    // the number of segments, at least 1, which cover the block in order.
+    int process(const juce::MidiBuffer& midi, int numSamples) noexcept;
+    const Segment& getSegment(int index) const noexcept { return segments[(size_t) index]; }
+    // Audio thread. Sets the raw values of the segment's parameters and
+    // leaves the rest to notifyHost(); false if it has none.
+    bool applyChanges(int segmentIndex) noexcept;
+
+    static inline const juce::Identifier treeType {"MidiMappings"};
+
+private:
+    // A Source packed into one word, so a mapping can be swapped atomically.
+    // 0 means unmapped.
+    static juce::uint32 pack(SourceType type, int channel, int number) noexcept;
+    static Source unpack(juce::uint32 packed) noexcept;
+
+    void controllerChanged(int sample, SourceType type, int channel, int number, float value) noexcept;
+    void addChange(int sample, int parameterIndex, float value) noexcept;
+    void timerCallback() override { notifyHost(); }
+    // Message thread, after notifying the parameter's new value
+    void restoreLatest(int parameterIndex) noexcept;
+
+    juce::Array<juce::AudioProcessorParameter*> parameters;
+    std::unique_ptr<std::atomic<juce::uint32>[]> mappings;
+    std::atomic<int> learningParameter {-1};
+
+    // Per parameter: apvts's raw value (nullptr if it has none) and the
+    // parameter for converting to it, and the normalised value still to be
+    // passed on by notifyHost()
+    std::vector<std::atomic<float>*> rawValues;
+    std::vector<juce::RangedAudioParameter*> rangedParameters;
+    std::unique_ptr<std::atomic<float>[]> pendingValues;
+    std::atomic<bool> notificationPending {false};
+
+    // Running (N)RPN and 14-bit CC state, per channel
+    struct ChannelState
+    {
+        int nrpnMsb {-1}, nrpnLsb {-1};
+        bool rpnSelected {false};
+        int dataMsb {0};
+        int ccMsb[32] {};
+    };
+    ChannelState channels[16];
+
+    std::vector<Segment> segments;
+    std::vector<Change> changes;
+    int numSegments {0}, numChanges {0}, blockSamples {0};
+};
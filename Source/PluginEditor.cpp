@@ -11,6 +11,14 @@
 
 // Look and Feel Code
 //==============================================================================
+const juce::Font& LookAndFeel::getLabelFont(float height)
+{
+    if (labelFont.getHeight() != height) {
+        labelFont = juce::Font(height);
+    }
+    return labelFont;
+}
+
 void LookAndFeel::drawRotarySlider(juce::Graphics &g,
                                    int x,
                                    int y,
@@ -25,13 +33,14 @@ void LookAndFeel::drawRotarySlider(juce::Graphics &g,
     
     auto bounds = Rectangle<float>(x, y, width, height);
     
-    g.setColour(Colour(97u, 18u, 167u));
-    g.fillEllipse(bounds);
-    
-    g.setColour(Colour(255u, 147u, 1u));
-    g.drawEllipse(bounds, 1.f);
+    auto* rswl = dynamic_cast<RotarySliderWithLabels*>(&slider);
+    if (rswl != nullptr) {
+        rswl->drawFace(g, bounds);
+    } else {
+        drawKnobFace(g, bounds);
+    }
     
-    if (auto* rswl = dynamic_cast<RotarySliderWithLabels*>(&slider)) {
+    if (rswl != nullptr) {
         auto center = bounds.getCentre();
         
         Path p;
@@ -52,7 +61,7 @@ void LookAndFeel::drawRotarySlider(juce::Graphics &g,
         
         g.fillPath(p);
         
-        g.setFont(rswl->getTextHeight());
+        g.setFont(getLabelFont(rswl->getTextHeight()));
         auto text = rswl->getDisplayString();
         auto strWidth = g.getCurrentFont().getStringWidth(text);
         
@@ -68,6 +77,18 @@ void LookAndFeel::drawRotarySlider(juce::Graphics &g,
 }
 
 
+void LookAndFeel::drawKnobFace(juce::Graphics& g, juce::Rectangle<float> bounds)
+{
+    using namespace juce;
+    
+    g.setColour(Colour(97u, 18u, 167u));
+    g.fillEllipse(bounds);
+    
+    g.setColour(Colour(255u, 147u, 1u));
+    g.drawEllipse(bounds, 1.f);
+}
+
+
 // Rotary Slider Code
 //==============================================================================
 void RotarySliderWithLabels::paint(juce::Graphics &g)
@@ -105,24 +126,29 @@ void RotarySliderWithLabels::paint(juce::Graphics &g)
     auto radius = sliderBounds.getWidth() / 2;
     
     g.setColour(Colours::green);
-    g.setFont(getTextHeight());
     
-    auto numChoices = labels.size();
-    for (int i = 0; i < numChoices; i++) {
-        auto pos = labels[i].pos;
-        jassert(0.f <= pos && pos <= 1.f);
-        
-        auto angle = jmap(pos, 0.f, 1.f, startAngle, endAngle);
-        auto c = center.getPointOnCircumference(radius + getTextHeight() / 2 + 1, angle);
+    if (labelGlyphs.getNumGlyphs() == 0) {
+        const auto& font = lnf->getLabelFont(getTextHeight());
         
-        Rectangle<float> r;
-        auto str = labels[i].label;
-        r.setSize(g.getCurrentFont().getStringWidth(str), getTextHeight());
-        r.setCentre(c);
-        r.setY(r.getY() + getTextHeight());
-        
-        g.drawFittedText(str, r.toNearestInt(), juce::Justification::centred, 1);
+        auto numChoices = labels.size();
+        for (int i = 0; i < numChoices; i++) {
+            auto pos = labels[i].pos;
+            jassert(0.f <= pos && pos <= 1.f);
+            
+            auto angle = jmap(pos, 0.f, 1.f, startAngle, endAngle);
+            auto c = center.getPointOnCircumference(radius + getTextHeight() / 2 + 1, angle);
+            
+            Rectangle<float> r;
+            auto str = labels[i].label;
+            r.setSize(font.getStringWidth(str), getTextHeight());
+            r.setCentre(c);
+            r.setY(r.getY() + getTextHeight());
+            
+            labelGlyphs.addFittedText(font, str, r.getX(), r.getY(), r.getWidth(), r.getHeight(), juce::Justification::centred, 1);
+        }
     }
+    
+    labelGlyphs.draw(g);
 }
 
 juce::Rectangle<int> RotarySliderWithLabels::getSliderBounds() const
@@ -174,8 +200,16 @@ juce::String RotarySliderWithLabels::getDisplayString() const
 //==============================================================================
 ResponseCurveComponent::ResponseCurveComponent(FirstJUCEpluginAudioProcessor& p) : audioProcessor(p)
 {
-    const auto& parameters = audioProcessor.getParameters();
-    for (auto parameter : parameters) {
+    for (auto path : {ChainPaths::LeftOrMid, ChainPaths::RightOrSide}) {
+        for (auto name : {"LowCut Freq", "HighCut Freq", "Peak Freq", "Peak Gain", "Peak Quality", "LowCut Slope", "HighCut Slope", "Peak Dynamic"}) {
+            if (auto* parameter = audioProcessor.apvts.getParameter(getParameterID(name, path))) {
+                curveParameters.add(parameter);
+                parameter->addListener(this);
+            }
+        }
+    }
+    if (auto* parameter = audioProcessor.apvts.getParameter("Filter Design")) {
+        curveParameters.add(parameter);
         parameter->addListener(this);
     }
     updateChain();
@@ -184,10 +218,11 @@ ResponseCurveComponent::ResponseCurveComponent(FirstJUCEpluginAudioProcessor& p)
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
-    const auto& parameters = audioProcessor.getParameters();
-    for (auto parameter : parameters) {
+    for (auto* parameter : curveParameters) {
         parameter->removeListener(this);
     }
+    // Stops its thread and stops the processor feeding it
+    spectrogram.reset();
 }
 
 void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float newValue)
@@ -200,80 +235,104 @@ void ResponseCurveComponent::timerCallback()
     if (parametersChanged.compareAndSetBool(false, true)) {
         // update the monochain
         updateChain();
+        responseCurveNeedsUpdate = true;
         // signal the repaint
         repaint();
+    } else if (peakIsDynamic && std::abs(audioProcessor.getDynamicPeakGain(path) - shownPeakGain) > 0.1f) {
+        updateChain();
+        responseCurveNeedsUpdate = true;
+        repaint();
+    }
+    
+    if (spectrogramVisible) {
+        // The analyzer is the first thing to give way under CPU pressure
+        auto reduced = audioProcessor.getQualityTier() >= Quality_ReducedDisplay;
+        spectrogram->setDecimation(reduced ? 2 : 1);
+        
+        if (spectrogram->updateImage()) {
+            repaint(getAnalysisArea());
+        }
     }
 }
 
-void ResponseCurveComponent::updateChain()
+void ResponseCurveComponent::setSpectrogramVisible(bool shouldBeVisible)
 {
-    auto chainSettings = getChainSettings(audioProcessor.apvts);
-    auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-    updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    if (shouldBeVisible == spectrogramVisible) {
+        return;
+    }
+    spectrogramVisible = shouldBeVisible;
+    
+    if (spectrogramVisible) {
+        if (spectrogram == nullptr) {
+            spectrogram = std::make_unique<SpectrogramAnalyzer>(audioProcessor.getAnalyzerFifo());
+        }
+        spectrogram->start();
+    } else {
+        spectrogram->stop();
+    }
     
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
-    updateCutFilter(monoChain.get<ChainPositions::LowCut>(), lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(monoChain.get<ChainPositions::HighCut>(), highCutCoefficients, chainSettings.highCutSlope);
+    repaint();
+}
+
+void ResponseCurveComponent::setPath(ChainPaths newPath)
+{
+    path = newPath;
+    parametersChanged.set(true);
+}
+
+void ResponseCurveComponent::updateChain()
+{
+    peakIsDynamic = audioProcessor.apvts.getRawParameterValue(getParameterID("Peak Dynamic", path))->load() > 0.5f;
+    shownPeakGain = audioProcessor.getDynamicPeakGain(path);
+    responseSnapshot = audioProcessor.getResponseSnapshot(path);
 }
 
 void ResponseCurveComponent::paint (juce::Graphics& g)
 {
+    TRACE_SCOPE("ResponseCurveComponent::paint");
     using namespace juce;
     
-    g.drawImage(background, getLocalBounds().toFloat());
+    backgroundCache.draw(g, getLocalBounds().toFloat());
 
-//    auto responseArea = getLocalBounds();
-//    auto responseArea = getRenderArea();
-    auto responseArea = getAnalysisArea();
-
-    auto w = responseArea.getWidth();
+    if (spectrogramVisible) {
+        spectrogram->draw(g, getAnalysisArea(), 0.85f);
+    }
 
-    auto& lowCut = monoChain.get<ChainPositions::LowCut>();
-    auto& peak = monoChain.get<ChainPositions::Peak>();
-    auto& highCut = monoChain.get<ChainPositions::HighCut>();
+    if (responseCurveNeedsUpdate) {
+        updateResponseCurve();
+    }
 
-    auto sampleRate = audioProcessor.getSampleRate();
+    g.setColour(Colours::orange);
+    g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
 
-    std::vector<double> magnitudes(w);
+    g.setColour(Colours::white);
+    g.strokePath(responseCurve, PathStrokeType(2.f));
+}
 
-    for (int i = 0; i < w; i++) {
-        double magnitude = 1.f;
-        auto frequency = mapToLog10(double(i) / double(w), 20.0, 20000.0);
-        if (!monoChain.isBypassed<ChainPositions::Peak>()) {
-            magnitude *= peak.coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
+void ResponseCurveComponent::updateResponseCurve()
+{
+    TRACE_SCOPE("ResponseCurveComponent::updateResponseCurve");
+    using namespace juce;
+    responseCurveNeedsUpdate = false;
 
-        if (!lowCut.isBypassed<0>()) {
-            magnitude *= lowCut.get<0>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!lowCut.isBypassed<1>()) {
-            magnitude *= lowCut.get<1>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!lowCut.isBypassed<2>()) {
-            magnitude *= lowCut.get<2>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!lowCut.isBypassed<3>()) {
-            magnitude *= lowCut.get<3>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
+//    auto responseArea = getLocalBounds();
+//    auto responseArea = getRenderArea();
+    auto responseArea = getAnalysisArea();
 
-        if (!highCut.isBypassed<0>()) {
-            magnitude *= highCut.get<0>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!highCut.isBypassed<1>()) {
-            magnitude *= highCut.get<1>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!highCut.isBypassed<2>()) {
-            magnitude *= highCut.get<2>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!highCut.isBypassed<3>()) {
-            magnitude *= highCut.get<3>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
+    auto w = responseArea.getWidth();
+    if (w <= 0) {
+        responseCurve.clear();
+        return;
+    }
 
-        magnitudes[i] = Decibels::gainToDecibels(magnitude);
+    // One point per pixel, all evaluated in one go
+    if ((int) responseFrequencies.size() != w) {
+        responseFrequencies = FrequencyResponse::makeLogFrequencies(w, 20.0, 20000.0);
     }
+    magnitudes.resize((size_t) w);
+    FrequencyResponse::evaluate(responseSnapshot, responseFrequencies.data(), w, magnitudes.data(), nullptr, nullptr);
     
-    Path responseCurve;
+    responseCurve.clear();
 
     const double outputMin = responseArea.getBottom();
     const double outputMax = responseArea.getY();
@@ -282,25 +341,27 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
         return jmap(input, -24.0, 24.0, outputMin, outputMax);
     };
 
-    responseCurve.startNewSubPath(responseArea.getX(), map(magnitudes.front()));
+    responseCurve.startNewSubPath(responseArea.getX(), map(jmax(magnitudes.front(), -100.0)));
 
     for (size_t i = 1; i < magnitudes.size(); i++) {
-        responseCurve.lineTo(responseArea.getX() + i, map(magnitudes[i]));
+        responseCurve.lineTo(responseArea.getX() + i, map(jmax(magnitudes[i], -100.0)));
     }
-
-    g.setColour(Colours::orange);
-    g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
-
-    g.setColour(Colours::white);
-    g.strokePath(responseCurve, PathStrokeType(2.f));
 }
 
 void ResponseCurveComponent::resized()
 {
+    TRACE_SCOPE("ResponseCurveComponent::resized");
+    // backgroundCache picks up the new size on the next paint
+    responseCurveNeedsUpdate = true;
+}
+
+void ResponseCurveComponent::renderBackground(juce::Graphics& g, juce::Rectangle<float> bounds)
+{
+    TRACE_SCOPE("ResponseCurveComponent::renderBackground");
     using namespace juce;
-    background = Image(Image::PixelFormat::RGB, getWidth(), getHeight(), true);
     
-    Graphics g(background);
+    g.fillAll(Colours::black);
+    
     Array<float> frequencies
     {
         20, /*30, 40,*/ 50, 100,
@@ -309,7 +370,7 @@ void ResponseCurveComponent::resized()
         20000
     };
     
-    auto renderArea = getAnalysisArea();
+    auto renderArea = getAnalysisArea(bounds.toNearestInt());
     auto left = renderArea.getX();
     auto right = renderArea.getRight();
     auto top = renderArea.getY();
@@ -380,7 +441,7 @@ void ResponseCurveComponent::resized()
         
         Rectangle<int> r;
         r.setSize(textWidth, fontHeight);
-        r.setX(getWidth() - textWidth);
+        r.setX(roundToInt(bounds.getRight()) - textWidth);
         r.setCentre(r.getCentreX(), y);
         
         g.setColour(gdB == 0.f ? Colours::green : Colours::lightgrey);
@@ -393,8 +454,17 @@ void ResponseCurveComponent::resized()
 
 juce::Rectangle<int> ResponseCurveComponent::getRenderArea()
 {
-    auto bounds = getLocalBounds();
-    
+    return getRenderArea(getLocalBounds());
+}
+
+juce::Rectangle<int> ResponseCurveComponent::getAnalysisArea()
+{
+    return getAnalysisArea(getLocalBounds());
+}
+
+juce::Rectangle<int> ResponseCurveComponent::getRenderArea(juce::Rectangle<int> bounds)
+{
+
 //    bounds.reduce(10, 8);
 //    bounds.reduce(JUCE_LIVE_CONSTANT(5),
 //                  JUCE_LIVE_CONSTANT(5));
@@ -407,9 +477,9 @@ juce::Rectangle<int> ResponseCurveComponent::getRenderArea()
     return bounds;
 }
 
-juce::Rectangle<int> ResponseCurveComponent::getAnalysisArea()
+juce::Rectangle<int> ResponseCurveComponent::getAnalysisArea(juce::Rectangle<int> bounds)
 {
-    auto bounds = getRenderArea();
+    bounds = getRenderArea(bounds);
     
     bounds.removeFromTop(4);
     bounds.removeFromBottom(4);
@@ -418,6 +488,104 @@ juce::Rectangle<int> ResponseCurveComponent::getAnalysisArea()
 }
 
 
+// Level Meter Component Code
+//==============================================================================
+LevelMeterComponent::LevelMeterComponent(FirstJUCEpluginAudioProcessor& p) : audioProcessor(p)
+{
+    startTimerHz(30);
+}
+
+void LevelMeterComponent::update(Display& display, LevelMeter::Readings& readings)
+{
+    auto toDecibels = [](float gain) { return juce::Decibels::gainToDecibels(gain, LevelMeter::SILENCE); };
+    
+    // Peaks are taken (and reset) so nothing between two frames gets missed,
+    // then fall back at about 20 dB a second
+    constexpr float fallPerFrame = 20.f / 30.f;
+    auto peak = toDecibels(readings.peak.exchange(0, std::memory_order_relaxed));
+    auto truePeak = toDecibels(readings.truePeak.exchange(0, std::memory_order_relaxed));
+    display.peak = juce::jmax(peak, display.peak - fallPerFrame);
+    display.truePeak = juce::jmax(truePeak, display.truePeak - fallPerFrame);
+    
+    display.rms = toDecibels(readings.rms.load(std::memory_order_relaxed));
+    display.momentary = readings.momentaryLoudness.load(std::memory_order_relaxed);
+    display.shortTerm = readings.shortTermLoudness.load(std::memory_order_relaxed);
+}
+
+void LevelMeterComponent::timerCallback()
+{
+    // Under CPU pressure the meters drop to 10 Hz. Peaks are held until
+    // they're taken, so none get missed.
+    tier = audioProcessor.getQualityTier();
+    if (tier >= Quality_ReducedDisplay && ++frameCount % 3 != 0) {
+        return;
+    }
+    
+    update(input, audioProcessor.getInputLevels());
+    update(output, audioProcessor.getOutputLevels());
+    repaint();
+}
+
+void LevelMeterComponent::paint(juce::Graphics& g)
+{
+    TRACE_SCOPE("LevelMeterComponent::paint");
+    using namespace juce;
+    
+    g.fillAll(Colours::black);
+    
+    auto bounds = getLocalBounds().reduced(4);
+    
+    if (tier != Quality_Full) {
+        g.setColour(Colours::orange);
+        g.setFont(10);
+        g.drawFittedText(getQualityTierName(tier), bounds.removeFromBottom(12), Justification::centred, 1);
+    }
+    
+    auto inputArea = bounds.removeFromLeft(bounds.getWidth() / 2);
+    
+    drawMeter(g, inputArea, "In", input);
+    drawMeter(g, bounds, "Out", output);
+}
+
+void LevelMeterComponent::drawMeter(juce::Graphics& g, juce::Rectangle<int> bounds, const juce::String& name, const Display& display)
+{
+    using namespace juce;
+    
+    const float minDb = -60.f, maxDb = 6.f;
+    const int fontHeight = 10;
+    g.setFont(fontHeight);
+    
+    g.setColour(Colours::lightgrey);
+    g.drawFittedText(name, bounds.removeFromTop(fontHeight + 2), Justification::centred, 1);
+    
+    // Readouts under the bar: true peak, momentary and short-term loudness
+    auto format = [](float value) { return value <= LevelMeter::SILENCE ? String("-inf") : String(value, 1); };
+    auto textArea = bounds.removeFromBottom(3 * (fontHeight + 2));
+    for (auto text : {"TP " + format(display.truePeak), "M " + format(display.momentary), "S " + format(display.shortTerm)}) {
+        g.drawFittedText(text, textArea.removeFromTop(fontHeight + 2), Justification::centred, 1);
+    }
+    
+    auto bar = bounds.reduced(bounds.getWidth() / 4, 2).toFloat();
+    g.setColour(Colours::darkgrey);
+    g.fillRect(bar);
+    
+    auto levelToY = [&](float db) {
+        return jmap(jlimit(minDb, maxDb, db), minDb, maxDb, bar.getBottom(), bar.getY());
+    };
+    
+    // RMS as the body, sample peak as a line, red once it's over
+    auto rmsY = levelToY(display.rms);
+    g.setColour(Colours::dodgerblue);
+    g.fillRect(bar.withTop(rmsY));
+    
+    g.setColour(display.peak > 0 ? Colours::red : Colours::white);
+    g.drawHorizontalLine((int) levelToY(display.peak), bar.getX(), bar.getRight());
+    
+    g.setColour(Colours::dimgrey);
+    g.drawHorizontalLine((int) levelToY(0), bar.getX(), bar.getRight());
+}
+
+
 // Plugin Editor Code
 //==============================================================================
 FirstJUCEpluginAudioProcessorEditor::FirstJUCEpluginAudioProcessorEditor (FirstJUCEpluginAudioProcessor& p)
@@ -429,15 +597,44 @@ lowCutFreqSlider(*audioProcessor.apvts.getParameter("LowCut Freq"), "Hz"),
 highCutFreqSlider(*audioProcessor.apvts.getParameter("HighCut Freq"), "Hz"),
 lowCutSlopeSlider(*audioProcessor.apvts.getParameter("LowCut Slope"), "dB/Oct"),
 highCutSlopeSlider(*audioProcessor.apvts.getParameter("HighCut Slope"), "dB/Oct"),
+peakThresholdSlider(*audioProcessor.apvts.getParameter("Peak Threshold"), "dB"),
+peakRatioSlider(*audioProcessor.apvts.getParameter("Peak Ratio"), ":1"),
+peakAttackSlider(*audioProcessor.apvts.getParameter("Peak Attack"), "ms"),
+peakReleaseSlider(*audioProcessor.apvts.getParameter("Peak Release"), "ms"),
 responseCurveComponent(audioProcessor),
-peakFreqSliderAttachment(audioProcessor.apvts, "Peak Freq", peakFreqSlider),
-peakGainSliderAttachment(audioProcessor.apvts, "Peak Gain", peakGainSlider),
-peakQualitySliderAttachment(audioProcessor.apvts, "Peak Quality", peakQualitySlider),
-lowCutFreqSliderAttachment(audioProcessor.apvts, "LowCut Freq", lowCutFreqSlider),
-highCutFreqSliderAttachment(audioProcessor.apvts, "HighCut Freq", highCutFreqSlider),
-lowCutSlopeSliderAttachment(audioProcessor.apvts, "LowCut Slope", lowCutSlopeSlider),
-highCutSlopeSliderAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlopeSlider)
+levelMeterComponent(audioProcessor)
 {
+    attachSliders(ChainPaths::LeftOrMid);
+    
+    if (auto* modeParameter = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.apvts.getParameter("Stereo Mode"))) {
+        stereoModeBox.addItemList(modeParameter->choices, 1);
+    }
+    stereoModeAttachment = std::make_unique<APVTS::ComboBoxAttachment>(audioProcessor.apvts, "Stereo Mode", stereoModeBox);
+    if (auto* designParameter = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.apvts.getParameter("Filter Design"))) {
+        filterDesignBox.addItemList(designParameter->choices, 1);
+    }
+    filterDesignAttachment = std::make_unique<APVTS::ComboBoxAttachment>(audioProcessor.apvts, "Filter Design", filterDesignBox);
+    meteringAttachment = std::make_unique<APVTS::ButtonAttachment>(audioProcessor.apvts, "Metering", meteringButton);
+    peakSidechainAttachment = std::make_unique<APVTS::ButtonAttachment>(audioProcessor.apvts, "Peak Sidechain", peakSidechainButton);
+    
+    for (auto* button : {&leftMidButton, &rightSideButton}) {
+        button->setRadioGroupId(1);
+        button->setClickingTogglesState(true);
+    }
+    leftMidButton.setToggleState(true, juce::dontSendNotification);
+    leftMidButton.onClick = [this] { attachSliders(ChainPaths::LeftOrMid); };
+    rightSideButton.onClick = [this] { attachSliders(ChainPaths::RightOrSide); };
+    spectrogramButton.onClick = [this] { responseCurveComponent.setSpectrogramVisible(spectrogramButton.getToggleState()); };
+    matchButton.onClick = [this] {
+        if (matchTask.isRunning()) {
+            matchTask.cancel();
+            stopTimer();
+            matchButton.setButtonText("Match...");
+        } else {
+            chooseMatchFiles();
+        }
+    };
+    
     
     peakFreqSlider.labels.add({0.f, "20Hz"});
     peakFreqSlider.labels.add({1.f, "20kHz"});
@@ -460,9 +657,31 @@ highCutSlopeSliderAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlope
     highCutSlopeSlider.labels.add({0.f, "12"});
     highCutSlopeSlider.labels.add({1.f, "48"});
     
+    peakThresholdSlider.labels.add({0.f, "-60dB"});
+    peakThresholdSlider.labels.add({1.f, "0dB"});
+    
+    peakRatioSlider.labels.add({0.f, "1:1"});
+    peakRatioSlider.labels.add({1.f, "20:1"});
+    
+    peakAttackSlider.labels.add({0.f, "0.1ms"});
+    peakAttackSlider.labels.add({1.f, "100ms"});
+    
+    peakReleaseSlider.labels.add({0.f, "5ms"});
+    peakReleaseSlider.labels.add({1.f, "1s"});
+    
     for (auto* comp : getComps()) {
         addAndMakeVisible(comp);
+        
+        if (auto* slider = dynamic_cast<RotarySliderWithLabels*>(comp)) {
+            slider->onPopupMenu = [this, slider] { showMidiMenu(*slider); };
+        }
     }
+    setWantsKeyboardFocus(true);
+    
+    // Any size within reason, keeping the original proportions
+    setResizable(true, true);
+    setResizeLimits(WIDTH * 3 / 4, HEIGHT * 3 / 4, WIDTH * 5 / 2, HEIGHT * 5 / 2);
+    getConstrainer()->setFixedAspectRatio((double) WIDTH / (double) HEIGHT);
     setSize (WIDTH, HEIGHT);
 }
 
@@ -470,12 +689,46 @@ FirstJUCEpluginAudioProcessorEditor::~FirstJUCEpluginAudioProcessorEditor()
 {
 }
 
+void FirstJUCEpluginAudioProcessorEditor::showMidiMenu(RotarySliderWithLabels& slider)
+{
+    // The processor outlives the menu, the editor might not
+    auto& midiControl = audioProcessor.getMidiControl();
+    auto index = slider.getParameter().getParameterIndex();
+    auto learning = midiControl.getLearningParameter() == index;
+    
+    juce::PopupMenu menu;
+    menu.addSectionHeader(slider.getParameter().getName(64));
+    menu.addItem(learning ? "Cancel MIDI Learn" : "MIDI Learn", [&midiControl, index, learning] {
+        if (learning) {
+            midiControl.stopLearning();
+        } else {
+            midiControl.startLearning(index);
+        }
+    });
+    
+    MidiControl::Source source;
+    if (midiControl.getMapping(index, source)) {
+        menu.addItem("Forget " + source.getDescription(), [&midiControl, index] { midiControl.removeMapping(index); });
+    }
+    
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&slider));
+}
+
 //==============================================================================
 void FirstJUCEpluginAudioProcessorEditor::paint (juce::Graphics& g)
 {
     g.fillAll(juce::Colours::black);
 }
 
+void FirstJUCEpluginAudioProcessorEditor::paintOverChildren (juce::Graphics&)
+{
+    // Children are done too by now, so this is a whole frame
+    if (!firstFrameDrawn) {
+        firstFrameDrawn = true;
+        audioProcessor.editorFirstFrameDrawn(openTicks);
+    }
+}
+
 void FirstJUCEpluginAudioProcessorEditor::resized()
 {
     // This is generally where you'll want to lay out the positions of any
@@ -487,6 +740,30 @@ void FirstJUCEpluginAudioProcessorEditor::resized()
     
     responseCurveComponent.setBounds(responseArea);
     
+    auto stereoArea = bounds.removeFromTop(28).reduced(4);
+    stereoModeBox.setBounds(stereoArea.removeFromLeft(100));
+    stereoArea.removeFromLeft(8);
+    leftMidButton.setBounds(stereoArea.removeFromLeft(50));
+    rightSideButton.setBounds(stereoArea.removeFromLeft(50));
+    stereoArea.removeFromLeft(8);
+    filterDesignBox.setBounds(stereoArea.removeFromLeft(130));
+    meteringButton.setBounds(stereoArea.removeFromRight(80));
+    spectrogramButton.setBounds(stereoArea.removeFromRight(110));
+    matchButton.setBounds(stereoArea.removeFromRight(100));
+    
+    levelMeterComponent.setBounds(bounds.removeFromRight(110));
+    
+    auto dynamicsArea = bounds.removeFromBottom(bounds.getHeight() / 4);
+    auto dynamicsButtonArea = dynamicsArea.removeFromLeft(90).reduced(4);
+    peakDynamicButton.setBounds(dynamicsButtonArea.removeFromTop(dynamicsButtonArea.getHeight() / 2));
+    peakSidechainButton.setBounds(dynamicsButtonArea);
+    
+    auto dynamicsKnobWidth = dynamicsArea.getWidth() / 4;
+    peakThresholdSlider.setBounds(dynamicsArea.removeFromLeft(dynamicsKnobWidth));
+    peakRatioSlider.setBounds(dynamicsArea.removeFromLeft(dynamicsKnobWidth));
+    peakAttackSlider.setBounds(dynamicsArea.removeFromLeft(dynamicsKnobWidth));
+    peakReleaseSlider.setBounds(dynamicsArea);
+    
     auto lowCutArea = bounds.removeFromLeft(bounds.getWidth() * 0.33);
     auto highCutArea = bounds.removeFromRight(bounds.getWidth() * 0.5);
     
@@ -500,6 +777,132 @@ void FirstJUCEpluginAudioProcessorEditor::resized()
     peakQualitySlider.setBounds(bounds);
 }
 
+bool FirstJUCEpluginAudioProcessorEditor::keyPressed(const juce::KeyPress& key)
+{
+    auto traceKey = juce::KeyPress('t', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0);
+    auto captureKey = juce::KeyPress('r', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0);
+    
+    if (key == captureKey) {
+        if (audioProcessor.isCapturing()) {
+            audioProcessor.stopCapture();
+            DBG("Session capture stopped");
+            return true;
+        }
+        
+        // Parameters only, a log with audio is for FIRSTJUCE_CAPTURE_AUDIO
+        auto time = juce::Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S");
+        auto file = juce::File::getSpecialLocation(juce::File::userDesktopDirectory)
+            .getChildFile(juce::String(JucePlugin_Name) + " session " + time + ".fjcp");
+        if (audioProcessor.startCapture(file, false)) {
+            DBG("Capturing session to " << file.getFullPathName());
+        }
+        return true;
+    }
+    
+    if (key != traceKey) {
+        return false;
+    }
+    
+    auto& recorder = TraceRecorder::getInstance();
+    if (!recorder.isEnabled()) {
+        recorder.setEnabled(true);
+        return true;
+    }
+    
+    // Keeps recording, so it can be pressed again after the next glitch
+    auto file = recorder.getDefaultDumpFile();
+    if (recorder.dumpToFile(file)) {
+        DBG("Trace written to " << file.getFullPathName());
+    }
+    return true;
+}
+
+void FirstJUCEpluginAudioProcessorEditor::attachSliders(ChainPaths path)
+{
+    auto& apvts = audioProcessor.apvts;
+    
+    auto attach = [&apvts, path](std::unique_ptr<Attachment>& attachment,
+                                 RotarySliderWithLabels& slider,
+                                 const juce::String& name) {
+        // The old attachment has to let go of the slider before a new one takes it
+        attachment.reset();
+        auto parameterID = getParameterID(name, path);
+        slider.setParameter(*apvts.getParameter(parameterID));
+        attachment = std::make_unique<Attachment>(apvts, parameterID, slider);
+    };
+    
+    attach(peakFreqSliderAttachment, peakFreqSlider, "Peak Freq");
+    attach(peakGainSliderAttachment, peakGainSlider, "Peak Gain");
+    attach(peakQualitySliderAttachment, peakQualitySlider, "Peak Quality");
+    attach(lowCutFreqSliderAttachment, lowCutFreqSlider, "LowCut Freq");
+    attach(highCutFreqSliderAttachment, highCutFreqSlider, "HighCut Freq");
+    attach(lowCutSlopeSliderAttachment, lowCutSlopeSlider, "LowCut Slope");
+    attach(highCutSlopeSliderAttachment, highCutSlopeSlider, "HighCut Slope");
+    attach(peakThresholdSliderAttachment, peakThresholdSlider, "Peak Threshold");
+    attach(peakRatioSliderAttachment, peakRatioSlider, "Peak Ratio");
+    attach(peakAttackSliderAttachment, peakAttackSlider, "Peak Attack");
+    attach(peakReleaseSliderAttachment, peakReleaseSlider, "Peak Release");
+    
+    peakDynamicAttachment.reset();
+    peakDynamicAttachment = std::make_unique<APVTS::ButtonAttachment>(apvts, getParameterID("Peak Dynamic", path), peakDynamicButton);
+    
+    responseCurveComponent.setPath(path);
+    editedPath = path;
+}
+
+void FirstJUCEpluginAudioProcessorEditor::chooseMatchFiles()
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    auto wildcard = formats.getWildcardForAllFormats();
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+    
+    mixChooser = std::make_unique<juce::FileChooser>("Choose the mix to match", juce::File(), wildcard);
+    mixChooser->launchAsync(flags, [this, wildcard, flags](const juce::FileChooser& chooser) {
+        auto mixFile = chooser.getResult();
+        if (mixFile == juce::File()) {
+            return;
+        }
+        
+        referenceChooser = std::make_unique<juce::FileChooser>("Choose the reference", mixFile.getParentDirectory(), wildcard);
+        referenceChooser->launchAsync(flags, [this, mixFile](const juce::FileChooser& result) {
+            auto referenceFile = result.getResult();
+            if (referenceFile == juce::File()) {
+                return;
+            }
+            
+            // Applies to whichever path was being edited when the match started
+            auto path = editedPath;
+            matchTask.start(mixFile, referenceFile, audioProcessor.getSampleRate(),
+                            getChainSettings(audioProcessor.apvts).filterDesign,
+                            [this, path](bool succeeded, const ChainSettings& settings) {
+                                matchFinished(succeeded, settings, path);
+                            });
+            startTimerHz(10);
+            timerCallback();
+        });
+    });
+}
+
+void FirstJUCEpluginAudioProcessorEditor::matchFinished(bool succeeded, const ChainSettings& settings, ChainPaths path)
+{
+    stopTimer();
+    matchButton.setButtonText("Match...");
+    
+    if (succeeded) {
+        MatchAnalysis::applyToParameters(settings, audioProcessor.apvts, path);
+    } else {
+        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,
+                                               "Match EQ",
+                                               "One of the files couldn't be read.");
+    }
+}
+
+void FirstJUCEpluginAudioProcessorEditor::timerCallback()
+{
+    matchButton.setButtonText("Matching " + juce::String(juce::roundToInt(matchTask.getProgress() * 100.0)) + "%");
+}
+
 std::vector<juce::Component*> FirstJUCEpluginAudioProcessorEditor::getComps()
 {
     return
@@ -511,6 +914,20 @@ std::vector<juce::Component*> FirstJUCEpluginAudioProcessorEditor::getComps()
         &highCutFreqSlider,
         &lowCutSlopeSlider,
         &highCutSlopeSlider,
-        &responseCurveComponent
+        &peakThresholdSlider,
+        &peakRatioSlider,
+        &peakAttackSlider,
+        &peakReleaseSlider,
+        &peakDynamicButton,
+        &peakSidechainButton,
+        &responseCurveComponent,
+        &levelMeterComponent,
+        &stereoModeBox,
+        &filterDesignBox,
+        &leftMidButton,
+        &rightSideButton,
+        &meteringButton,
+        &spectrogramButton,
+        &matchButton
     };
 }
@@ -10,18 +10,30 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "LayerCache.h"
+#include "MatchAnalysis.h"
 
 const int HEIGHT = 600;
 const int WIDTH = 800;
 
+// One of these is shared by every slider, see RotarySliderWithLabels
 struct LookAndFeel : juce::LookAndFeel_V4
 {
+    // Built once rather than on every paint
+    const juce::Font& getLabelFont(float height);
+    
+    // The part of a knob that never moves, cached by each RotarySliderWithLabels
+    static void drawKnobFace(juce::Graphics& g, juce::Rectangle<float> bounds);
+    
     void drawRotarySlider (juce::Graphics&,
                            int x, int y, int width, int height,
                            float sliderPosProportional,
                            float rotaryStartAngle,
                            float rotaryEndAngle,
                            juce::Slider&) override;
+    
+private:
+    juce::Font labelFont {14.f};
 };
 
 struct RotarySliderWithLabels : juce::Slider
@@ -31,7 +43,7 @@ struct RotarySliderWithLabels : juce::Slider
                  juce::Slider::TextEntryBoxPosition::NoTextBox),
     parameter(&rap), suffix(unitSuffix)
     {
-        setLookAndFeel(&lnf);
+        setLookAndFeel(&lnf.get());
     }
     ~RotarySliderWithLabels()
     {
@@ -50,9 +62,38 @@ struct RotarySliderWithLabels : juce::Slider
     juce::Rectangle<int> getSliderBounds() const;
     int getTextHeight() const {return 14;}
     juce::String getDisplayString() const;
+    void setParameter(juce::RangedAudioParameter& rap) { parameter = &rap; repaint(); }
+    juce::RangedAudioParameter& getParameter() const { return *parameter; }
+    
+    // Right-click (or ctrl-click) calls this instead of starting a drag
+    std::function<void()> onPopupMenu;
+    void mouseDown(const juce::MouseEvent& event) override
+    {
+        if (event.mods.isPopupMenu() && onPopupMenu) {
+            onPopupMenu();
+            return;
+        }
+        juce::Slider::mouseDown(event);
+    }
+    void resized() override
+    {
+        juce::Slider::resized();
+        labelGlyphs.clear();
+    }
+    
+    // The face is drawn from a cache, a pixel bigger all round for the outline
+    void drawFace(juce::Graphics& g, juce::Rectangle<float> bounds) { faceCache.draw(g, bounds.expanded(1.f)); }
 private:
-    LookAndFeel lnf;
+    // Shared by every slider (and every editor), it's created with the first
+    // one and goes away with the last
+    juce::SharedResourcePointer<LookAndFeel> lnf;
     juce::RangedAudioParameter* parameter;
+    // The min/max labels never change, so they're only laid out on resize
+    juce::GlyphArrangement labelGlyphs;
+    
+    LayerCache faceCache {*this, [](juce::Graphics& g, juce::Rectangle<float> bounds) {
+        LookAndFeel::drawKnobFace(g, bounds.reduced(1.f));
+    }};
     juce::String suffix;
 };
 
@@ -66,20 +107,78 @@ struct ResponseCurveComponent : juce::Component, juce::AudioProcessorParameter::
     void timerCallback() override;
     void paint(juce::Graphics& g) override;
     void resized() override;
+    // Which set of band settings the curve shows
+    void setPath(ChainPaths newPath);
+    // Scrolling spectrogram of the output behind the curve
+    void setSpectrogramVisible(bool shouldBeVisible);
 private:
     FirstJUCEpluginAudioProcessor& audioProcessor;
     juce::Atomic<bool> parametersChanged {false};
-    MonoChain monoChain;
+    ChainPaths path {ChainPaths::LeftOrMid};
+    FrequencyResponse::Snapshot responseSnapshot;
     void updateChain();
-    juce::Image background;
+    
+    // A dynamic Peak band is drawn where the dynamics currently have it
+    bool peakIsDynamic {false};
+    float shownPeakGain {0.f};
+    
+    // Only the parameters the curve depends on are listened to
+    juce::Array<juce::RangedAudioParameter*> curveParameters;
+    
+    // Grid and labels. Rendered on the first paint, so nothing is drawn
+    // before the editor is actually on screen, then again in the background
+    // whenever the size or display scale changes.
+    LayerCache backgroundCache {*this, renderBackground};
+    static void renderBackground(juce::Graphics& g, juce::Rectangle<float> bounds);
+    
+    std::vector<double> responseFrequencies, magnitudes;
+    // Only rebuilt when the settings or size change, so the spectrogram
+    // can repaint at frame rate without redoing the curve
+    juce::Path responseCurve;
+    bool responseCurveNeedsUpdate {true};
+    void updateResponseCurve();
+    
+    // Created the first time it's shown
+    std::unique_ptr<SpectrogramAnalyzer> spectrogram;
+    bool spectrogramVisible {false};
+
     juce::Rectangle<int> getRenderArea();
     juce::Rectangle<int> getAnalysisArea();
+    static juce::Rectangle<int> getRenderArea(juce::Rectangle<int> bounds);
+    static juce::Rectangle<int> getAnalysisArea(juce::Rectangle<int> bounds);
+};
+
+struct LevelMeterComponent : juce::Component, juce::Timer
+{
+    LevelMeterComponent(FirstJUCEpluginAudioProcessor&);
+    
+    void timerCallback() override;
+    
+    void paint(juce::Graphics& g) override;
+    
+private:
+    FirstJUCEpluginAudioProcessor& audioProcessor;
+    
+    // What's on screen for one bus, in dB/LUFS
+    struct Display
+    {
+        float peak {LevelMeter::SILENCE}, truePeak {LevelMeter::SILENCE}, rms {LevelMeter::SILENCE};
+        float momentary {LevelMeter::SILENCE}, shortTerm {LevelMeter::SILENCE};
+    };
+    
+    Display input, output;
+    QualityTier tier {Quality_Full};
+    int frameCount {0};
+    
+    static void update(Display& display, LevelMeter::Readings& readings);
+    void drawMeter(juce::Graphics& g, juce::Rectangle<int> bounds, const juce::String& name, const Display& display);
 };
 
 //==============================================================================
 /**
 */
-class FirstJUCEpluginAudioProcessorEditor  : public juce::AudioProcessorEditor
+class FirstJUCEpluginAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                              private juce::Timer
 {
 public:
     FirstJUCEpluginAudioProcessorEditor (FirstJUCEpluginAudioProcessor&);
@@ -87,13 +186,22 @@ public:
 
     //==============================================================================
     void paint (juce::Graphics&) override;
+    void paintOverChildren (juce::Graphics&) override;
     void resized() override;
     
+    // Cmd/Ctrl+Shift+T starts tracing, and once it's running dumps the trace.
+    // Cmd/Ctrl+Shift+R starts and stops a session capture (see SessionCapture).
+    bool keyPressed(const juce::KeyPress& key) override;
+    
 private:
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     FirstJUCEpluginAudioProcessor& audioProcessor;
     
+    // Ahead of the components, so the startup timing covers building them
+    const juce::int64 openTicks {juce::Time::getHighResolutionTicks()};
+    bool firstFrameDrawn {false};
+    
     RotarySliderWithLabels peakFreqSlider,
                         peakGainSlider,
                         peakQualitySlider,
@@ -102,18 +210,57 @@ private:
                         lowCutSlopeSlider,
                         highCutSlopeSlider;
     
+    // Dynamic Peak band
+    RotarySliderWithLabels peakThresholdSlider,
+                        peakRatioSlider,
+                        peakAttackSlider,
+                        peakReleaseSlider;
+    juce::ToggleButton peakDynamicButton {"Dynamic"}, peakSidechainButton {"Sidechain"};
+    
     ResponseCurveComponent responseCurveComponent;
+    LevelMeterComponent levelMeterComponent;
+    
+    // Stereo mode, and which path's settings the knobs are editing
+    juce::ComboBox stereoModeBox;
+    // Bilinear or analog-matched band designs, for both paths
+    juce::ComboBox filterDesignBox;
+    juce::TextButton leftMidButton {"L / M"}, rightSideButton {"R / S"};
+    juce::ToggleButton meteringButton {"Meters"};
+    juce::ToggleButton spectrogramButton {"Spectrogram"};
+    
+    // Match EQ from a mix file and a reference file onto the path being edited
+    juce::TextButton matchButton {"Match..."};
+    std::unique_ptr<juce::FileChooser> mixChooser, referenceChooser;
+    MatchAnalysis::Task matchTask;
+    ChainPaths editedPath {ChainPaths::LeftOrMid};
+    void chooseMatchFiles();
+    void matchFinished(bool succeeded, const ChainSettings& settings, ChainPaths path);
+    // Shows the match's progress
+    void timerCallback() override;
     
     using APVTS = juce::AudioProcessorValueTreeState;
     using Attachment = APVTS::SliderAttachment;
     
-    Attachment peakFreqSliderAttachment,
-                peakGainSliderAttachment,
-                peakQualitySliderAttachment,
-                lowCutFreqSliderAttachment,
-                highCutFreqSliderAttachment,
-                lowCutSlopeSliderAttachment,
-                highCutSlopeSliderAttachment;
+    // Recreated whenever the knobs switch to the other path
+    std::unique_ptr<Attachment> peakFreqSliderAttachment,
+                                peakGainSliderAttachment,
+                                peakQualitySliderAttachment,
+                                lowCutFreqSliderAttachment,
+                                highCutFreqSliderAttachment,
+                                lowCutSlopeSliderAttachment,
+                                highCutSlopeSliderAttachment,
+                                peakThresholdSliderAttachment,
+                                peakRatioSliderAttachment,
+                                peakAttackSliderAttachment,
+                                peakReleaseSliderAttachment;
+    std::unique_ptr<APVTS::ButtonAttachment> peakDynamicAttachment;
+    
+    std::unique_ptr<APVTS::ComboBoxAttachment> stereoModeAttachment, filterDesignAttachment;
+    std::unique_ptr<APVTS::ButtonAttachment> meteringAttachment, peakSidechainAttachment;
+    
+    void attachSliders(ChainPaths path);
+    // MIDI learn, or forget, whichever parameter the knob is editing
+    void showMidiMenu(RotarySliderWithLabels& slider);
     
     std::vector<juce::Component*> getComps();
 
@@ -9,6 +9,23 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+// Below this there is too little independent work to be worth waking anyone
+static constexpr int MIN_PARALLEL_CHANNELS = 8;
+// Fractions of the block deadline at which multi-core processing turns on and off again
+static constexpr double PARALLEL_ON_LOAD = 0.5;
+static constexpr double PARALLEL_OFF_LOAD = 0.25;
+
+// How often coefficients follow the parameters at Quality_SlowCoefficients
+static constexpr int SLOW_COEFFICIENT_BLOCKS = 4;
+
+// How often an instance publishes into the shared metrics segment, in seconds of audio
+static constexpr double METRICS_INTERVAL_SECONDS = 0.1;
+
+static double millisecondsSince(juce::int64 startTicks)
+{
+    return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+}
+
 //==============================================================================
 FirstJUCEpluginAudioProcessor::FirstJUCEpluginAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -16,12 +33,30 @@ FirstJUCEpluginAudioProcessor::FirstJUCEpluginAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       // Optional detector input for the dynamic Peak band
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 #endif
 {
+    midiControl.setParameters(getParameters(), apvts);
+    startupTimings.constructor = millisecondsSince(creationTicks);
+    
+    // The first instance takes FIRSTJUCE_CAPTURE, so a replay (which makes
+    // instances of its own) never ends up capturing itself
+    static std::atomic<bool> captureClaimed {false};
+    if (juce::SystemStats::getEnvironmentVariable("FIRSTJUCE_CAPTURE", {}).isNotEmpty()) {
+        captureFromEnvironment = !captureClaimed.exchange(true);
+    }
+    
+    // Every instance gets a slot, named by FIRSTJUCE_METRICS or the default
+    // segment when it's just set to something
+    auto metricsSegment = juce::SystemStats::getEnvironmentVariable("FIRSTJUCE_METRICS", {});
+    if (metricsSegment.isNotEmpty()) {
+        metricsExporter.open(metricsSegment.startsWithChar('/') ? metricsSegment : juce::String(MetricsSegment::defaultName));
+    }
 }
 
 FirstJUCEpluginAudioProcessor::~FirstJUCEpluginAudioProcessor()
@@ -95,22 +130,156 @@ void FirstJUCEpluginAudioProcessor::prepareToPlay (double sampleRate, int sample
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    juce::dsp::ProcessSpec spec;
+    // The sidechain only feeds the dynamic Peak band, it never goes through a cascade
+    auto numChannels = getMainBusNumOutputChannels();
     
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
-    spec.sampleRate = sampleRate;
- 
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    // Fill one vector of the selected kernel per cascade
+    auto kernelWidth = CascadeKernels::getWidth(CascadeKernels::getActiveISA());
+    channelsPerCascade = juce::jlimit(4, FilterCascade::maxLanes, kernelWidth);
+    numCascadeChannels = numChannels;
+    cascadeStereoMode = Stereo_Linked;
+    
+    cascades.clear();
+    for (int i = 0; i < numChannels; i += channelsPerCascade) {
+        cascades.add(new FilterCascade());
+    }
+    
+    auto numWorkers = 0;
+    if (numChannels >= MIN_PARALLEL_CHANNELS) {
+        numWorkers = juce::jmin(cascades.size(), juce::SystemStats::getNumCpus()) - 1;
+    }
+    workerPool.prepare(numWorkers);
+    processInParallel = false;
+    smoothedWorkSeconds = 0;
+    
+    processingStats.prepare(sampleRate);
+    qualityGovernor.prepare(sampleRate);
+    blocksSinceFilterUpdate = 0;
+    inputMeter.prepare(sampleRate, numChannels);
+    outputMeter.prepare(sampleRate, numChannels);
+    for (auto* cascade : cascades) {
+        inputMeter.prepareLevels(cascade->getInputLevels());
+        outputMeter.prepareLevels(cascade->getOutputLevels());
+    }
+    analyzerFifo.prepare(sampleRate);
+    for (auto& dynamicPeak : dynamicPeaks) {
+        dynamicPeak.prepare(sampleRate);
+    }
+    
+    arena.prepare(getArenaBytesNeeded(samplesPerBlock, numChannels));
+    midiControl.prepare(samplesPerBlock);
+    // Publishes on the first block
+    metricsIntervalSamples = juce::roundToInt(sampleRate * METRICS_INTERVAL_SECONDS);
+    samplesSinceMetrics = metricsIntervalSamples;
     
     updateFilters();
+    
+    if (captureFromEnvironment) {
+        captureFromEnvironment = false;
+        auto file = juce::SystemStats::getEnvironmentVariable("FIRSTJUCE_CAPTURE", {});
+        auto withAudio = juce::SystemStats::getEnvironmentVariable("FIRSTJUCE_CAPTURE_AUDIO", {}).isNotEmpty();
+        startCapture(juce::File(file), withAudio);
+    } else {
+        sessionCapture.recordPrepare(sampleRate, samplesPerBlock, numChannels, getNumSidechainChannels());
+    }
+}
+
+bool FirstJUCEpluginAudioProcessor::startCapture(const juce::File& file, bool includeAudio)
+{
+    return sessionCapture.start(file,
+                                includeAudio,
+                                getParameters(),
+                                getSampleRate(),
+                                getBlockSize(),
+                                getMainBusNumOutputChannels(),
+                                getNumSidechainChannels());
+}
+
+int FirstJUCEpluginAudioProcessor::getNumSidechainChannels() const
+{
+    auto* sidechain = getBus(true, 1);
+    return sidechain != nullptr && sidechain->isEnabled() ? sidechain->getNumberOfChannels() : 0;
+}
+
+int FirstJUCEpluginAudioProcessor::getBusChannels(juce::AudioBuffer<float>& buffer, bool isInput, int busIndex, float** destination) const
+{
+    // Disabled or missing buses have no channels
+    auto numChannels = juce::jmin(getChannelCountOfBus(isInput, busIndex), MAX_CHANNELS);
+    for (int ch = 0; ch < numChannels; ch++) {
+        destination[ch] = buffer.getWritePointer(getChannelIndexInProcessBlockBuffer(isInput, busIndex, ch));
+    }
+    return numChannels;
 }
 
 void FirstJUCEpluginAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    arena.release();
+    workerPool.release();
+}
+
+size_t FirstJUCEpluginAudioProcessor::getArenaBytesNeeded(int samplesPerBlock, int numChannels) const
+{
+    // Every feature that needs scratch memory on the audio thread adds its share here,
+    // so the memory used per instance is known up front
+    size_t bytes = 0;
+    
+    // Interleaving scratch for the cascade kernels, one for every cascade
+    // that can be running at the same time
+    auto numConcurrentCascades = workerPool.getNumWorkers() > 0 ? cascades.size() : 1;
+    auto cascadeScratchBytes = CascadeKernels::getScratchFloatsNeeded(samplesPerBlock) * sizeof(float);
+    bytes += (size_t) numConcurrentCascades * RealtimeArena::alignUp(cascadeScratchBytes);
+    
+    // True peak scratch, shared by the input and output meters
+    bytes += RealtimeArena::alignUp(LevelMeter::getScratchFloatsNeeded(samplesPerBlock) * sizeof(float));
+    
+    // The dynamic Peak band's detector signal, shared by both paths, and each
+    // path's coefficients for every sub-block
+    bytes += RealtimeArena::alignUp((size_t) samplesPerBlock * sizeof(float));
+    auto coefficientBytes = (size_t) DynamicPeak::getNumSubBlocks(samplesPerBlock) * sizeof(DynamicPeak::Coefficients);
+    bytes += 2 * RealtimeArena::alignUp(coefficientBytes);
+    
+    return bytes;
+}
+
+void FirstJUCEpluginAudioProcessor::editorFirstFrameDrawn(juce::int64 editorOpenTicks)
+{
+    startupTimings.editorOpenToFirstFrame = millisecondsSince(editorOpenTicks);
+    
+    DBG("Startup: constructor " << startupTimings.constructor.load() << " ms, "
+        << "first processBlock after " << startupTimings.createToFirstBlock.load() << " ms, "
+        << "editor first frame after " << startupTimings.editorOpenToFirstFrame.load() << " ms");
+}
+
+ProcessingStats::Snapshot FirstJUCEpluginAudioProcessor::getProcessingStats() const
+{
+    auto snapshot = processingStats.getSnapshot();
+    snapshot.qualityTier = qualityGovernor.getTier();
+    snapshot.qualityTierChanges = qualityGovernor.getNumTierChanges();
+    return snapshot;
+}
+
+FrequencyResponse::Snapshot FirstJUCEpluginAudioProcessor::getResponseSnapshot(ChainPaths path)
+{
+    auto chainSettings = chainParameters[path].getSettings();
+    if (chainSettings.peakDynamic) {
+        chainSettings.peakGainInDecibels = getDynamicPeakGain(path);
+    }
+    
+    // Not prepared yet, so anything sensible will do
+    auto sampleRate = getSampleRate() > 0 ? getSampleRate() : 44100.0;
+    return FrequencyResponse::Snapshot::fromSettings(chainSettings, sampleRate);
+}
+
+size_t FirstJUCEpluginAudioProcessor::getMemoryFootprint() const
+{
+    return sizeof(*this)
+         + arena.getCapacity()
+         + (size_t) cascades.size() * sizeof(FilterCascade)
+         + analyzerFifo.getMemoryFootprint()
+         + inputMeter.getMemoryFootprint()
+         + outputMeter.getMemoryFootprint();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -121,17 +290,23 @@ bool FirstJUCEpluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& l
     return true;
   #else
     // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every channel gets its own chain, so anything from mono up to
+    // MAX_CHANNELS (e.g. 3rd order ambisonics or speaker arrays) works.
+    auto numChannels = layouts.getMainOutputChannelSet().size();
+    if (numChannels < 1 || numChannels > MAX_CHANNELS)
         return false;
 
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The sidechain can be left off, or be mono or stereo whatever the main bus is
+    if (layouts.inputBuses.size() > 1) {
+        auto sidechain = layouts.getChannelSet(true, 1);
+        if (!sidechain.isDisabled() && sidechain != juce::AudioChannelSet::mono() && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
 
     return true;
@@ -141,7 +316,13 @@ bool FirstJUCEpluginAudioProcessor::isBusesLayoutSupported (const BusesLayout& l
 
 void FirstJUCEpluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    TRACE_SCOPE("processBlock");
     juce::ScopedNoDenormals noDenormals;
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    // Before anything touches the buffer, so the log has the input as it came
+    sessionCapture.recordBlock(buffer, midiMessages, midiControl);
+    arena.reset();
+    
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -154,20 +335,219 @@ void FirstJUCEpluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buff
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    updateFilters();
+    // Optional work is the first to go when the governor says time is short
+    auto tier = qualityGovernor.getTier();
+    
+    // MIDI control at the very start of the block needs no split of its own
+    auto numSegments = midiControl.process(midiMessages, buffer.getNumSamples());
+    auto controlChanged = midiControl.applyChanges(0);
+    
+    if (controlChanged || tier < Quality_SlowCoefficients || ++blocksSinceFilterUpdate >= SLOW_COEFFICIENT_BLOCKS) {
+        updateFilters();
+        blocksSinceFilterUpdate = 0;
+    }
     
-    // For this plugin, the default loop is unnecessary. Set up audio blocks
-    // Two audio blocks, designed for stereo
-    juce::dsp::AudioBlock<float> block(buffer);
+    // Everything from here on only sees the main bus, the sidechain is just for detection
+    float* mainChannels[MAX_CHANNELS];
+    float* sidechainChannels[MAX_CHANNELS];
+    auto numMainChannels = getBusChannels(buffer, false, 0, mainChannels);
+    auto numSidechainChannels = getBusChannels(buffer, true, 1, sidechainChannels);
     
-    auto leftBlock = block.getSingleChannelBlock(LEFT_CHANNEL);
-    auto rightBlock = block.getSingleChannelBlock(RIGHT_CHANNEL);
+    // Peak, RMS and loudness come out of the cascade pass, see processChannels.
+    // A branch per frame in the kernels is all that costs when it's off.
+    auto metering = meteringValue->load() > 0.5f && tier < Quality_NoMetering;
+    auto truePeak = metering && tier < Quality_NoTruePeak;
+    auto numSamples = buffer.getNumSamples();
+    float* meterScratch = nullptr;
     
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    for (auto* cascade : cascades) {
+        cascade->setMetering(metering);
+    }
+    inputMeter.setTruePeakEnabled(truePeak);
+    outputMeter.setTruePeakEnabled(truePeak);
+    
+    if (truePeak) {
+        // The output meter reuses the input meter's scratch
+        TRACE_SCOPE("inputTruePeak");
+        meterScratch = arena.allocate<float>(LevelMeter::getScratchFloatsNeeded(numSamples));
+        inputMeter.measureTruePeak(mainChannels, numMainChannels, numSamples, meterScratch);
+    }
     
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    if (numSegments == 1) {
+        processSegment(mainChannels, numMainChannels, sidechainChannels, numSidechainChannels, 0, numSamples);
+    } else {
+        TRACE_SCOPE("midiSegments");
+        for (int i = 0; i < numSegments; i++) {
+            auto& segment = midiControl.getSegment(i);
+            if (i > 0 && midiControl.applyChanges(i)) {
+                updateFilters();
+            }
+            
+            // Every segment gets the same scratch
+            auto arenaPosition = arena.getPosition();
+            processSegment(mainChannels, numMainChannels, sidechainChannels, numSidechainChannels, segment.start, segment.numSamples);
+            arena.rewind(arenaPosition);
+        }
+    }
+    
+    if (truePeak) {
+        TRACE_SCOPE("outputTruePeak");
+        outputMeter.measureTruePeak(mainChannels, numMainChannels, numSamples, meterScratch);
+    }
+    
+    if (analyzerFifo.isActive()) {
+        TRACE_SCOPE("analyzerFifo");
+        analyzerFifo.push(mainChannels, numMainChannels, numSamples);
+    }
+    
+    auto load = processingStats.recordBlock(startTicks, juce::Time::getHighResolutionTicks(), numSamples);
+    qualityGovernor.update(load, numSamples);
+    
+    if (metricsExporter.isOpen()) {
+        samplesSinceMetrics += numSamples;
+        if (samplesSinceMetrics >= metricsIntervalSamples) {
+            samplesSinceMetrics = 0;
+            publishMetrics(numSamples);
+        }
+    }
+    
+    if (!firstBlockProcessed) {
+        firstBlockProcessed = true;
+        startupTimings.createToFirstBlock = millisecondsSince(creationTicks);
+    }
+}
+
+void FirstJUCEpluginAudioProcessor::processSegment(float* const* mainChannels, int numMainChannels,
+                                                   float* const* sidechainChannels, int numSidechainChannels,
+                                                   int start, int numSamples)
+{
+    // Has to see the input before the cascades overwrite it
+    if (dynamicPeaks[ChainPaths::LeftOrMid].isEnabled() || dynamicPeaks[ChainPaths::RightOrSide].isEnabled()) {
+        TRACE_SCOPE("dynamicPeaks");
+        auto useSidechain = peakSidechainValue->load() > 0.5f && numSidechainChannels > 0;
+        if (useSidechain) {
+            runDynamicPeaks(sidechainChannels, numSidechainChannels, start, numSamples);
+        } else {
+            runDynamicPeaks(mainChannels, numMainChannels, start, numSamples);
+        }
+    } else {
+        dynamicPeakCoefficients[ChainPaths::LeftOrMid] = nullptr;
+        dynamicPeakCoefficients[ChainPaths::RightOrSide] = nullptr;
+    }
+    
+    // For this plugin, the default loop is unnecessary. The cascades work on
+    // the buffer's channels directly
+    processChannels(mainChannels, numMainChannels, start, numSamples);
+}
+
+void FirstJUCEpluginAudioProcessor::processChannels(float* const* channels, int numChannels, int start, int numSamples)
+{
+    currentNumChannels = juce::jmin(numChannels, numCascadeChannels);
+    currentNumSamples = numSamples;
+    for (int ch = 0; ch < currentNumChannels; ch++) {
+        currentChannels[ch] = channels[ch] + start;
+    }
+    
+    auto numCascades = (currentNumChannels + channelsPerCascade - 1) / channelsPerCascade;
+    auto parallel = processInParallel && multiCoreAllowed.load(std::memory_order_relaxed);
+    
+    // Cascades running one after another can share their scratch
+    auto scratchFloats = CascadeKernels::getScratchFloatsNeeded(currentNumSamples);
+    for (int i = 0; i < numCascades; i++) {
+        cascadeScratch[i] = (parallel || i == 0) ? arena.allocate<float>(scratchFloats) : cascadeScratch[0];
+    }
+    
+    workTicks.store(0, std::memory_order_relaxed);
+    
+    if (parallel) {
+        workerPool.run(numCascades, &FirstJUCEpluginAudioProcessor::processCascade, this);
+    } else {
+        for (int i = 0; i < numCascades; i++) {
+            processCascade(this, i);
+        }
+    }
+    
+    // What the kernels metered on the way through. processBlock switches
+    // every cascade's metering together.
+    if (numCascades > 0 && cascades.getUnchecked(0)->isMetering()) {
+        for (int i = 0; i < numCascades; i++) {
+            auto* cascade = cascades.getUnchecked(i);
+            auto numLanes = juce::jmin(channelsPerCascade, currentNumChannels - i * channelsPerCascade);
+            inputMeter.collect(cascade->getInputLevels(), numLanes);
+            outputMeter.collect(cascade->getOutputLevels(), numLanes);
+        }
+        inputMeter.advance(currentNumSamples);
+        outputMeter.advance(currentNumSamples);
+    }
+    
+    if (workerPool.getNumWorkers() == 0 || getSampleRate() <= 0) {
+        return;
+    }
+    
+    // Only go multi-core once the total work actually threatens the deadline,
+    // and only drop back well below that so we don't flip every block
+    auto workSeconds = juce::Time::highResolutionTicksToSeconds(workTicks.load(std::memory_order_relaxed));
+    smoothedWorkSeconds += 0.1 * (workSeconds - smoothedWorkSeconds);
+    
+    auto deadline = currentNumSamples / getSampleRate();
+    if (!processInParallel && smoothedWorkSeconds > PARALLEL_ON_LOAD * deadline) {
+        processInParallel = true;
+    } else if (processInParallel && smoothedWorkSeconds < PARALLEL_OFF_LOAD * deadline) {
+        processInParallel = false;
+    }
+}
+
+void FirstJUCEpluginAudioProcessor::processCascade(void* processor, int index)
+{
+    TRACE_SCOPE("processCascade");
+    auto& p = *static_cast<FirstJUCEpluginAudioProcessor*>(processor);
+    auto start = juce::Time::getHighResolutionTicks();
+    
+    auto firstChannel = index * p.channelsPerCascade;
+    auto numChannels = juce::jmin(p.channelsPerCascade, p.currentNumChannels - firstChannel);
+    auto midSide = p.cascadeStereoMode == Stereo_MidSide;
+    
+    // Only happens if the host sends a bigger block than it promised in prepareToPlay
+    if (p.cascadeScratch[index] == nullptr) {
+        return;
+    }
+    
+    auto& cascade = *p.cascades.getUnchecked(index);
+    
+    if (p.dynamicPeakCoefficients[ChainPaths::LeftOrMid] == nullptr
+        && p.dynamicPeakCoefficients[ChainPaths::RightOrSide] == nullptr) {
+        cascade.process(p.currentChannels + firstChannel,
+                        numChannels,
+                        p.currentNumSamples,
+                        midSide,
+                        p.cascadeScratch[index]);
+    } else {
+        // Same pass, one sub-block at a time so the Peak band can move in between
+        float* channels[FilterCascade::maxLanes];
+        
+        for (int start = 0; start < p.currentNumSamples; start += DynamicPeak::subBlockSize) {
+            auto subBlock = start / DynamicPeak::subBlockSize;
+            
+            for (int lane = 0; lane < numChannels; lane++) {
+                auto channel = firstChannel + lane;
+                auto path = p.channelUsesPath(channel, ChainPaths::RightOrSide) ? ChainPaths::RightOrSide : ChainPaths::LeftOrMid;
+                
+                if (auto* coefficients = p.dynamicPeakCoefficients[path]) {
+                    auto& c = coefficients[subBlock];
+                    cascade.updateSection(lane, FilterCascade::peakSection, c.b0, c.b1, c.b2, c.a1, c.a2);
+                }
+                channels[lane] = p.currentChannels[channel] + start;
+            }
+            
+            cascade.process(channels,
+                            numChannels,
+                            juce::jmin(DynamicPeak::subBlockSize, p.currentNumSamples - start),
+                            midSide,
+                            p.cascadeScratch[index]);
+        }
+    }
+    
+    p.workTicks.fetch_add(juce::Time::getHighResolutionTicks() - start, std::memory_order_relaxed);
 }
 
 //==============================================================================
@@ -189,16 +569,26 @@ void FirstJUCEpluginAudioProcessor::getStateInformation (juce::MemoryBlock& dest
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
     
+    // The MIDI mappings ride along as a child of the parameter tree
+    auto state = apvts.copyState();
+    state.appendChild(midiControl.toValueTree(), nullptr);
+    
     juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    state.writeToStream(mos);
 }
 
 void FirstJUCEpluginAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
+    TRACE_SCOPE("setStateInformation");
     auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
     if (tree.isValid()) {
+        // Older states have no mappings, which clears them
+        auto mappings = tree.getChildWithName(MidiControl::treeType);
+        midiControl.fromValueTree(mappings);
+        tree.removeChild(mappings, nullptr);
+        
         apvts.replaceState(tree);
         updateFilters();
     }
@@ -206,23 +596,73 @@ void FirstJUCEpluginAudioProcessor::setStateInformation (const void* data, int s
 
 // Code I've written
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState &apvts)
+juce::String getParameterID(const juce::String& name, ChainPaths path)
+{
+    return path == ChainPaths::RightOrSide ? name + " R/S" : name;
+}
+
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState &apvts, ChainPaths path)
+{
+    return ChainParameters(apvts, path).getSettings();
+}
+
+ChainParameters::ChainParameters(juce::AudioProcessorValueTreeState& apvts, ChainPaths path)
+{
+    auto value = [&apvts, path](const juce::String& name) {
+        auto* parameter = apvts.getRawParameterValue(getParameterID(name, path));
+        jassert(parameter != nullptr);
+        return parameter;
+    };
+    
+    lowCutFreq = value("LowCut Freq");
+    highCutFreq = value("HighCut Freq");
+    lowCutSlope = value("LowCut Slope");
+    highCutSlope = value("HighCut Slope");
+    peakFreq = value("Peak Freq");
+    peakGain = value("Peak Gain");
+    peakQuality = value("Peak Quality");
+    peakDynamic = value("Peak Dynamic");
+    peakThreshold = value("Peak Threshold");
+    peakRatio = value("Peak Ratio");
+    peakAttack = value("Peak Attack");
+    peakRelease = value("Peak Release");
+    filterDesign = apvts.getRawParameterValue("Filter Design");
+}
+
+ChainSettings ChainParameters::getSettings() const noexcept
 {
     ChainSettings settings;
     
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq")->load();
-    settings.highCutFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
-    settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
-    settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
-    settings.lowCutSlope = static_cast<Slope> (apvts.getRawParameterValue("LowCut Slope")->load());
-    settings.highCutSlope = static_cast<Slope> (apvts.getRawParameterValue("HighCut Slope")->load());
+    settings.lowCutFreq = lowCutFreq->load();
+    settings.highCutFreq = highCutFreq->load();
+    settings.peakFreq = peakFreq->load();
+    settings.peakGainInDecibels = peakGain->load();
+    settings.peakQuality = peakQuality->load();
+    settings.lowCutSlope = static_cast<Slope> (lowCutSlope->load());
+    settings.highCutSlope = static_cast<Slope> (highCutSlope->load());
+    settings.peakDynamic = peakDynamic->load() > 0.5f;
+    settings.peakThreshold = peakThreshold->load();
+    settings.peakRatio = peakRatio->load();
+    settings.peakAttack = peakAttack->load();
+    settings.peakRelease = peakRelease->load();
+    settings.filterDesign = static_cast<FilterDesign> (filterDesign->load());
     
     return settings;
 }
 
+StereoMode getStereoMode(juce::AudioProcessorValueTreeState &apvts)
+{
+    return static_cast<StereoMode> (apvts.getRawParameterValue("Stereo Mode")->load());
+}
+
 Coefficients makePeakFilter(const ChainSettings &chainSettings, double sampleRate)
 {
+    if (chainSettings.filterDesign == Design_AnalogMatched) {
+        return MatchedBiquad::toCoefficients(MatchedBiquad::peak(sampleRate,
+                                                                 chainSettings.peakFreq,
+                                                                 chainSettings.peakQuality,
+                                                                 juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels)));
+    }
     return juce::dsp::IIR::Coefficients<float>::makePeakFilter(
        sampleRate,
        chainSettings.peakFreq,
@@ -231,39 +671,173 @@ Coefficients makePeakFilter(const ChainSettings &chainSettings, double sampleRat
     );
 }
 
-void FirstJUCEpluginAudioProcessor::updatePeakFilter(const ChainSettings &chainSettings)
+static DynamicPeak::Settings getDynamicPeakSettings(const ChainSettings& chainSettings)
 {
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    DynamicPeak::Settings settings;
+    settings.enabled = chainSettings.peakDynamic;
+    settings.frequency = chainSettings.peakFreq;
+    settings.quality = chainSettings.peakQuality;
+    settings.gainDb = chainSettings.peakGainInDecibels;
+    settings.thresholdDb = chainSettings.peakThreshold;
+    settings.ratio = chainSettings.peakRatio;
+    settings.attackMs = chainSettings.peakAttack;
+    settings.releaseMs = chainSettings.peakRelease;
+    settings.analogMatched = chainSettings.filterDesign == Design_AnalogMatched;
+    return settings;
 }
 
-void FirstJUCEpluginAudioProcessor::updateLowCutFilters(const ChainSettings& chainSettings)
+bool FirstJUCEpluginAudioProcessor::channelUsesPath(int channel, ChainPaths path) const
 {
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
-    auto &leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
-    
-    auto &rightLowCut = rightChain.get<ChainPositions::LowCut>();
-    updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
+    // Only the right channel of an unlinked stereo pair has settings of its own
+    auto rightOrSide = cascadeStereoMode != Stereo_Linked && channel == RIGHT_CHANNEL;
+    return path == ChainPaths::RightOrSide ? rightOrSide : !rightOrSide;
 }
 
-void FirstJUCEpluginAudioProcessor::updateHighCutFilters(const ChainSettings& chainSettings)
+void FirstJUCEpluginAudioProcessor::updateBands(const ChainSettings& chainSettings, ChainPaths path)
 {
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
-    auto &leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
+    // Nothing to update before prepareToPlay
+    if (numCascadeChannels == 0) {
+        return;
+    }
     
-    auto &rightHighCut = rightChain.get<ChainPositions::HighCut>();
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+    // Designed in place rather than through juce::dsp::IIR::Coefficients,
+    // so this can run mid-block on the audio thread
+    auto bands = BandDesign::design(chainSettings, getSampleRate());
+    for (int ch = 0; ch < numCascadeChannels; ch++) {
+        if (channelUsesPath(ch, path)) {
+            cascades.getUnchecked(ch / channelsPerCascade)->setBands(ch % channelsPerCascade, bands);
+        }
+    }
 }
 
 void FirstJUCEpluginAudioProcessor::updateFilters()
 {
-    auto chainSettings = getChainSettings(apvts);
-    updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilters(chainSettings);
+    TRACE_SCOPE("updateFilters");
+    // L/R and M/S only mean something for a stereo pair
+    auto stereoMode = numCascadeChannels == 2 ? static_cast<StereoMode> (stereoModeValue->load()) : Stereo_Linked;
+    if (stereoMode != cascadeStereoMode) {
+        // L/R state means nothing to an M/S cascade and vice versa
+        for (auto* cascade : cascades) {
+            cascade->reset();
+        }
+        for (auto& dynamicPeak : dynamicPeaks) {
+            dynamicPeak.reset();
+        }
+        cascadeStereoMode = stereoMode;
+    }
+    
+    auto chainSettings = chainParameters[ChainPaths::LeftOrMid].getSettings();
+    updateBands(chainSettings, ChainPaths::LeftOrMid);
+    currentSettings[ChainPaths::LeftOrMid] = chainSettings;
+    dynamicPeaks[ChainPaths::LeftOrMid].setSettings(getDynamicPeakSettings(chainSettings));
+    
+    auto rightOrSideSettings = ChainSettings();
+    if (cascadeStereoMode != Stereo_Linked) {
+        rightOrSideSettings = chainParameters[ChainPaths::RightOrSide].getSettings();
+        updateBands(rightOrSideSettings, ChainPaths::RightOrSide);
+    }
+    // Linked stereo has no right/side band, static or dynamic
+    dynamicPeaks[ChainPaths::RightOrSide].setSettings(getDynamicPeakSettings(rightOrSideSettings));
+    currentSettings[ChainPaths::RightOrSide] = rightOrSideSettings;
+}
+
+void FirstJUCEpluginAudioProcessor::publishMetrics(int blockSize) noexcept
+{
+    auto stats = getProcessingStats();
+    
+    MetricsSegment::Metrics metrics {};
+    metrics.sampleRate = getSampleRate();
+    metrics.maxBlockSize = getBlockSize();
+    metrics.lastBlockSize = blockSize;
+    metrics.numChannels = numCascadeChannels;
+    metrics.stereoMode = cascadeStereoMode;
+    metrics.filterDesign = currentSettings[ChainPaths::LeftOrMid].filterDesign;
+    metrics.numPaths = cascadeStereoMode == Stereo_Linked ? 1 : 2;
+    
+    for (auto path : {ChainPaths::LeftOrMid, ChainPaths::RightOrSide}) {
+        auto& settings = currentSettings[path];
+        auto& bands = metrics.bands[path];
+        bands.lowCutFreq = settings.lowCutFreq;
+        bands.lowCutSlope = 12 * (settings.lowCutSlope + 1);
+        bands.peakFreq = settings.peakFreq;
+        bands.peakGainDb = settings.peakDynamic ? getDynamicPeakGain(path) : settings.peakGainInDecibels;
+        bands.peakQuality = settings.peakQuality;
+        bands.peakDynamic = settings.peakDynamic ? 1 : 0;
+        bands.highCutFreq = settings.highCutFreq;
+        bands.highCutSlope = 12 * (settings.highCutSlope + 1);
+    }
+    
+    metrics.numBlocks = stats.numBlocks;
+    metrics.deadlineMisses = stats.deadlineMisses;
+    metrics.lastLoad = stats.lastLoad;
+    metrics.meanLoad = stats.meanLoad;
+    metrics.maxLoad = stats.maxLoad;
+    metrics.meanBlockMicroseconds = stats.meanBlockMicroseconds;
+    metrics.maxBlockMicroseconds = stats.maxBlockMicroseconds;
+    metrics.qualityTier = stats.qualityTier;
+    metrics.qualityTierChanges = stats.qualityTierChanges;
+    
+    metricsExporter.publish(metrics);
+}
+
+void FirstJUCEpluginAudioProcessor::runDynamicPeaks(const float* const* channels, int numChannels, int start, int numSamples)
+{
+    float* detectorSignal = nullptr;
+    
+    for (auto path : {ChainPaths::LeftOrMid, ChainPaths::RightOrSide}) {
+        dynamicPeakCoefficients[path] = nullptr;
+        auto& dynamicPeak = dynamicPeaks[path];
+        if (!dynamicPeak.isEnabled()) {
+            continue;
+        }
+        
+        if (detectorSignal == nullptr) {
+            detectorSignal = arena.allocate<float>((size_t) numSamples);
+        }
+        auto* coefficients = arena.allocate<DynamicPeak::Coefficients>((size_t) DynamicPeak::getNumSubBlocks(numSamples));
+        
+        // Only if the host sends a bigger block than it promised, the band stays static
+        if (detectorSignal == nullptr || coefficients == nullptr) {
+            return;
+        }
+        
+        makeDetectorSignal(channels, numChannels, start, numSamples, path, detectorSignal);
+        dynamicPeak.process(detectorSignal, numSamples, coefficients);
+        dynamicPeakCoefficients[path] = coefficients;
+    }
+}
+
+void FirstJUCEpluginAudioProcessor::makeDetectorSignal(const float* const* channels, int numChannels, int start, int numSamples,
+                                                       ChainPaths path, float* destination) const
+{
+    using FVO = juce::FloatVectorOperations;
+    
+    if (numChannels == 0) {
+        FVO::clear(destination, numSamples);
+        return;
+    }
+    
+    // The band listens to what it's about to filter: the mix for linked
+    // stereo, otherwise its own channel, or mid or side
+    auto* left = channels[0] + start;
+    auto* right = channels[juce::jmin(1, numChannels - 1)] + start;
+    
+    switch (cascadeStereoMode) {
+        case Stereo_LeftRight:
+            FVO::copy(destination, path == ChainPaths::RightOrSide ? right : left, numSamples);
+            break;
+        case Stereo_MidSide:
+            FVO::copyWithMultiply(destination, left, 0.5f, numSamples);
+            FVO::addWithMultiply(destination, right, path == ChainPaths::RightOrSide ? -0.5f : 0.5f, numSamples);
+            break;
+        case Stereo_Linked:
+        default:
+            FVO::copyWithMultiply(destination, left, 1.f / (float) numChannels, numSamples);
+            for (int ch = 1; ch < numChannels; ch++) {
+                FVO::addWithMultiply(destination, channels[ch] + start, 1.f / (float) numChannels, numSamples);
+            }
+            break;
+    }
 }
 
 void updateCoefficients(Coefficients &old, const Coefficients &replacements)
@@ -276,39 +850,6 @@ juce::AudioProcessorValueTreeState::ParameterLayout FirstJUCEpluginAudioProcesso
 {
     juce::AudioProcessorValueTreeState::ParameterLayout layout;
     
-    layout.add(
-        std::make_unique<juce::AudioParameterFloat>(
-            juce::ParameterID("LowCut Freq", 1),
-            "LowCut Freq",
-            juce::NormalisableRange<float>(20.f, 20000.f, 1.f, SKEW),
-            20.f
-        ),
-        std::make_unique<juce::AudioParameterFloat>(
-           juce::ParameterID("HighCut Freq", 1),
-           "HighCut Freq",
-           juce::NormalisableRange<float>(20.f, 20000.f, 1.f, SKEW),
-           20000.f
-        ),
-        std::make_unique<juce::AudioParameterFloat>(
-           juce::ParameterID("Peak Freq", 1),
-           "Peak Freq",
-           juce::NormalisableRange<float>(20.f, 20000.f, 1.f, SKEW),
-           750.f
-        ),
-        std::make_unique<juce::AudioParameterFloat>(
-           juce::ParameterID("Peak Gain", 1),
-           "Peak Gain",
-           juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f),
-           0.f
-        ),
-        std::make_unique<juce::AudioParameterFloat>(
-           juce::ParameterID("Peak Quality", 1),
-           "Peak Quality",
-           juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f),
-           1.f
-        )
-    );
-    
     juce::StringArray choices;
     for (int i = 0; i < 4; i++) {
         juce::String str;
@@ -316,9 +857,109 @@ juce::AudioProcessorValueTreeState::ParameterLayout FirstJUCEpluginAudioProcesso
         choices.add(str);
     }
     
+    // One full set of band parameters per path. The left/mid set keeps the
+    // original IDs so existing sessions still load.
+    auto addChainParameters = [&layout, &choices](ChainPaths path, int versionHint)
+    {
+        auto id = [path](const juce::String& name) { return getParameterID(name, path); };
+        
+        layout.add(
+            std::make_unique<juce::AudioParameterFloat>(
+                juce::ParameterID(id("LowCut Freq"), versionHint),
+                id("LowCut Freq"),
+                juce::NormalisableRange<float>(20.f, 20000.f, 1.f, SKEW),
+                20.f
+            ),
+            std::make_unique<juce::AudioParameterFloat>(
+               juce::ParameterID(id("HighCut Freq"), versionHint),
+               id("HighCut Freq"),
+               juce::NormalisableRange<float>(20.f, 20000.f, 1.f, SKEW),
+               20000.f
+            ),
+            std::make_unique<juce::AudioParameterFloat>(
+               juce::ParameterID(id("Peak Freq"), versionHint),
+               id("Peak Freq"),
+               juce::NormalisableRange<float>(20.f, 20000.f, 1.f, SKEW),
+               750.f
+            ),
+            std::make_unique<juce::AudioParameterFloat>(
+               juce::ParameterID(id("Peak Gain"), versionHint),
+               id("Peak Gain"),
+               juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.f),
+               0.f
+            ),
+            std::make_unique<juce::AudioParameterFloat>(
+               juce::ParameterID(id("Peak Quality"), versionHint),
+               id("Peak Quality"),
+               juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.f),
+               1.f
+            )
+        );
+        
+        layout.add(
+            std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(id("LowCut Slope"), versionHint), id("LowCut Slope"), choices, 0),
+            std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(id("HighCut Slope"), versionHint), id("HighCut Slope"), choices, 0)
+        );
+    };
+    
+    addChainParameters(ChainPaths::LeftOrMid, 1);
+    
+    layout.add(
+        std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID("Stereo Mode", 2),
+            "Stereo Mode",
+            juce::StringArray {"Stereo", "L / R", "M / S"},
+            Stereo_Linked
+        )
+    );
+    
+    addChainParameters(ChainPaths::RightOrSide, 2);
+    
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("Metering", 2), "Metering", true));
+    
+    // Dynamic Peak band, per path like the rest of the band settings
+    for (auto path : {ChainPaths::LeftOrMid, ChainPaths::RightOrSide}) {
+        auto id = [path](const juce::String& name) { return getParameterID(name, path); };
+        
+        layout.add(
+            std::make_unique<juce::AudioParameterBool>(juce::ParameterID(id("Peak Dynamic"), 2), id("Peak Dynamic"), false),
+            std::make_unique<juce::AudioParameterFloat>(
+                juce::ParameterID(id("Peak Threshold"), 2),
+                id("Peak Threshold"),
+                juce::NormalisableRange<float>(-60.f, 0.f, 0.5f, 1.f),
+                -24.f
+            ),
+            std::make_unique<juce::AudioParameterFloat>(
+                juce::ParameterID(id("Peak Ratio"), 2),
+                id("Peak Ratio"),
+                juce::NormalisableRange<float>(1.f, 20.f, 0.1f, 0.5f),
+                2.f
+            ),
+            std::make_unique<juce::AudioParameterFloat>(
+                juce::ParameterID(id("Peak Attack"), 2),
+                id("Peak Attack"),
+                juce::NormalisableRange<float>(0.1f, 100.f, 0.1f, 0.4f),
+                10.f
+            ),
+            std::make_unique<juce::AudioParameterFloat>(
+                juce::ParameterID(id("Peak Release"), 2),
+                id("Peak Release"),
+                juce::NormalisableRange<float>(5.f, 1000.f, 1.f, 0.4f),
+                150.f
+            )
+        );
+    }
+    
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("Peak Sidechain", 2), "Peak Sidechain", false));
+    
+    // Bilinear by default, so existing sessions sound the same
     layout.add(
-        std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("LowCut Slope", 1), "LowCut Slope", choices, 0),
-        std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("HighCut Slope", 1), "HighCut Slope", choices, 0)
+        std::make_unique<juce::AudioParameterChoice>(
+            juce::ParameterID("Filter Design", 2),
+            "Filter Design",
+            juce::StringArray {"Bilinear", "Analog Matched"},
+            Design_Bilinear
+        )
     );
     
     return layout;
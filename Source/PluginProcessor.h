@@ -9,10 +9,26 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "RealtimeArena.h"
+#include "ChannelWorkerPool.h"
+#include "FilterCascade.h"
+#include "ProcessingStats.h"
+#include "LevelMeter.h"
+#include "TraceRecorder.h"
+#include "QualityGovernor.h"
+#include "SpectrogramAnalyzer.h"
+#include "DynamicPeak.h"
+#include "FrequencyResponse.h"
+#include "SessionCapture.h"
+#include "MatchedBiquad.h"
+#include "BandDesign.h"
+#include "MidiControl.h"
+#include "MetricsExporter.h"
 
 // Constants I might want to use
 const int LEFT_CHANNEL = 0;
 const int RIGHT_CHANNEL = 1;
+const int MAX_CHANNELS = 64;
 const float SKEW = 0.25f;
 const float MIN_FREQ = 20.f;
 const float MAX_FREQ = 20000.f;
@@ -40,15 +56,62 @@ enum Slope
     Slope_48
 };
 
+// How the bands' analog prototypes are turned into biquads
+enum FilterDesign
+{
+    Design_Bilinear,
+    // Close to the analog response up to Nyquist, see MatchedBiquad
+    Design_AnalogMatched
+};
+
+enum StereoMode
+{
+    Stereo_Linked,
+    Stereo_LeftRight,
+    Stereo_MidSide
+};
+
+// Which set of band settings a parameter belongs to. Stereo linked mode only uses LeftOrMid
+enum ChainPaths
+{
+    LeftOrMid,
+    RightOrSide
+};
+
 // Struct given in tutorial
 struct ChainSettings
 {
     float peakFreq {0}, peakGainInDecibels {0}, peakQuality {1.f};
     float lowCutFreq {0}, highCutFreq {0};
     Slope lowCutSlope {Slope::Slope_12}, highCutSlope {Slope::Slope_12};
+    // The Peak band as a dynamic band, see DynamicPeak
+    bool peakDynamic {false};
+    float peakThreshold {-24.f}, peakRatio {2.f}, peakAttack {10.f}, peakRelease {150.f};
+    // Shared by both paths
+    FilterDesign filterDesign {Design_Bilinear};
 };
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState &apvts);
+juce::String getParameterID(const juce::String& name, ChainPaths path);
+
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState &apvts, ChainPaths path = ChainPaths::LeftOrMid);
+
+// A path's parameter values, looked up once. getChainSettings builds every
+// parameter ID as a String, this only loads atomics, so it's what the
+// audio thread reads its settings through.
+struct ChainParameters
+{
+    ChainParameters(juce::AudioProcessorValueTreeState& apvts, ChainPaths path);
+    
+    ChainSettings getSettings() const noexcept;
+    
+private:
+    std::atomic<float>* lowCutFreq, * highCutFreq, * lowCutSlope, * highCutSlope;
+    std::atomic<float>* peakFreq, * peakGain, * peakQuality;
+    std::atomic<float>* peakDynamic, * peakThreshold, * peakRatio, * peakAttack, * peakRelease;
+    std::atomic<float>* filterDesign;
+};
+
+StereoMode getStereoMode(juce::AudioProcessorValueTreeState &apvts);
 
 void updateCoefficients(Coefficients& old, const Coefficients& replacements);
 
@@ -56,6 +119,9 @@ Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRat
 
 inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
 {
+    if (chainSettings.filterDesign == Design_AnalogMatched) {
+        return MatchedBiquad::makeButterworthHighPass(chainSettings.lowCutFreq, sampleRate, 2 * (chainSettings.lowCutSlope + 1));
+    }
     return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(
         chainSettings.lowCutFreq,
         sampleRate,
@@ -65,6 +131,9 @@ inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRa
 
 inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
 {
+    if (chainSettings.filterDesign == Design_AnalogMatched) {
+        return MatchedBiquad::makeButterworthLowPass(chainSettings.highCutFreq, sampleRate, 2 * (chainSettings.highCutSlope + 1));
+    }
     return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(
         chainSettings.highCutFreq,
         sampleRate,
@@ -153,18 +222,147 @@ public:
     // Code I write
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     
+    // Taken before apvts is built, so the startup timings include it
+    const juce::int64 creationTicks {juce::Time::getHighResolutionTicks()};
+    
     juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Parameters", createParameterLayout()};
     
+    // Both paths' parameters, for reading them on the audio thread
+    const ChainParameters chainParameters[2] {{apvts, ChainPaths::LeftOrMid}, {apvts, ChainPaths::RightOrSide}};
+    std::atomic<float>* const stereoModeValue {apvts.getRawParameterValue("Stereo Mode")};
+    std::atomic<float>* const meteringValue {apvts.getRawParameterValue("Metering")};
+    std::atomic<float>* const peakSidechainValue {apvts.getRawParameterValue("Peak Sidechain")};
+    
+    // Lets the cascades be spread over worker threads once a block gets expensive
+    std::atomic<bool> multiCoreAllowed {true};
+    
+    // processBlock timing and deadline misses, safe to call from any thread
+    ProcessingStats::Snapshot getProcessingStats() const;
+    
+    // How much optional work is currently being shed, see QualityGovernor
+    QualityTier getQualityTier() const { return qualityGovernor.getTier(); }
+    
+    // What this instance holds on to, including everything prepareToPlay allocated.
+    // Doesn't count the parameter tree or worker thread stacks.
+    size_t getMemoryFootprint() const;
+    
+    // How long this instance took to get going, in milliseconds, 0 until measured.
+    // Scanning and session load create a lot of instances, so these matter.
+    struct StartupTimings
+    {
+        std::atomic<double> constructor {0};
+        std::atomic<double> createToFirstBlock {0};
+        // From the editor's constructor to its first complete frame
+        std::atomic<double> editorOpenToFirstFrame {0};
+    };
+    
+    const StartupTimings& getStartupTimings() const { return startupTimings; }
+    void editorFirstFrameDrawn(juce::int64 editorOpenTicks);
+    
+    // Latest input/output levels for the editor, see LevelMeter::Readings
+    LevelMeter::Readings& getInputLevels() { return inputMeter.getReadings(); }
+    LevelMeter::Readings& getOutputLevels() { return outputMeter.getReadings(); }
+    
+    // Output for the editor's spectrogram, only filled while it's showing
+    AnalyzerFifo& getAnalyzerFifo() { return analyzerFifo; }
+    
+    // Where the dynamics currently have a path's Peak band, in dB
+    float getDynamicPeakGain(ChainPaths path) const { return dynamicPeaks[path].getCurrentGainDb(); }
+    
+    // A path's bands as they stand, dynamic Peak gain included, for
+    // FrequencyResponse::evaluate. Any thread but the audio thread.
+    FrequencyResponse::Snapshot getResponseSnapshot(ChainPaths path);
+    
+    // Logs every parameter change and block from here on, for SessionReplay.
+    // Message thread. Also started on the first prepareToPlay of the first
+    // instance when FIRSTJUCE_CAPTURE is set to a file, with the input audio
+    // if FIRSTJUCE_CAPTURE_AUDIO is set too.
+    bool startCapture(const juce::File& file, bool includeAudio);
+    void stopCapture() { sessionCapture.stop(); }
+    bool isCapturing() const { return sessionCapture.isCapturing(); }
+    
+    // Off keeps the QualityGovernor at Full, so nothing but the input and
+    // parameters changes the output
+    void setAdaptiveQuality(bool shouldAdapt) { qualityGovernor.setAdaptive(shouldAdapt); }
+    
+    // MIDI learn and the learnt CC/NRPN mappings, saved with the state
+    MidiControl& getMidiControl() { return midiControl; }
+    
 private:
     
-    MonoChain leftChain, rightChain;
+    ProcessingStats processingStats;
+    StartupTimings startupTimings;
+    bool firstBlockProcessed {false};
+    QualityGovernor qualityGovernor;
+    int blocksSinceFilterUpdate {0};
+    
+    // Fed by the cascade kernels, which meter the main bus as they load it
+    // and as they store it again; true peak is the only pass of their own.
+    // With "Metering" off the kernels skip it entirely.
+    LevelMeter inputMeter, outputMeter;
+    AnalyzerFifo analyzerFifo;
+    
+    SessionCapture sessionCapture;
+    bool captureFromEnvironment {false};
+    
+    // Only open when FIRSTJUCE_METRICS is set. Publishes every
+    // metricsIntervalSamples from the end of processBlock.
+    MetricsExporter metricsExporter;
+    int metricsIntervalSamples {0}, samplesSinceMetrics {0};
+    // What updateFilters last designed, per path
+    ChainSettings currentSettings[2];
+    void publishMetrics(int blockSize) noexcept;
+    int getNumSidechainChannels() const;
+    // Like getBusBuffer, but fills destination (MAX_CHANNELS long) with the
+    // bus's channel pointers instead of building an AudioBuffer, which
+    // allocates for more than 32 channels. Returns how many there are.
+    int getBusChannels(juce::AudioBuffer<float>& buffer, bool isInput, int busIndex, float** destination) const;
     
-    void updatePeakFilter(const ChainSettings &chainSettings);
-    void updateLowCutFilters(const ChainSettings& chainSettings);
-    void updateHighCutFilters(const ChainSettings& chainSettings);
+    // One per path. Detection runs on the input (or the sidechain) ahead of
+    // the cascades, which then take the Peak coefficients for every sub-block
+    // from dynamicPeakCoefficients; nullptr for a path whose band is static.
+    DynamicPeak dynamicPeaks[2];
+    DynamicPeak::Coefficients* dynamicPeakCoefficients[2] {};
+    void runDynamicPeaks(const float* const* channels, int numChannels, int start, int numSamples);
+    void makeDetectorSignal(const float* const* channels, int numChannels, int start, int numSamples,
+                            ChainPaths path, float* destination) const;
     
+    // Every bus channel is one lane of a cascade, channelsPerCascade lanes
+    // each, created in prepareToPlay. A stereo pair always shares one cascade,
+    // which is also where mid/side gets encoded/decoded.
+    juce::OwnedArray<FilterCascade> cascades;
+    int channelsPerCascade {4};
+    int numCascadeChannels {0};
+    StereoMode cascadeStereoMode {Stereo_Linked};
+    bool channelUsesPath(int channel, ChainPaths path) const;
+    
+    ChannelWorkerPool workerPool;
+    // The segment being processed, already offset to where it starts
+    float* currentChannels[MAX_CHANNELS] {};
+    int currentNumChannels {0}, currentNumSamples {0};
+    float* cascadeScratch[MAX_CHANNELS] {};
+    std::atomic<juce::int64> workTicks {0};
+    double smoothedWorkSeconds {0};
+    bool processInParallel {false};
+    
+    void processChannels(float* const* channels, int numChannels, int start, int numSamples);
+    static void processCascade(void* processor, int index);
+    
+    // All audio-thread scratch memory comes from here, see prepareToPlay
+    RealtimeArena arena;
+    size_t getArenaBytesNeeded(int samplesPerBlock, int numChannels) const;
+    
+    // Allocation free, so the filters can follow MIDI control mid-block
+    void updateBands(const ChainSettings& chainSettings, ChainPaths path);
     void updateFilters();
     
+    // Splits each block at its MIDI controller changes
+    MidiControl midiControl;
+    // Channel pointers are to the whole block, start is where the segment begins
+    void processSegment(float* const* mainChannels, int numMainChannels,
+                        float* const* sidechainChannels, int numSidechainChannels,
+                        int start, int numSamples);
+    
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FirstJUCEpluginAudioProcessor)
 };
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    ProcessingStats.cpp
+
+  ==============================================================================
+*/
+
+#include "ProcessingStats.h"
+
+void ProcessingStats::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void ProcessingStats::reset()
+{
+    numBlocks = 0;
+    deadlineMisses = 0;
+    totalTicks = 0;
+    maxTicks = 0;
+    totalLoad = 0;
+    lastLoad = 0;
+    maxLoad = 0;
+}
+
+double ProcessingStats::recordBlock(juce::int64 startTicks, juce::int64 endTicks, int numSamples) noexcept
+{
+    if (numSamples <= 0 || sampleRate <= 0) {
+        return 0.0;
+    }
+
+    auto ticks = endTicks - startTicks;
+    auto load = juce::Time::highResolutionTicksToSeconds(ticks) * sampleRate / numSamples;
+
+    // Only the audio thread writes, so plain load/store pairs are enough
+    auto relaxed = std::memory_order_relaxed;
+    numBlocks.store(numBlocks.load(relaxed) + 1, relaxed);
+    totalTicks.store(totalTicks.load(relaxed) + ticks, relaxed);
+    totalLoad.store(totalLoad.load(relaxed) + load, relaxed);
+    lastLoad.store(load, relaxed);
+
+    if (ticks > maxTicks.load(relaxed)) {
+        maxTicks.store(ticks, relaxed);
+    }
+    if (load > maxLoad.load(relaxed)) {
+        maxLoad.store(load, relaxed);
+    }
+    // A block that took longer than it lasts can't have made it out in time
+    if (load > 1.0) {
+        deadlineMisses.store(deadlineMisses.load(relaxed) + 1, relaxed);
+    }
+
+    return load;
+}
+
+ProcessingStats::Snapshot ProcessingStats::getSnapshot() const
+{
+    Snapshot snapshot;
+
+    snapshot.numBlocks = numBlocks.load();
+    snapshot.deadlineMisses = deadlineMisses.load();
+    snapshot.lastLoad = lastLoad.load();
+    snapshot.maxLoad = maxLoad.load();
+    snapshot.maxBlockMicroseconds = juce::Time::highResolutionTicksToSeconds(maxTicks.load()) * 1.0e6;
+
+    if (snapshot.numBlocks > 0) {
+        snapshot.meanLoad = totalLoad.load() / (double) snapshot.numBlocks;
+        snapshot.meanBlockMicroseconds = juce::Time::highResolutionTicksToSeconds(totalTicks.load()) * 1.0e6 / (double) snapshot.numBlocks;
+    }
+
+    return snapshot;
+}
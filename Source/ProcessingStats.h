@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    ProcessingStats.h
+
+    Per-instance processBlock timing. The audio thread records every block
+    with a handful of relaxed atomic writes; anything else (the editor, a
+    host-side load test, a metrics exporter) can take a snapshot at any time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct ProcessingStats
+{
+    struct Snapshot
+    {
+        juce::int64 numBlocks {0};
+        juce::int64 deadlineMisses {0};
+        // Processing time as a fraction of the block's real-time duration
+        double lastLoad {0}, meanLoad {0}, maxLoad {0};
+        double meanBlockMicroseconds {0}, maxBlockMicroseconds {0};
+        // Filled in by the processor, see QualityGovernor
+        int qualityTier {0};
+        juce::int64 qualityTierChanges {0};
+    };
+
+    // Message thread, from prepareToPlay
+    void prepare(double sampleRate);
+    void reset();
+
+    // Audio thread, once at the end of every block. Returns the block's load.
+    double recordBlock(juce::int64 startTicks, juce::int64 endTicks, int numSamples) noexcept;
+
+    Snapshot getSnapshot() const;
+
+private:
+    double sampleRate {44100};
+
+    std::atomic<juce::int64> numBlocks {0}, deadlineMisses {0};
+    std::atomic<juce::int64> totalTicks {0}, maxTicks {0};
+    std::atomic<double> totalLoad {0}, lastLoad {0}, maxLoad {0};
+};
@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.cpp
+
+  ==============================================================================
+*/
+
+#include "QualityGovernor.h"
+
+const char* getQualityTierName(QualityTier tier)
+{
+    switch (tier) {
+        case Quality_Full: return "Full";
+        case Quality_ReducedDisplay: return "Reduced Display";
+        case Quality_NoTruePeak: return "No True Peak";
+        case Quality_SlowCoefficients: return "Slow Coefficients";
+        case Quality_NoMetering: return "No Metering";
+        default: break;
+    }
+    return "";
+}
+
+void QualityGovernor::prepare(double newSampleRate)
+{
+    sampleRate = juce::jmax(1.0, newSampleRate);
+    reset();
+}
+
+void QualityGovernor::reset()
+{
+    smoothedLoad = 0;
+    secondsSinceChange = 0;
+    stepUpHoldSeconds = MIN_STEP_UP_HOLD_SECONDS;
+    lastChangeWasUp = false;
+    tier.store(Quality_Full, std::memory_order_relaxed);
+}
+
+void QualityGovernor::update(double load, int numSamples) noexcept
+{
+    if (!adaptive.load(std::memory_order_relaxed)) {
+        if (getTier() != Quality_Full) {
+            changeTier(Quality_Full);
+        }
+        return;
+    }
+
+    // One-pole smoothing with a SMOOTHING_SECONDS time constant, however long
+    // this block was
+    auto blockSeconds = numSamples / sampleRate;
+    auto smoothing = 1.0 - std::exp(-blockSeconds / SMOOTHING_SECONDS);
+    smoothedLoad += smoothing * (load - smoothedLoad);
+    secondsSinceChange += blockSeconds;
+
+    // The last step up held, so the next one needn't wait as long
+    if (lastChangeWasUp && secondsSinceChange >= STEP_UP_REGRET_SECONDS) {
+        stepUpHoldSeconds = juce::jmax(0.5 * stepUpHoldSeconds, MIN_STEP_UP_HOLD_SECONDS);
+        lastChangeWasUp = false;
+    }
+
+    auto current = (int) getTier();
+
+    auto underPressure = load > STEP_DOWN_BLOCK_LOAD || smoothedLoad > STEP_DOWN_MEAN_LOAD;
+    if (underPressure && current < NUM_QUALITY_TIERS - 1 && secondsSinceChange >= STEP_DOWN_HOLD_SECONDS) {
+        // That step up came too soon, wait longer before the next one
+        if (lastChangeWasUp && secondsSinceChange < STEP_UP_REGRET_SECONDS) {
+            stepUpHoldSeconds = juce::jmin(2.0 * stepUpHoldSeconds, MAX_STEP_UP_HOLD_SECONDS);
+        }
+        lastChangeWasUp = false;
+        changeTier(current + 1);
+        return;
+    }
+
+    if (smoothedLoad < STEP_UP_MEAN_LOAD && current > Quality_Full && secondsSinceChange >= stepUpHoldSeconds) {
+        lastChangeWasUp = true;
+        changeTier(current - 1);
+    }
+}
+
+void QualityGovernor::changeTier(int newTier) noexcept
+{
+    tier.store(static_cast<QualityTier>(newTier), std::memory_order_relaxed);
+    tierChanges.store(tierChanges.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    secondsSinceChange = 0;
+}
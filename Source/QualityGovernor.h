@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.h
+
+    Keeps an instance out of dropouts by shedding optional work before a
+    block actually misses its deadline. It watches every block's load (time
+    taken over the block's real-time duration) and steps one quality tier
+    down at a time when that gets close to 1, then back up once there's
+    plenty of headroom again. Stepping up waits longer each time it turns
+    out to have been too early, so a borderline load doesn't flip-flop.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Each tier keeps everything the one before it dropped
+enum QualityTier
+{
+    Quality_Full,
+    // The editor refreshes its meters and displays less often
+    Quality_ReducedDisplay,
+    // No 4x oversampled true peak in the meters
+    Quality_NoTruePeak,
+    // Filter coefficients follow the parameters every few blocks instead of every block
+    Quality_SlowCoefficients,
+    // No metering at all
+    Quality_NoMetering,
+    NUM_QUALITY_TIERS
+};
+
+const char* getQualityTierName(QualityTier tier);
+
+class QualityGovernor
+{
+public:
+    // Message thread, from prepareToPlay
+    void prepare(double sampleRate);
+    void reset();
+
+    // Audio thread, once per block with its load and its actual length,
+    // which hosts are free to make anything up to the prepared size
+    void update(double load, int numSamples) noexcept;
+
+    // Off holds the tier at Full whatever the load, so the output only
+    // depends on the input and parameters (see SessionReplay)
+    void setAdaptive(bool shouldAdapt) noexcept { adaptive.store(shouldAdapt, std::memory_order_relaxed); }
+
+    // Any thread
+    QualityTier getTier() const noexcept { return tier.load(std::memory_order_relaxed); }
+    juce::int64 getNumTierChanges() const noexcept { return tierChanges.load(std::memory_order_relaxed); }
+
+private:
+    // Step down when one block comes this close to its deadline, or the average does
+    static constexpr double STEP_DOWN_BLOCK_LOAD = 0.9;
+    static constexpr double STEP_DOWN_MEAN_LOAD = 0.7;
+    // Step up only below this, after the hold time
+    static constexpr double STEP_UP_MEAN_LOAD = 0.35;
+
+    static constexpr double SMOOTHING_SECONDS = 0.1;
+    // Lets a step down take effect before the next one
+    static constexpr double STEP_DOWN_HOLD_SECONDS = 0.05;
+    static constexpr double MIN_STEP_UP_HOLD_SECONDS = 2.0;
+    static constexpr double MAX_STEP_UP_HOLD_SECONDS = 30.0;
+    // Stepping down within this long of a step up doubles the step up hold
+    static constexpr double STEP_UP_REGRET_SECONDS = 5.0;
+
+    void changeTier(int newTier) noexcept;
+
+    double sampleRate {44100.0};
+    double smoothedLoad {0};
+    double secondsSinceChange {0};
+    double stepUpHoldSeconds {MIN_STEP_UP_HOLD_SECONDS};
+    bool lastChangeWasUp {false};
+
+    std::atomic<bool> adaptive {true};
+    std::atomic<QualityTier> tier {Quality_Full};
+    std::atomic<juce::int64> tierChanges {0};
+};
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    RealtimeArena.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeArena.h"
+
+void RealtimeArena::prepare(size_t numBytes)
+{
+    numBytes = alignUp(numBytes);
+
+    if (numBytes != capacity) {
+        // Writing every page here is what keeps the audio thread from taking
+        // the first-touch page faults. Allocating zeroed wouldn't: calloc gets
+        // blocks this size straight from mmap, already zero and never touched.
+        storage.allocate(numBytes + alignment, false);
+        memset(storage.get(), 0, numBytes + alignment);
+        auto address = reinterpret_cast<uintptr_t>(storage.get());
+        base = reinterpret_cast<char*>((address + alignment - 1) & ~(uintptr_t) (alignment - 1));
+        capacity = numBytes;
+    }
+
+    used = 0;
+    highWaterMark = 0;
+}
+
+void RealtimeArena::release()
+{
+    DBG("RealtimeArena high-water mark: " << (juce::int64) highWaterMark
+        << " of " << (juce::int64) capacity << " bytes");
+
+    storage.free();
+    base = nullptr;
+    capacity = 0;
+    used = 0;
+}
+
+void* RealtimeArena::allocateBytes(size_t numBytes) noexcept
+{
+    numBytes = alignUp(numBytes);
+
+    if (used + numBytes > capacity) {
+        // The arena was sized too small in prepareToPlay for what this block asked for
+        jassertfalse;
+        return nullptr;
+    }
+
+    auto* p = base + used;
+    used += numBytes;
+    highWaterMark = juce::jmax(highWaterMark, used);
+
+    return p;
+}
@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    RealtimeArena.h
+
+    Per-instance scratch memory for the audio thread. The arena is sized once
+    in prepareToPlay, handed out as cache-line aligned bump allocations during
+    processBlock and reset at the start of every block, so nothing running on
+    the audio thread ever has to reach the system allocator.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct RealtimeArena
+{
+    // One cache line on every platform we ship for
+    static constexpr size_t alignment = 64;
+
+    static constexpr size_t alignUp(size_t numBytes)
+    {
+        return (numBytes + alignment - 1) & ~(alignment - 1);
+    }
+
+    // Message thread only: (re)allocates and pre-faults the backing store
+    void prepare(size_t numBytes);
+    // Message thread only: hands the memory back to the system
+    void release();
+
+    // Audio thread: forget everything handed out during the previous block
+    void reset() noexcept { used = 0; }
+    // Audio thread: forget only what was handed out since getPosition(), e.g.
+    // to give each part of a split block the same scratch
+    size_t getPosition() const noexcept { return used; }
+    void rewind(size_t position) noexcept { jassert(position <= used); used = position; }
+
+    void* allocateBytes(size_t numBytes) noexcept;
+
+    template<typename T>
+    T* allocate(size_t count) noexcept
+    {
+        static_assert(alignof(T) <= alignment, "RealtimeArena cannot satisfy this alignment");
+        return static_cast<T*>(allocateBytes(count * sizeof(T)));
+    }
+
+    size_t getCapacity() const noexcept { return capacity; }
+    size_t getHighWaterMark() const noexcept { return highWaterMark; }
+
+private:
+    juce::HeapBlock<char> storage;
+    char* base = nullptr;
+    size_t capacity = 0, used = 0, highWaterMark = 0;
+};
@@ -0,0 +1,318 @@
+/*
+  ==============================================================================
+
+    SessionCapture.cpp
+
+  ==============================================================================
+*/
+
+#include "SessionCapture.h"
+#include "TraceRecorder.h"
+
+// How often the writer thread empties the FIFO
+static constexpr int WRITE_INTERVAL_MS = 20;
+static constexpr int MAX_PARAMETERS = 65535;
+
+SessionCapture::Session::Session(bool shouldIncludeAudio, const juce::Array<juce::AudioProcessorParameter*>& parametersToWatch)
+    : includeAudio(shouldIncludeAudio),
+      parameters(parametersToWatch),
+      lastValues((size_t) parametersToWatch.size()),
+      // All unmapped, so the first block logs every mapping there is
+      lastMappings((size_t) parametersToWatch.size(), 0),
+      changedIndices((size_t) parametersToWatch.size()),
+      // The biggest 'B' record up to its controllers
+      recordScratch((size_t) (1 + 4 + 2 + parametersToWatch.size() * 6 + 2 + parametersToWatch.size() * 6 + 2 + 2))
+{
+}
+
+SessionCapture::SessionCapture()
+    : juce::Thread("Session capture")
+{
+}
+
+SessionCapture::~SessionCapture()
+{
+    stop();
+}
+
+bool SessionCapture::start(const juce::File& file,
+                           bool shouldIncludeAudio,
+                           const juce::Array<juce::AudioProcessorParameter*>& parametersToWatch,
+                           double sampleRate,
+                           int maxBlockSize,
+                           int mainChannels,
+                           int sidechainChannels)
+{
+    stop();
+    jassert(parametersToWatch.size() <= MAX_PARAMETERS);
+
+    file.deleteFile();
+    auto newStream = std::make_unique<juce::FileOutputStream>(file);
+    if (newStream->failedToOpen()) {
+        return false;
+    }
+
+    auto newSession = std::make_unique<Session>(shouldIncludeAudio, parametersToWatch);
+    const auto& parameters = newSession->parameters;
+
+    newStream->write(magic, sizeof(magic));
+    newStream->writeInt((int) formatVersion);
+    newStream->writeInt((int) (shouldIncludeAudio ? flagAudio : 0));
+    newStream->writeInt(parameters.size());
+
+    for (auto* parameter : parameters) {
+        auto id = parameter->getName(1024);
+        if (auto* withId = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter)) {
+            id = withId->getParameterID();
+        }
+        auto utf8 = id.toUTF8();
+        auto length = (int) utf8.sizeInBytes() - 1;
+        newStream->writeShort((short) length);
+        newStream->write(utf8.getAddress(), (size_t) length);
+    }
+
+    for (int i = 0; i < parameters.size(); i++) {
+        newSession->lastValues[(size_t) i] = parameters.getUnchecked(i)->getValue();
+        newStream->writeFloat(newSession->lastValues[(size_t) i]);
+    }
+
+    newStream->writeByte(prepareRecord);
+    newStream->writeDouble(sampleRate);
+    newStream->writeInt(maxBlockSize);
+    newStream->writeInt(mainChannels);
+    newStream->writeInt(sidechainChannels);
+
+    stream = std::move(newStream);
+    currentSession = std::move(newSession);
+
+    startThread(juce::Thread::Priority::low);
+    // Fully built, the audio thread can have it
+    liveSession.store(currentSession.get(), std::memory_order_seq_cst);
+    return true;
+}
+
+void SessionCapture::stop()
+{
+    // Once the audio thread has been seen outside recordBlock with the
+    // session unpublished, it can't be holding on to it. Never longer than
+    // one recordBlock.
+    liveSession.store(nullptr, std::memory_order_seq_cst);
+    while (audioThreadInside.load(std::memory_order_seq_cst)) {
+        juce::Thread::yield();
+    }
+
+    if (isThreadRunning()) {
+        signalThreadShouldExit();
+        notify();
+        stopThread(5000);
+    }
+
+    if (stream != nullptr) {
+        writeQueued();
+        stream->flush();
+        stream.reset();
+    }
+
+    currentSession.reset();
+}
+
+bool SessionCapture::isCapturing() const noexcept
+{
+    return currentSession != nullptr && currentSession->capturing.load(std::memory_order_acquire);
+}
+
+// Recording Code
+//==============================================================================
+bool SessionCapture::push(Session& session, const void* data, int numBytes) noexcept
+{
+    auto& fifo = session.fifo;
+    if (fifo.getFreeSpace() < numBytes) {
+        return false;
+    }
+
+    auto scope = fifo.write(numBytes);
+    auto* source = static_cast<const char*>(data);
+    if (scope.blockSize1 > 0) {
+        memcpy(session.fifoStorage + scope.startIndex1, source, (size_t) scope.blockSize1);
+    }
+    if (scope.blockSize2 > 0) {
+        memcpy(session.fifoStorage + scope.startIndex2, source + scope.blockSize1, (size_t) scope.blockSize2);
+    }
+    return true;
+}
+
+// Holds stop() off while the audio thread has the live session
+struct SessionCapture::AudioThreadScope
+{
+    explicit AudioThreadScope(SessionCapture& c) : capture(c)
+    {
+        capture.audioThreadInside.store(true, std::memory_order_seq_cst);
+        session = capture.liveSession.load(std::memory_order_seq_cst);
+        if (session != nullptr && !session->capturing.load(std::memory_order_relaxed)) {
+            session = nullptr;
+        }
+    }
+
+    ~AudioThreadScope()
+    {
+        capture.audioThreadInside.store(false, std::memory_order_release);
+    }
+
+    SessionCapture& capture;
+    Session* session {nullptr};
+};
+
+void SessionCapture::recordPrepare(double sampleRate, int maxBlockSize, int mainChannels, int sidechainChannels) noexcept
+{
+    AudioThreadScope scope(*this);
+    if (scope.session == nullptr) {
+        return;
+    }
+    auto& session = *scope.session;
+
+    char record[1 + 8 + 3 * 4];
+    juce::MemoryOutputStream out(record, sizeof(record));
+    out.writeByte(prepareRecord);
+    out.writeDouble(sampleRate);
+    out.writeInt(maxBlockSize);
+    out.writeInt(mainChannels);
+    out.writeInt(sidechainChannels);
+
+    if (!push(session, record, (int) out.getPosition())) {
+        session.capturing.store(false, std::memory_order_release);
+    }
+}
+
+static bool isController(const juce::MidiMessageMetadata& metadata) noexcept
+{
+    return metadata.numBytes >= 3 && (metadata.data[0] & 0xf0) == 0xb0;
+}
+
+void SessionCapture::recordBlock(const juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi, const MidiControl& midiControl) noexcept
+{
+    AudioThreadScope scope(*this);
+    if (scope.session == nullptr) {
+        return;
+    }
+    auto& session = *scope.session;
+    const auto& parameters = session.parameters;
+    auto& lastValues = session.lastValues;
+    auto& changedIndices = session.changedIndices;
+    auto& recordScratch = session.recordScratch;
+
+    int numChanges = 0;
+    for (int i = 0; i < parameters.size(); i++) {
+        auto value = parameters.getUnchecked(i)->getValue();
+        if (value != lastValues[(size_t) i]) {
+            lastValues[(size_t) i] = value;
+            changedIndices[(size_t) numChanges++] = (juce::uint16) i;
+        }
+    }
+
+    int numControllers = 0;
+    for (const auto metadata : midi) {
+        numControllers += isController(metadata) ? 1 : 0;
+    }
+    numControllers = juce::jmin(numControllers, 65535);
+
+    auto numChannels = buffer.getNumChannels();
+    auto numSamples = buffer.getNumSamples();
+    auto controllerBytes = numControllers * (4 + 3);
+    auto audioBytes = session.includeAudio ? 4 + numChannels * numSamples * (int) sizeof(float) : 0;
+
+    // Fixed-size MemoryOutputStream over the scratch, so nothing here allocates
+    juce::MemoryOutputStream out(recordScratch.data(), recordScratch.size());
+    out.writeByte(blockRecord);
+    out.writeInt(numSamples);
+    out.writeShort((short) numChanges);
+    for (int i = 0; i < numChanges; i++) {
+        out.writeShort((short) changedIndices[(size_t) i]);
+        out.writeFloat(lastValues[changedIndices[(size_t) i]]);
+    }
+
+    // Mappings are compared like the parameters, and only go in the log
+    // once they've changed
+    auto numMappingChanges = 0;
+    auto numMappings = juce::jmin(parameters.size(), midiControl.getNumParameters());
+    auto mappingChangesPosition = out.getPosition();
+    out.writeShort(0);
+    for (int i = 0; i < numMappings; i++) {
+        auto mapping = midiControl.getPackedMapping(i);
+        if (mapping != session.lastMappings[(size_t) i]) {
+            session.lastMappings[(size_t) i] = mapping;
+            out.writeShort((short) i);
+            out.writeInt((int) mapping);
+            numMappingChanges++;
+        }
+    }
+    auto endOfMappings = out.getPosition();
+    out.setPosition(mappingChangesPosition);
+    out.writeShort((short) numMappingChanges);
+    out.setPosition(endOfMappings);
+
+    out.writeShort((short) juce::jlimit(-1, 32767, midiControl.getLearningParameter()));
+    out.writeShort((short) numControllers);
+
+    auto headerBytes = (int) out.getPosition();
+
+    // Has to go in whole or not at all. Once one doesn't, the log ends
+    // there, a gap would make everything after it replay wrongly.
+    if (session.fifo.getFreeSpace() < headerBytes + controllerBytes + audioBytes) {
+        session.capturing.store(false, std::memory_order_release);
+        return;
+    }
+
+    push(session, recordScratch.data(), headerBytes);
+
+    auto controllersLeft = numControllers;
+    for (const auto metadata : midi) {
+        if (controllersLeft == 0) {
+            break;
+        }
+        if (!isController(metadata)) {
+            continue;
+        }
+
+        char event[4 + 3];
+        juce::MemoryOutputStream eventOut(event, sizeof(event));
+        eventOut.writeInt(metadata.samplePosition);
+        eventOut.write(metadata.data, 3);
+        push(session, event, sizeof(event));
+        controllersLeft--;
+    }
+
+    if (session.includeAudio) {
+        char channels[4];
+        juce::MemoryOutputStream channelsOut(channels, sizeof(channels));
+        channelsOut.writeInt(numChannels);
+        push(session, channels, sizeof(channels));
+
+        for (int channel = 0; channel < numChannels; channel++) {
+            push(session, buffer.getReadPointer(channel), numSamples * (int) sizeof(float));
+        }
+    }
+}
+
+// Writer Code
+//==============================================================================
+void SessionCapture::writeQueued()
+{
+    TRACE_SCOPE("SessionCapture::writeQueued");
+    // The session outlives the writer thread, stop() ends one before the other
+    auto& fifo = currentSession->fifo;
+    auto scope = fifo.read(fifo.getNumReady());
+    if (scope.blockSize1 > 0) {
+        stream->write(currentSession->fifoStorage + scope.startIndex1, (size_t) scope.blockSize1);
+    }
+    if (scope.blockSize2 > 0) {
+        stream->write(currentSession->fifoStorage + scope.startIndex2, (size_t) scope.blockSize2);
+    }
+}
+
+void SessionCapture::run()
+{
+    while (!threadShouldExit()) {
+        wait(WRITE_INTERVAL_MS);
+        writeQueued();
+    }
+}
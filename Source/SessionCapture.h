@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    SessionCapture.h
+
+    Records what a host actually did to the plugin, so a problem seen in
+    the field can be replayed exactly (see SessionReplay): every parameter
+    change with the block it arrived before, every block size, every
+    prepareToPlay, the MIDI controllers with MidiControl's mappings and
+    learning state, and, optionally, the input audio. The controllers are
+    what move parameters mid-block, so the replay feeds them through
+    MidiControl again rather than relying on the parameter changes, which
+    only show up once the message thread has caught up.
+
+    The audio thread only compares parameter values and copies into a
+    lock-free FIFO; a background thread writes the FIFO to disk. If the
+    writer ever falls behind, the capture stops there rather than leave a
+    hole, so whatever was written still replays exactly.
+
+    Everything a capture needs lives in a Session that start() builds in
+    full before publishing it to the audio thread with one atomic store;
+    stop() unpublishes it and waits for the audio thread to be out of
+    recordBlock before freeing it. Nothing the audio thread reads is ever
+    resized under it.
+
+    File format, little-endian:
+        "FJCP", u32 version, u32 flags (1 = audio), u32 numParameters,
+        numParameters x (u16 length, UTF-8 parameter ID),
+        numParameters x f32 normalised value at the start,
+        then records:
+        'P' f64 sampleRate, i32 maxBlockSize, i32 mainChannels, i32 sidechainChannels
+        'B' i32 numSamples, u16 numChanges, numChanges x (u16 parameter, f32 normalised value),
+            u16 numMappingChanges, numMappingChanges x (u16 parameter, u32 MidiControl packed mapping),
+            i16 learning parameter (-1 for none),
+            u16 numControllers, numControllers x (i32 sample position, 3 bytes of the CC message),
+            and with audio i32 numChannels, numChannels x numSamples x f32
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MidiControl.h"
+
+class SessionCapture : private juce::Thread
+{
+public:
+    static constexpr juce::uint32 formatVersion = 2;
+    static constexpr juce::uint32 flagAudio = 1;
+    static constexpr char magic[4] = {'F', 'J', 'C', 'P'};
+    static constexpr char prepareRecord = 'P';
+    static constexpr char blockRecord = 'B';
+
+    SessionCapture();
+    ~SessionCapture() override;
+
+    // Message thread. Writes the header and the current parameter values
+    // straight away; blocks follow once capturing. False if the file can't
+    // be created.
+    bool start(const juce::File& file,
+               bool includeAudio,
+               const juce::Array<juce::AudioProcessorParameter*>& parameters,
+               double sampleRate,
+               int maxBlockSize,
+               int mainChannels,
+               int sidechainChannels);
+    // Message thread. Writes out whatever is still queued.
+    void stop();
+
+    // Message thread
+    bool isCapturing() const noexcept;
+
+    // From prepareToPlay, while no blocks are being processed
+    void recordPrepare(double sampleRate, int maxBlockSize, int mainChannels, int sidechainChannels) noexcept;
+
+    // Audio thread, at the top of processBlock before the buffer is touched
+    // and before midiControl sees the MIDI. Never blocks or allocates.
+    void recordBlock(const juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi, const MidiControl& midiControl) noexcept;
+
+private:
+    // About 20 s of stereo 48 kHz audio, or hours of parameter changes
+    static constexpr int FIFO_BYTES = 8 << 20;
+
+    struct Session
+    {
+        explicit Session(bool includeAudio, const juce::Array<juce::AudioProcessorParameter*>& parameters);
+
+        const bool includeAudio;
+        const juce::Array<juce::AudioProcessorParameter*> parameters;
+
+        // Audio thread only once published
+        std::vector<float> lastValues;
+        std::vector<juce::uint32> lastMappings;
+        std::vector<juce::uint16> changedIndices;
+        std::vector<char> recordScratch;
+
+        // Audio thread writes, writer thread reads
+        juce::AbstractFifo fifo {FIFO_BYTES};
+        juce::HeapBlock<char> fifoStorage {FIFO_BYTES};
+
+        // Cleared by the audio thread once a record doesn't fit
+        std::atomic<bool> capturing {true};
+    };
+
+    void run() override;
+    void writeQueued();
+
+    struct AudioThreadScope;
+
+    // All or nothing, false if it doesn't fit
+    static bool push(Session& session, const void* data, int numBytes) noexcept;
+
+    // Owned by the message thread; liveSession is what the audio thread
+    // sees, and audioThreadInside is set while it's looking at it
+    std::unique_ptr<Session> currentSession;
+    std::atomic<Session*> liveSession {nullptr};
+    std::atomic<bool> audioThreadInside {false};
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+};
@@ -0,0 +1,438 @@
+/*
+  ==============================================================================
+
+    SessionReplay.cpp
+
+  ==============================================================================
+*/
+
+#include "SessionReplay.h"
+#include "SessionCapture.h"
+#include "PluginProcessor.h"
+#include "CascadeKernels.h"
+
+static constexpr juce::uint64 FNV_OFFSET_BASIS = 14695981039346656037ull;
+static constexpr juce::uint64 FNV_PRIME = 1099511628211ull;
+// Input level when the log has no audio, about -12 dBFS peak
+static constexpr float NOISE_LEVEL = 0.25f;
+static constexpr int INPUT_BUFFER_BYTES = 1 << 16;
+// Parameter indices are 16 bit in the records
+static constexpr int MAX_PARAMETERS = 65535;
+// Well past any real bus, anything more is a corrupt count
+static constexpr int MAX_CHANNELS = 1024;
+static constexpr int MAX_BLOCK_SIZE = 1 << 20;
+
+namespace SessionReplay
+{
+
+namespace
+{
+    struct Header
+    {
+        juce::uint32 version {0};
+        bool hasAudio {false};
+        juce::StringArray parameterIds;
+        std::vector<float> initialValues;
+    };
+
+    bool readHeader(juce::InputStream& in, Header& header, juce::String& error)
+    {
+        char magic[4] {};
+        if (in.read(magic, sizeof(magic)) != (int) sizeof(magic) || memcmp(magic, SessionCapture::magic, sizeof(magic)) != 0) {
+            error = "Not a session capture";
+            return false;
+        }
+
+        // Version 1 had no MIDI controllers, it still replays without them
+        header.version = (juce::uint32) in.readInt();
+        if (header.version < 1 || header.version > SessionCapture::formatVersion) {
+            error = "Capture format " + juce::String(header.version) + " isn't supported";
+            return false;
+        }
+
+        header.hasAudio = ((juce::uint32) in.readInt() & SessionCapture::flagAudio) != 0;
+
+        // Every parameter takes at least a length and an initial value
+        auto numParameters = in.readInt();
+        if (numParameters < 0 || numParameters > MAX_PARAMETERS || in.getNumBytesRemaining() < (juce::int64) numParameters * (2 + 4)) {
+            error = "The capture's parameter count (" + juce::String(numParameters) + ") is corrupt";
+            return false;
+        }
+        for (int i = 0; i < numParameters && !in.isExhausted(); i++) {
+            auto length = (int) (juce::uint16) in.readShort();
+            juce::MemoryBlock id;
+            in.readIntoMemoryBlock(id, length);
+            header.parameterIds.add(id.toString());
+        }
+        for (int i = 0; i < numParameters && !in.isExhausted(); i++) {
+            header.initialValues.push_back(in.readFloat());
+        }
+
+        if (in.isExhausted() || (int) header.initialValues.size() != numParameters) {
+            error = "The capture ends in its header";
+            return false;
+        }
+        return true;
+    }
+
+    bool setLayout(juce::AudioProcessor& processor, int mainChannels, int sidechainChannels)
+    {
+        auto channelSet = [](int numChannels) {
+            if (numChannels <= 0) {
+                return juce::AudioChannelSet::disabled();
+            }
+            auto set = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+            return set.isDisabled() ? juce::AudioChannelSet::discreteChannels(numChannels) : set;
+        };
+
+        auto layout = processor.getBusesLayout();
+        layout.inputBuses.getReference(0) = channelSet(mainChannels);
+        layout.outputBuses.getReference(0) = channelSet(mainChannels);
+        if (layout.inputBuses.size() > 1) {
+            layout.inputBuses.getReference(1) = channelSet(sidechainChannels);
+        }
+        return processor.setBusesLayout(layout);
+    }
+
+    juce::uint64 hashBytes(juce::uint64 hash, const void* data, size_t numBytes) noexcept
+    {
+        auto* bytes = static_cast<const juce::uint8*>(data);
+        for (size_t i = 0; i < numBytes; i++) {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        }
+        return hash;
+    }
+}
+
+// Replay Code
+//==============================================================================
+// One pass over the log with a new processor. The log's own statistics only
+// go into the report on the first pass.
+static bool replayOnce(const juce::File& log, const Options& options, Run& run, Report& report, bool firstPass)
+{
+    auto file = std::make_unique<juce::FileInputStream>(log);
+    if (!file->openedOk()) {
+        report.error = "Can't open " + log.getFullPathName();
+        return false;
+    }
+    juce::BufferedInputStream in(file.release(), INPUT_BUFFER_BYTES, true);
+
+    Header header;
+    if (!readHeader(in, header, report.error)) {
+        return false;
+    }
+    if (firstPass) {
+        report.hadAudio = header.hasAudio;
+    }
+
+    auto processor = std::make_unique<FirstJUCEpluginAudioProcessor>();
+    processor->setAdaptiveQuality(false);
+    processor->multiCoreAllowed = options.multiCore;
+
+    // Controllers only set the raw values here; the parameter changes they
+    // led to come from the log, where they happened
+    auto& midiControl = processor->getMidiControl();
+    midiControl.stopNotificationTimer();
+
+    // Index in the log to this build's parameter, nullptr where there isn't one
+    juce::Array<juce::AudioProcessorParameter*> parameters;
+    for (int i = 0; i < header.parameterIds.size(); i++) {
+        auto* parameter = processor->apvts.getParameter(header.parameterIds[i]);
+        parameters.add(parameter);
+
+        if (parameter != nullptr) {
+            parameter->setValueNotifyingHost(header.initialValues[(size_t) i]);
+        } else if (firstPass) {
+            report.unknownParameters.add(header.parameterIds[i]);
+        }
+    }
+
+    juce::AudioBuffer<float> buffer;
+    juce::MidiBuffer midi;
+    juce::Random noise(options.noiseSeed);
+    auto outputHash = FNV_OFFSET_BASIS;
+    auto prepared = false;
+
+    // Records are all or nothing in the FIFO, so a log only ends mid-record
+    // if the file itself was cut short. Either way it replays up to there.
+    while (!in.isExhausted()) {
+        auto type = (char) in.readByte();
+
+        if (type == SessionCapture::prepareRecord) {
+            if (in.getNumBytesRemaining() < 8 + 3 * 4) {
+                break;
+            }
+            auto sampleRate = in.readDouble();
+            auto maxBlockSize = in.readInt();
+            auto mainChannels = in.readInt();
+            auto sidechainChannels = in.readInt();
+            if (maxBlockSize <= 0 || maxBlockSize > MAX_BLOCK_SIZE) {
+                report.error = "Corrupt block size " + juce::String(maxBlockSize) + " in prepareToPlay";
+                return false;
+            }
+
+            if (prepared) {
+                processor->releaseResources();
+            }
+            if (!setLayout(*processor, mainChannels, sidechainChannels)) {
+                report.error = "The captured layout (" + juce::String(mainChannels) + " channels, "
+                    + juce::String(sidechainChannels) + " sidechain) isn't supported";
+                return false;
+            }
+
+            processor->setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+            processor->prepareToPlay(sampleRate, maxBlockSize);
+            buffer.setSize(juce::jmax(processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels()), maxBlockSize);
+            prepared = true;
+
+            if (firstPass) {
+                report.numPrepares++;
+            }
+            continue;
+        }
+
+        if (type != SessionCapture::blockRecord) {
+            report.error = "Unknown record at byte " + juce::String(in.getPosition() - 1);
+            return false;
+        }
+        if (!prepared) {
+            report.error = "A block comes before any prepareToPlay";
+            return false;
+        }
+
+        if (in.getNumBytesRemaining() < 4 + 2) {
+            break;
+        }
+        auto numSamples = in.readInt();
+        if (numSamples < 0 || numSamples > MAX_BLOCK_SIZE) {
+            report.error = "Corrupt block size " + juce::String(numSamples) + " at byte " + juce::String(in.getPosition() - 4);
+            return false;
+        }
+        auto numChanges = (int) (juce::uint16) in.readShort();
+        if (in.getNumBytesRemaining() < numChanges * 6) {
+            break;
+        }
+
+        for (int i = 0; i < numChanges; i++) {
+            auto index = (int) (juce::uint16) in.readShort();
+            auto value = in.readFloat();
+            if (auto* parameter = parameters[index]) {
+                parameter->setValueNotifyingHost(value);
+            }
+        }
+
+        midi.clear();
+        auto numControllers = 0;
+
+        if (header.version >= 2) {
+            if (in.getNumBytesRemaining() < 2) {
+                break;
+            }
+            auto numMappingChanges = (int) (juce::uint16) in.readShort();
+            if (in.getNumBytesRemaining() < numMappingChanges * 6 + 2 + 2) {
+                break;
+            }
+
+            // The log's parameter indices aren't necessarily this build's
+            for (int i = 0; i < numMappingChanges; i++) {
+                auto index = (int) (juce::uint16) in.readShort();
+                auto mapping = (juce::uint32) in.readInt();
+                if (auto* parameter = parameters[index]) {
+                    midiControl.setPackedMapping(parameter->getParameterIndex(), mapping);
+                }
+            }
+
+            auto learning = (int) in.readShort();
+            if (auto* parameter = learning >= 0 ? parameters[learning] : nullptr) {
+                midiControl.startLearning(parameter->getParameterIndex());
+            } else {
+                midiControl.stopLearning();
+            }
+
+            numControllers = (int) (juce::uint16) in.readShort();
+            if (in.getNumBytesRemaining() < numControllers * (4 + 3)) {
+                break;
+            }
+            for (int i = 0; i < numControllers; i++) {
+                auto sample = in.readInt();
+                juce::uint8 bytes[3] {};
+                in.read(bytes, sizeof(bytes));
+                midi.addEvent(bytes, sizeof(bytes), sample);
+            }
+        }
+
+        // Keeps the allocation from prepareToPlay unless the host sent a bigger block
+        buffer.setSize(buffer.getNumChannels(), numSamples, false, false, true);
+
+        if (header.hasAudio) {
+            if (in.getNumBytesRemaining() < 4) {
+                break;
+            }
+            auto numChannels = in.readInt();
+            if (numChannels < 0 || numChannels > MAX_CHANNELS) {
+                report.error = "Corrupt channel count " + juce::String(numChannels) + " at byte " + juce::String(in.getPosition() - 4);
+                return false;
+            }
+            auto bytesPerChannel = (juce::int64) numSamples * (juce::int64) sizeof(float);
+            if (in.getNumBytesRemaining() < numChannels * bytesPerChannel) {
+                break;
+            }
+
+            for (int channel = 0; channel < numChannels; channel++) {
+                if (channel < buffer.getNumChannels()) {
+                    in.read(buffer.getWritePointer(channel), (int) bytesPerChannel);
+                } else {
+                    in.skipNextBytes(bytesPerChannel);
+                }
+            }
+            for (int channel = numChannels; channel < buffer.getNumChannels(); channel++) {
+                buffer.clear(channel, 0, numSamples);
+            }
+        } else {
+            buffer.clear();
+            for (int channel = 0; channel < processor->getTotalNumInputChannels(); channel++) {
+                auto* samples = buffer.getWritePointer(channel);
+                for (int i = 0; i < numSamples; i++) {
+                    samples[i] = NOISE_LEVEL * (2.0f * noise.nextFloat() - 1.0f);
+                }
+            }
+        }
+
+        auto start = juce::Time::getHighResolutionTicks();
+        processor->processBlock(buffer, midi);
+        auto end = juce::Time::getHighResolutionTicks();
+        run.blockMicroseconds.push_back(1.0e6 * juce::Time::highResolutionTicksToSeconds(end - start));
+
+        auto blockHash = FNV_OFFSET_BASIS;
+        for (int channel = 0; channel < processor->getTotalNumOutputChannels(); channel++) {
+            auto* samples = buffer.getReadPointer(channel);
+            blockHash = hashBytes(blockHash, samples, (size_t) numSamples * sizeof(float));
+            outputHash = hashBytes(outputHash, samples, (size_t) numSamples * sizeof(float));
+        }
+        run.blockHashes.push_back(blockHash);
+
+        if (firstPass) {
+            report.numBlocks++;
+            report.numParameterChanges += numChanges;
+            report.numControllers += numControllers;
+            report.blockSizes.push_back(numSamples);
+            report.audioSeconds += numSamples / processor->getSampleRate();
+        }
+    }
+
+    if (prepared) {
+        processor->releaseResources();
+    }
+
+    run.outputHash = outputHash;
+    return true;
+}
+
+Report run(const juce::File& log, const Options& options)
+{
+    Report report;
+
+    using CascadeKernels::ISA;
+    auto originalISA = CascadeKernels::getActiveISA();
+    std::vector<ISA> engines;
+    if (options.allEngines) {
+        for (auto isa : {ISA::Scalar, ISA::SSE2, ISA::AVX2, ISA::AVX512, ISA::NEON}) {
+            if (CascadeKernels::isSupported(isa)) {
+                engines.push_back(isa);
+            }
+        }
+    } else {
+        engines.push_back(originalISA);
+    }
+
+    for (auto isa : engines) {
+        if (isa != CascadeKernels::getActiveISA()) {
+            CascadeKernels::forceISA(isa);
+        }
+
+        Run engineRun;
+        engineRun.engine = CascadeKernels::getName(isa);
+        if (!replayOnce(log, options, engineRun, report, report.runs.empty())) {
+            break;
+        }
+        report.runs.push_back(std::move(engineRun));
+    }
+
+    if (CascadeKernels::getActiveISA() != originalISA) {
+        CascadeKernels::forceISA(originalISA);
+    }
+
+    return report;
+}
+
+// Report Code
+//==============================================================================
+double Run::getPercentileMicroseconds(double percentile) const
+{
+    if (blockMicroseconds.empty()) {
+        return 0;
+    }
+
+    auto sorted = blockMicroseconds;
+    auto index = (size_t) juce::jlimit(0.0, (double) sorted.size() - 1.0, std::ceil(percentile / 100.0 * (double) sorted.size()) - 1.0);
+    std::nth_element(sorted.begin(), sorted.begin() + (std::ptrdiff_t) index, sorted.end());
+    return sorted[index];
+}
+
+juce::String Report::toString() const
+{
+    juce::String text;
+
+    if (!succeeded()) {
+        text << "Replay failed: " << error << juce::newLine;
+    }
+
+    text << "Replayed " << numBlocks << " blocks (" << juce::String(audioSeconds, 1) << " s of "
+         << (hadAudio ? "captured audio" : "noise") << "), " << numParameterChanges << " parameter changes, "
+         << numControllers << " MIDI controllers, "
+         << numPrepares << " prepareToPlay" << juce::newLine;
+
+    if (!unknownParameters.isEmpty()) {
+        text << "Not in this build, skipped: " << unknownParameters.joinIntoString(", ") << juce::newLine;
+    }
+
+    for (auto& run : runs) {
+        auto totalMicroseconds = std::accumulate(run.blockMicroseconds.begin(), run.blockMicroseconds.end(), 0.0);
+        auto mean = run.blockMicroseconds.empty() ? 0.0 : totalMicroseconds / (double) run.blockMicroseconds.size();
+
+        text << run.engine.paddedRight(' ', 8)
+             << "mean " << juce::String(mean, 1) << " us  "
+             << "p50 " << juce::String(run.getPercentileMicroseconds(50), 1) << " us  "
+             << "p99 " << juce::String(run.getPercentileMicroseconds(99), 1) << " us  "
+             << "max " << juce::String(run.getPercentileMicroseconds(100), 1) << " us  "
+             << juce::String(totalMicroseconds > 0 ? 1.0e6 * audioSeconds / totalMicroseconds : 0.0, 0) << "x real time  "
+             << "output " << juce::String::toHexString((juce::int64) run.outputHash).paddedLeft('0', 16)
+             << juce::newLine;
+    }
+
+    return text;
+}
+
+bool Report::writeCsv(const juce::File& file) const
+{
+    juce::String csv;
+
+    csv << "block,samples";
+    for (auto& run : runs) {
+        csv << "," << run.engine << " us," << run.engine << " hash";
+    }
+    csv << juce::newLine;
+
+    for (int block = 0; block < numBlocks; block++) {
+        csv << block << "," << blockSizes[(size_t) block];
+        for (auto& run : runs) {
+            csv << "," << juce::String(run.blockMicroseconds[(size_t) block], 2)
+                << "," << juce::String::toHexString((juce::int64) run.blockHashes[(size_t) block]).paddedLeft('0', 16);
+        }
+        csv << juce::newLine;
+    }
+
+    return file.replaceWithText(csv);
+}
+
+}
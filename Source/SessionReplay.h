@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    SessionReplay.h
+
+    Plays a SessionCapture log back through a fresh processor with no host
+    and no editor: the same prepareToPlay calls, block sizes, parameter
+    changes and MIDI controllers (with the MIDI learn mappings they went
+    through) in the same order, and the captured input, or fixed noise if the
+    log has none. Every block is timed and its output hashed, so a replay
+    is both a benchmark of a real session and a bit-exact regression check
+    against an earlier build.
+
+    The QualityGovernor is held at Full throughout, so the output only
+    depends on the log and the filter engine. Like EngineConformance it
+    needs nothing but the processor; the harness's replay command runs it
+    on a log from the terminal.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace SessionReplay
+{
+    struct Options
+    {
+        // Replays once per filter kernel this CPU supports rather than just
+        // the active one. Switches every FilterCascade over while it runs, so
+        // only when nothing else is processing audio.
+        bool allEngines {false};
+        bool multiCore {true};
+        // For the input noise when the log has no audio
+        juce::int64 noiseSeed {1};
+    };
+
+    struct Run
+    {
+        juce::String engine;
+        // One entry per block, in order
+        std::vector<double> blockMicroseconds;
+        // 64-bit FNV-1a of each block's output samples
+        std::vector<juce::uint64> blockHashes;
+        // The same over the whole output, so two runs match only if every block does
+        juce::uint64 outputHash {0};
+
+        double getPercentileMicroseconds(double percentile) const;
+    };
+
+    struct Report
+    {
+        // Empty if the log replayed. A log cut short (by the writer falling
+        // behind) still replays up to where it ends.
+        juce::String error;
+
+        int numBlocks {0}, numParameterChanges {0}, numControllers {0}, numPrepares {0};
+        std::vector<int> blockSizes;
+        double audioSeconds {0};
+        bool hadAudio {false};
+        // Parameter IDs in the log this build doesn't have, their changes are skipped
+        juce::StringArray unknownParameters;
+
+        std::vector<Run> runs;
+
+        bool succeeded() const { return error.isEmpty(); }
+        juce::String toString() const;
+        // One row per block: its number and size, then time and hash for every run
+        bool writeCsv(const juce::File& file) const;
+    };
+
+    // Message thread or a background thread, takes about as long as the
+    // session did divided by the plugin's real-time factor, per run
+    Report run(const juce::File& log, const Options& options = {});
+}
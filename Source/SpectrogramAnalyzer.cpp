@@ -0,0 +1,218 @@
+/*
+  ==============================================================================
+
+    SpectrogramAnalyzer.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrogramAnalyzer.h"
+#include "TraceRecorder.h"
+
+// Analyzer Fifo Code
+//==============================================================================
+AnalyzerFifo::AnalyzerFifo() :
+buffer((size_t) capacity, true)
+{
+}
+
+void AnalyzerFifo::prepare(double newSampleRate)
+{
+    // The audio thread is stopped but the analyzer thread may not be, so the
+    // read position is left for it to move
+    sampleRate.store(newSampleRate, std::memory_order_relaxed);
+    discardPending.store(true, std::memory_order_release);
+}
+
+void AnalyzerFifo::push(const float* const* channels, int numChannels, int numSamples) noexcept
+{
+    if (numChannels <= 0) {
+        return;
+    }
+
+    auto gain = 1.f / (float) numChannels;
+    const auto scope = fifo.write(numSamples);
+
+    auto mix = [&](int destination, int source, int count) {
+        auto* out = buffer + destination;
+        juce::FloatVectorOperations::copyWithMultiply(out, channels[0] + source, gain, count);
+        for (int ch = 1; ch < numChannels; ch++) {
+            juce::FloatVectorOperations::addWithMultiply(out, channels[ch] + source, gain, count);
+        }
+    };
+
+    mix(scope.startIndex1, 0, scope.blockSize1);
+    mix(scope.startIndex2, scope.blockSize1, scope.blockSize2);
+}
+
+int AnalyzerFifo::pull(float* destination, int maxSamples) noexcept
+{
+    if (discardPending.exchange(false, std::memory_order_acquire)) {
+        fifo.finishedRead(fifo.getNumReady());
+    }
+
+    const auto scope = fifo.read(maxSamples);
+
+    std::copy(buffer + scope.startIndex1, buffer + scope.startIndex1 + scope.blockSize1, destination);
+    std::copy(buffer + scope.startIndex2, buffer + scope.startIndex2 + scope.blockSize2, destination + scope.blockSize1);
+
+    return scope.blockSize1 + scope.blockSize2;
+}
+
+// Spectrogram Analyzer Code
+//==============================================================================
+SpectrogramAnalyzer::SpectrogramAnalyzer(AnalyzerFifo& fifoToRead) :
+juce::Thread("Spectrogram Analyzer"),
+fifo(fifoToRead),
+samples((size_t) fftSize, 0.f),
+fftData((size_t) (2 * fftSize), 0.f),
+columnStorage((size_t) (maxPendingColumns * numRows)),
+image(juce::Image::ARGB, historyLength, numRows, true)
+{
+    juce::ColourGradient gradient;
+    gradient.addColour(0.0, juce::Colours::black);
+    gradient.addColour(0.3, juce::Colour(30u, 10u, 90u));
+    gradient.addColour(0.6, juce::Colour(97u, 18u, 167u));
+    gradient.addColour(0.85, juce::Colour(255u, 147u, 1u));
+    gradient.addColour(1.0, juce::Colours::lightyellow);
+
+    for (int i = 0; i < lutSize; i++) {
+        colourLut[i] = gradient.getColourAtPosition((double) i / (lutSize - 1)).getPixelARGB();
+    }
+}
+
+SpectrogramAnalyzer::~SpectrogramAnalyzer()
+{
+    stop();
+}
+
+void SpectrogramAnalyzer::start()
+{
+    fifo.setActive(true);
+    startThread(juce::Thread::Priority::low);
+}
+
+void SpectrogramAnalyzer::stop()
+{
+    fifo.setActive(false);
+    stopThread(1000);
+}
+
+void SpectrogramAnalyzer::run()
+{
+    int filled = 0;
+
+    while (!threadShouldExit()) {
+        // Slide the window along by one hop at a time
+        filled += fifo.pull(samples.data() + (fftSize - hopSize) + filled, hopSize - filled);
+        if (filled < hopSize) {
+            wait(5);
+            continue;
+        }
+        filled = 0;
+
+        if (frameCounter++ % decimation.load(std::memory_order_relaxed) == 0) {
+            analyseFrame();
+        }
+
+        std::copy(samples.begin() + hopSize, samples.end(), samples.begin());
+    }
+}
+
+void SpectrogramAnalyzer::updateRowBins(double sampleRate)
+{
+    rowBinsSampleRate = sampleRate;
+    auto binWidth = sampleRate / fftSize;
+    auto lastBin = fftSize / 2 - 1;
+
+    // Row 0 is the top, 20 kHz
+    for (int row = 0; row < numRows; row++) {
+        auto upper = juce::mapToLog10(1.0 - (double) row / numRows, 20.0, 20000.0);
+        auto lower = juce::mapToLog10(1.0 - (double) (row + 1) / numRows, 20.0, 20000.0);
+
+        auto start = juce::jlimit(1, lastBin, (int) std::floor(lower / binWidth));
+        auto end = juce::jlimit(start + 1, lastBin + 1, (int) std::ceil(upper / binWidth));
+        rowBinStart[row] = start;
+        rowBinEnd[row] = end;
+    }
+}
+
+void SpectrogramAnalyzer::analyseFrame() noexcept
+{
+    TRACE_SCOPE("SpectrogramAnalyzer::analyseFrame");
+    auto sampleRate = fifo.getSampleRate();
+    if (sampleRate != rowBinsSampleRate) {
+        updateRowBins(sampleRate);
+    }
+
+    std::copy(samples.begin(), samples.end(), fftData.begin());
+    window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    const auto scope = pendingColumns.write(1);
+    if (scope.blockSize1 == 0) {
+        // The message thread has fallen behind, this column is dropped
+        return;
+    }
+    auto* column = columnStorage + scope.startIndex1 * numRows;
+
+    // A full scale sine comes out at fftSize / 4 through a Hann window
+    const float normalise = 4.f / fftSize;
+    const float minDb = -100.f;
+
+    for (int row = 0; row < numRows; row++) {
+        float magnitude = 0;
+        for (int bin = rowBinStart[row]; bin < rowBinEnd[row]; bin++) {
+            magnitude = juce::jmax(magnitude, fftData[(size_t) bin]);
+        }
+
+        auto db = juce::Decibels::gainToDecibels(magnitude * normalise, minDb);
+        auto index = juce::jlimit(0, lutSize - 1, (int) ((db - minDb) / -minDb * (lutSize - 1)));
+        column[row] = colourLut[index];
+    }
+}
+
+bool SpectrogramAnalyzer::updateImage()
+{
+    auto numReady = pendingColumns.getNumReady();
+    if (numReady == 0) {
+        return false;
+    }
+
+    const auto scope = pendingColumns.read(numReady);
+    juce::Image::BitmapData pixels(image, juce::Image::BitmapData::writeOnly);
+
+    auto copyColumns = [&](int start, int count) {
+        for (int c = start; c < start + count; c++) {
+            auto* column = columnStorage + c * numRows;
+            for (int row = 0; row < numRows; row++) {
+                *reinterpret_cast<juce::PixelARGB*>(pixels.getPixelPointer(writeColumn, row)) = column[row];
+            }
+            writeColumn = (writeColumn + 1) % historyLength;
+        }
+    };
+
+    copyColumns(scope.startIndex1, scope.blockSize1);
+    copyColumns(scope.startIndex2, scope.blockSize2);
+
+    return true;
+}
+
+void SpectrogramAnalyzer::draw(juce::Graphics& g, juce::Rectangle<int> area, float opacity) const
+{
+    // Two blits: the oldest columns (from writeColumn to the end) then the newest
+    auto olderColumns = historyLength - writeColumn;
+    auto olderWidth = juce::roundToInt(area.getWidth() * (double) olderColumns / historyLength);
+
+    juce::Graphics::ScopedSaveState state(g);
+    g.setOpacity(opacity);
+    g.drawImage(image,
+                area.getX(), area.getY(), olderWidth, area.getHeight(),
+                writeColumn, 0, olderColumns, numRows);
+
+    if (writeColumn > 0) {
+        g.drawImage(image,
+                    area.getX() + olderWidth, area.getY(), area.getWidth() - olderWidth, area.getHeight(),
+                    0, 0, writeColumn, numRows);
+    }
+}
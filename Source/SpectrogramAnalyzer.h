@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    SpectrogramAnalyzer.h
+
+    A scrolling spectrogram of the plugin's output. The audio thread pushes
+    a mono mix into an AnalyzerFifo (only while a spectrogram is showing);
+    a background thread takes it from there, runs the FFT and turns every
+    frame into one finished column of pixels through a fixed colour table.
+    The message thread then only has to copy new columns into a ring of
+    image columns and draw that as two blits, so a frame costs the same no
+    matter how much history is on screen.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+// Single producer (the audio thread), single consumer (the analyzer thread).
+// The buffer is allocated once at its full size, so prepare() can run while
+// the analyzer thread is still pulling.
+class AnalyzerFifo
+{
+public:
+    // A third of a second at 192 kHz, plenty for the analyzer thread to keep up
+    static constexpr int capacity = 1 << 16;
+
+    AnalyzerFifo();
+
+    // Message thread, from prepareToPlay. Whatever is still queued from
+    // before gets dropped by the analyzer thread on its next pull.
+    void prepare(double sampleRate);
+
+    // The audio thread only pushes while someone is listening
+    void setActive(bool shouldBeActive) noexcept { active.store(shouldBeActive, std::memory_order_relaxed); }
+    bool isActive() const noexcept { return active.load(std::memory_order_relaxed); }
+
+    // Audio thread. Mixes the channels down to mono; whatever doesn't fit is dropped.
+    void push(const float* const* channels, int numChannels, int numSamples) noexcept;
+
+    // Analyzer thread. Returns how many samples were copied into destination.
+    int pull(float* destination, int maxSamples) noexcept;
+
+    double getSampleRate() const noexcept { return sampleRate.load(std::memory_order_relaxed); }
+    size_t getMemoryFootprint() const noexcept { return (size_t) fifo.getTotalSize() * sizeof(float); }
+
+private:
+    juce::AbstractFifo fifo {capacity};
+    juce::HeapBlock<float> buffer;
+    std::atomic<bool> active {false};
+    std::atomic<bool> discardPending {false};
+    std::atomic<double> sampleRate {44100.0};
+};
+
+class SpectrogramAnalyzer : private juce::Thread
+{
+public:
+    // Columns of history kept, and rows (log spaced from 20 Hz to 20 kHz)
+    static constexpr int historyLength = 512;
+    static constexpr int numRows = 256;
+
+    explicit SpectrogramAnalyzer(AnalyzerFifo& fifoToRead);
+    ~SpectrogramAnalyzer() override;
+
+    // Message thread
+    void start();
+    void stop();
+
+    // Only every nth frame is analysed, for when CPU is short
+    void setDecimation(int everyNthFrame) noexcept { decimation.store(juce::jmax(1, everyNthFrame), std::memory_order_relaxed); }
+
+    // Message thread: copies finished columns into the image. Returns true if
+    // there were any, i.e. it needs drawing again.
+    bool updateImage();
+
+    // Message thread: oldest column on the left, newest on the right
+    void draw(juce::Graphics& g, juce::Rectangle<int> area, float opacity) const;
+
+private:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int hopSize = fftSize / 4;
+    static constexpr int maxPendingColumns = 64;
+
+    void run() override;
+    void analyseFrame() noexcept;
+    void updateRowBins(double sampleRate);
+
+    AnalyzerFifo& fifo;
+
+    // Analyzer thread only
+    juce::dsp::FFT fft {fftOrder};
+    juce::dsp::WindowingFunction<float> window {fftSize, juce::dsp::WindowingFunction<float>::hann, false};
+    std::vector<float> samples, fftData;
+    int frameCounter {0};
+    double rowBinsSampleRate {0};
+    // FFT bins [rowBinStart[r], rowBinEnd[r]) go into row r, the loudest wins
+    int rowBinStart[numRows] {}, rowBinEnd[numRows] {};
+    std::atomic<int> decimation {1};
+
+    // Fixed dB to colour table, so a column costs the same whatever it holds
+    static constexpr int lutSize = 256;
+    juce::PixelARGB colourLut[lutSize];
+
+    // Finished columns on their way to the message thread
+    juce::AbstractFifo pendingColumns {maxPendingColumns};
+    juce::HeapBlock<juce::PixelARGB> columnStorage;
+
+    // Message thread only. writeColumn is where the next column goes, so
+    // it's also where the oldest one is.
+    juce::Image image;
+    int writeColumn {0};
+};
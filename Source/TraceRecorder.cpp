@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.cpp
+
+  ==============================================================================
+*/
+
+#include "TraceRecorder.h"
+
+TraceRecorder& TraceRecorder::getInstance()
+{
+    static TraceRecorder instance;
+    return instance;
+}
+
+TraceRecorder::TraceRecorder() : originTicks(juce::Time::getHighResolutionTicks())
+{
+    if (juce::SystemStats::getEnvironmentVariable("FIRSTJUCE_TRACE", {}).isNotEmpty()) {
+        setEnabled(true);
+    }
+}
+
+void TraceRecorder::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled) {
+        // Rings are never freed, a thread may still be writing to one after
+        // tracing has been turned off
+        for (auto& ring : rings) {
+            if (ring.events == nullptr) {
+                ring.events.reset(new Event[eventsPerThread]);
+            }
+        }
+    }
+
+    enabled.store(shouldBeEnabled, std::memory_order_release);
+}
+
+TraceRecorder::ThreadRing* TraceRecorder::getRingForThisThread() noexcept
+{
+    // -1 until this thread records for the first time, -2 if every ring was taken
+    thread_local int ringIndex = -1;
+
+    if (ringIndex == -1) {
+        auto index = numRings.fetch_add(1, std::memory_order_relaxed);
+        ringIndex = index < maxThreads ? index : -2;
+
+        if (ringIndex >= 0) {
+            auto& ring = rings[ringIndex];
+            if (threadNameOverride != nullptr) {
+                juce::String(threadNameOverride).copyToUTF8(ring.threadName, sizeof(ring.threadName));
+            } else if (auto* thread = juce::Thread::getCurrentThread()) {
+                thread->getThreadName().copyToUTF8(ring.threadName, sizeof(ring.threadName));
+            } else if (juce::MessageManager::existsAndIsCurrentThread()) {
+                juce::String("Message Thread").copyToUTF8(ring.threadName, sizeof(ring.threadName));
+            }
+        }
+    }
+
+    return ringIndex >= 0 ? &rings[ringIndex] : nullptr;
+}
+
+void TraceRecorder::record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept
+{
+    // Pairs with the release in setEnabled, so the rings are there
+    if (!enabled.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    auto* ring = getRingForThisThread();
+    if (ring == nullptr) {
+        return;
+    }
+
+    auto position = ring->written.load(std::memory_order_relaxed);
+    auto& event = ring->events[position & (eventsPerThread - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(startTicks, std::memory_order_relaxed);
+    event.end.store(endTicks, std::memory_order_relaxed);
+    ring->written.store(position + 1, std::memory_order_release);
+}
+
+bool TraceRecorder::dumpToFile(const juce::File& file) const
+{
+    juce::MemoryOutputStream json;
+    auto toMicroseconds = [this](juce::int64 ticks) {
+        return juce::Time::highResolutionTicksToSeconds(ticks - originTicks) * 1.0e6;
+    };
+
+    json << "{\"traceEvents\":[" << juce::newLine;
+    json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"" << JucePlugin_Name << "\"}}";
+
+    auto numThreads = juce::jmin(numRings.load(std::memory_order_relaxed), maxThreads);
+
+    for (int tid = 0; tid < numThreads; tid++) {
+        auto& ring = rings[tid];
+        if (ring.events == nullptr) {
+            continue;
+        }
+
+        juce::String threadName(juce::CharPointer_UTF8(ring.threadName));
+        if (threadName.isEmpty()) {
+            // Not one of ours, most likely the host's audio thread
+            threadName = "Host Thread " + juce::String(tid);
+        }
+        json << "," << juce::newLine
+             << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+             << ",\"args\":{\"name\":" << juce::JSON::toString(threadName) << "}}";
+
+        // Copy out what's there, then drop anything the thread may have
+        // overwritten while we were copying
+        auto end = ring.written.load(std::memory_order_acquire);
+        auto begin = juce::jmax((juce::int64) 0, end - eventsPerThread);
+
+        for (auto i = begin; i < end; i++) {
+            auto& event = ring.events[i & (eventsPerThread - 1)];
+            auto* name = event.name.load(std::memory_order_relaxed);
+            auto start = event.start.load(std::memory_order_relaxed);
+            auto finish = event.end.load(std::memory_order_relaxed);
+
+            auto oldestIntact = ring.written.load(std::memory_order_acquire) - eventsPerThread;
+            if (name == nullptr || i <= oldestIntact) {
+                continue;
+            }
+
+            json << "," << juce::newLine
+                 << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                 << ",\"ts\":" << juce::String(toMicroseconds(start), 3)
+                 << ",\"dur\":" << juce::String(toMicroseconds(finish) - toMicroseconds(start), 3) << "}";
+        }
+    }
+
+    json << juce::newLine << "]}" << juce::newLine;
+
+    return file.replaceWithData(json.getData(), json.getDataSize());
+}
+
+juce::File TraceRecorder::getDefaultDumpFile() const
+{
+    auto time = juce::Time::getCurrentTime().formatted("%Y-%m-%d %H-%M-%S");
+    return juce::File::getSpecialLocation(juce::File::userDesktopDirectory)
+        .getChildFile(juce::String(JucePlugin_Name) + " trace " + time + ".json");
+}
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.h
+
+    A flight recorder for finding out what was running when a session
+    glitched. Every thread that records gets its own lock-free ring of
+    timed events, written only by that thread; dumpToFile() turns whatever
+    the rings currently hold into a Chrome trace (chrome://tracing, or
+    ui.perfetto.dev).
+
+    Put TRACE_SCOPE("name") at the top of anything worth seeing. While
+    tracing is off that's one relaxed load and a branch on a local bool at
+    either end. Names must be
+    string literals, only the pointer is stored.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class TraceRecorder
+{
+public:
+    // Events each thread keeps before the oldest get overwritten
+    static constexpr int eventsPerThread = 1 << 14;
+    static constexpr int maxThreads = 32;
+
+    static TraceRecorder& getInstance();
+
+    // Message thread. Turning it on allocates every ring up front, so the
+    // threads being traced never have to. Also on at start-up when the
+    // FIRSTJUCE_TRACE environment variable is set.
+    void setEnabled(bool shouldBeEnabled);
+    static bool isEnabled() noexcept { return enabled.load(std::memory_order_relaxed); }
+
+    // Any thread, before it first records: what the dump calls it instead of
+    // its juce::Thread name. For threads JUCE names generically, like a
+    // ThreadPool's. The name must be a string literal.
+    static void setThreadName(const char* name) noexcept { threadNameOverride = name; }
+
+    // Any thread, never blocks or allocates
+    void record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+
+    // Message thread. Safe while other threads keep recording; events being
+    // overwritten during the dump are left out.
+    bool dumpToFile(const juce::File& file) const;
+    juce::File getDefaultDumpFile() const;
+
+private:
+    TraceRecorder();
+
+    struct Event
+    {
+        std::atomic<const char*> name {nullptr};
+        std::atomic<juce::int64> start {0}, end {0};
+    };
+
+    struct ThreadRing
+    {
+        std::atomic<juce::int64> written {0};
+        char threadName[32] {};
+        std::unique_ptr<Event[]> events;
+    };
+
+    ThreadRing* getRingForThisThread() noexcept;
+
+    // Static so checking it doesn't go through getInstance()
+    static inline std::atomic<bool> enabled {false};
+    static inline thread_local const char* threadNameOverride {nullptr};
+    std::atomic<int> numRings {0};
+    ThreadRing rings[maxThreads];
+    // Ticks are relative to this in the dump
+    juce::int64 originTicks;
+
+    JUCE_DECLARE_NON_COPYABLE(TraceRecorder)
+};
+
+// Records the enclosing scope as one event when tracing is on. Whether it is
+// is read once, on the way in; the destructor's branch only tests that copy,
+// so a scope is recorded whole or not at all even if tracing is switched
+// halfway through it.
+struct TraceScope
+{
+    explicit TraceScope(const char* scopeName) noexcept
+        : active(TraceRecorder::isEnabled()), name(scopeName)
+    {
+        if (active) {
+            start = juce::Time::getHighResolutionTicks();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (active) {
+            TraceRecorder::getInstance().record(name, start, juce::Time::getHighResolutionTicks());
+        }
+    }
+
+    const bool active;
+    const char* const name;
+    juce::int64 start {0};
+
+    JUCE_DECLARE_NON_COPYABLE(TraceScope)
+};
+
+#define TRACE_SCOPE_CONCAT_INNER(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_SCOPE_CONCAT(traceScope_, __LINE__) (name)
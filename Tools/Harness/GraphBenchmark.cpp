@@ -0,0 +1,764 @@
+/*
+  ==============================================================================
+
+    GraphBenchmark.cpp
+
+  ==============================================================================
+*/
+
+#include "GraphBenchmark.h"
+#include "../../Source/PluginProcessor.h"
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#endif
+
+namespace GraphBenchmark
+{
+
+// How long a scheduling thread busy-waits for the next block before blocking
+static constexpr int SPIN_COUNT = 2000;
+// Noise the sources play, long enough not to sound like a loop to the filters
+static constexpr int NOISE_SAMPLES = 1 << 16;
+// What the plugin is called in a .filtergraph
+static constexpr const char* PLUGIN_NAME = "FirstJUCEplugin";
+
+// Description Code
+//==============================================================================
+// A graph before anything in it exists, so it can be copied
+enum NodeType
+{
+    Node_Plugin,
+    Node_Source,
+    Node_PassThrough,
+    Node_Output
+};
+
+struct Description
+{
+    struct Node
+    {
+        NodeType type;
+        juce::String name;
+        int numChannels {2};
+        // Shared by every copy, like the audio device's input and output
+        bool shared {false};
+        juce::MemoryBlock state;
+    };
+
+    struct Edge
+    {
+        int source, sourceChannel, destination, destinationChannel;
+    };
+
+    juce::String name;
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+
+    int getNumPlugins() const
+    {
+        return (int) std::count_if(nodes.begin(), nodes.end(), [](const Node& n) { return n.type == Node_Plugin; });
+    }
+};
+
+static Description makeTracks(int numInstances, int chainLength)
+{
+    Description description;
+    chainLength = juce::jmax(1, chainLength);
+    description.name = "generated, " + juce::String(chainLength) + " per track";
+
+    // One track; copies of it make up the session, all into the one output
+    description.nodes.push_back({Node_Output, "Output", 2, true, {}});
+    description.nodes.push_back({Node_Source, "Track Source", 2, false, {}});
+
+    auto numPlugins = juce::jmin(chainLength, numInstances);
+    for (int i = 0; i < numPlugins; i++) {
+        auto previous = (int) description.nodes.size() - 1;
+        description.nodes.push_back({Node_Plugin, PLUGIN_NAME, 2, false, {}});
+        for (int ch = 0; ch < 2; ch++) {
+            description.edges.push_back({previous, ch, previous + 1, ch});
+        }
+    }
+
+    auto last = (int) description.nodes.size() - 1;
+    for (int ch = 0; ch < 2; ch++) {
+        description.edges.push_back({last, ch, 0, ch});
+    }
+
+    return description;
+}
+
+static juce::String loadFilterGraph(const juce::File& file, Description& description)
+{
+    auto xml = juce::XmlDocument::parse(file);
+    if (xml == nullptr || !xml->hasTagName("FILTERGRAPH")) {
+        return "Couldn't read " + file.getFullPathName() + " as a filter graph";
+    }
+
+    description.name = file.getFileName();
+    std::map<int, int> nodeForUid;
+
+    for (auto* filter : xml->getChildWithTagNameIterator("FILTER")) {
+        auto* plugin = filter->getChildByName("PLUGIN");
+        if (plugin == nullptr) {
+            continue;
+        }
+
+        auto name = plugin->getStringAttribute("name");
+        auto internal = plugin->getStringAttribute("format") == "Internal";
+        auto numInputs = plugin->getIntAttribute("numInputs");
+        auto numOutputs = plugin->getIntAttribute("numOutputs");
+
+        Description::Node node;
+        node.name = name;
+        node.numChannels = juce::jlimit(1, MAX_CHANNELS, juce::jmax(numInputs, numOutputs, 2));
+
+        if (name == PLUGIN_NAME) {
+            node.type = Node_Plugin;
+            node.numChannels = 2;
+            node.state.fromBase64Encoding(filter->getChildElementAllSubText("STATE", {}).trim());
+        } else if (internal && name == "Audio Input") {
+            node.type = Node_Source;
+            node.shared = true;
+        } else if (internal && name == "Audio Output") {
+            node.type = Node_Output;
+            node.shared = true;
+        } else if (internal && name.startsWith("MIDI")) {
+            // Nothing to do with audio
+            continue;
+        } else {
+            node.type = numInputs == 0 && numOutputs > 0 ? Node_Source : Node_PassThrough;
+        }
+
+        nodeForUid[filter->getIntAttribute("uid")] = (int) description.nodes.size();
+        description.nodes.push_back(std::move(node));
+    }
+
+    for (auto* connection : xml->getChildWithTagNameIterator("CONNECTION")) {
+        auto source = nodeForUid.find(connection->getIntAttribute("srcFilter"));
+        auto destination = nodeForUid.find(connection->getIntAttribute("dstFilter"));
+        auto sourceChannel = connection->getIntAttribute("srcChannel");
+        auto destinationChannel = connection->getIntAttribute("dstChannel");
+
+        // MIDI connections use juce::AudioProcessorGraph::midiChannelIndex
+        if (source == nodeForUid.end() || destination == nodeForUid.end()
+            || sourceChannel == juce::AudioProcessorGraph::midiChannelIndex) {
+            continue;
+        }
+
+        if (!juce::isPositiveAndBelow(sourceChannel, description.nodes[(size_t) source->second].numChannels)
+            || !juce::isPositiveAndBelow(destinationChannel, description.nodes[(size_t) destination->second].numChannels)) {
+            continue;
+        }
+
+        description.edges.push_back({source->second, sourceChannel, destination->second, destinationChannel});
+    }
+
+    if (description.getNumPlugins() == 0) {
+        return file.getFileName() + " has no " + PLUGIN_NAME + " in it";
+    }
+
+    return {};
+}
+
+// Graph Code
+//==============================================================================
+struct Node
+{
+    NodeType type;
+    std::unique_ptr<FirstJUCEpluginAudioProcessor> processor;
+    std::unique_ptr<juce::AudioProcessorEditor> editor;
+
+    juce::AudioBuffer<float> buffer;
+    juce::MidiBuffer midi;
+
+    struct Input
+    {
+        int source, sourceChannel, channel;
+    };
+    std::vector<Input> inputs;
+    // Nodes this one feeds, each once
+    std::vector<int> outputs;
+    int numDependencies {0};
+    std::atomic<int> pending {0};
+
+    // Only touched by whichever thread processes the node
+    juce::Random random;
+    int samplesToAutomation {0};
+    int noiseOffset {0};
+};
+
+// Every node that becomes ready in a block goes in exactly once, so it
+// never needs more than a slot per node and empties itself
+struct ReadyQueue
+{
+    void prepare(int numNodes)
+    {
+        slots = std::vector<std::atomic<int>>((size_t) numNodes);
+    }
+
+    // Only while nobody is pushing or popping
+    void reset() noexcept
+    {
+        for (auto& slot : slots) {
+            slot.store(-1, std::memory_order_relaxed);
+        }
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    void push(int node) noexcept
+    {
+        auto slot = tail.fetch_add(1, std::memory_order_acq_rel);
+        slots[(size_t) slot].store(node, std::memory_order_release);
+    }
+
+    bool pop(int& node) noexcept
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        do {
+            if (h >= tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+        } while (!head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel));
+
+        // Claimed, but the pusher may not have written it yet
+        while ((node = slots[(size_t) h].load(std::memory_order_acquire)) < 0) {
+        }
+        return true;
+    }
+
+    std::vector<std::atomic<int>> slots;
+    std::atomic<int> head {0}, tail {0};
+};
+
+class Graph
+{
+public:
+    Graph(const Options& optionsToUse, const Description& description, int numCopies)
+        : options(optionsToUse), noise(1, NOISE_SAMPLES)
+    {
+        juce::Random random(options.seed);
+        for (int i = 0; i < NOISE_SAMPLES; i++) {
+            noise.setSample(0, i, 0.25f * (random.nextFloat() * 2.f - 1.f));
+        }
+
+        // Shared nodes once, everything else once per copy
+        std::vector<std::vector<int>> nodeFor(description.nodes.size());
+        for (size_t i = 0; i < description.nodes.size(); i++) {
+            const auto& info = description.nodes[i];
+            auto count = info.shared ? 1 : numCopies;
+            for (int copy = 0; copy < count; copy++) {
+                nodeFor[i].push_back(addNode(info, random));
+            }
+        }
+
+        for (int copy = 0; copy < numCopies; copy++) {
+            for (const auto& edge : description.edges) {
+                auto& sources = nodeFor[(size_t) edge.source];
+                auto& destinations = nodeFor[(size_t) edge.destination];
+                auto source = sources[sources.size() == 1 ? 0 : (size_t) copy];
+                auto destination = destinations[destinations.size() == 1 ? 0 : (size_t) copy];
+
+                // Shared to shared only needs connecting once
+                if (copy > 0 && sources.size() == 1 && destinations.size() == 1) {
+                    continue;
+                }
+                connect(source, edge.sourceChannel, destination, edge.destinationChannel);
+            }
+        }
+
+        readyQueue.prepare(nodes.size());
+    }
+
+    ~Graph()
+    {
+        stopThreads();
+
+        // Editors have to go before their processors
+        for (auto* node : nodes) {
+            node->editor.reset();
+        }
+    }
+
+    // Anything left over would never be processed
+    bool hasCycle() const
+    {
+        std::vector<int> remaining;
+        std::vector<int> ready;
+        for (int i = 0; i < nodes.size(); i++) {
+            remaining.push_back(nodes[i]->numDependencies);
+            if (remaining.back() == 0) {
+                ready.push_back(i);
+            }
+        }
+
+        int numVisited = 0;
+        while (!ready.empty()) {
+            auto node = ready.back();
+            ready.pop_back();
+            numVisited++;
+            for (auto output : nodes[node]->outputs) {
+                if (--remaining[(size_t) output] == 0) {
+                    ready.push_back(output);
+                }
+            }
+        }
+        return numVisited != nodes.size();
+    }
+
+    int getNumNodes() const { return nodes.size(); }
+    int getNumInstances() const { return numInstances; }
+
+    size_t getFootprintPerInstance() const
+    {
+        size_t total = 0;
+        for (auto* node : nodes) {
+            if (node->processor != nullptr) {
+                total += node->processor->getMemoryFootprint();
+            }
+        }
+        return numInstances > 0 ? total / (size_t) numInstances : 0;
+    }
+
+    void prepare()
+    {
+        for (auto* node : nodes) {
+            if (node->processor != nullptr) {
+                node->processor->setRateAndBufferSizeDetails(options.sampleRate, options.blockSize);
+                node->processor->prepareToPlay(options.sampleRate, options.blockSize);
+            }
+            if (options.withEditors && node->processor != nullptr) {
+                node->editor.reset(node->processor->createEditorIfNeeded());
+            }
+        }
+    }
+
+    void release()
+    {
+        for (auto* node : nodes) {
+            if (node->processor != nullptr) {
+                node->processor->releaseResources();
+            }
+        }
+    }
+
+    Report process(Report report)
+    {
+        auto numCpus = juce::SystemStats::getNumCpus();
+        auto numThreads = options.numThreads > 0 ? options.numThreads : numCpus;
+        numThreads = juce::jlimit(1, 64, numThreads);
+        threadStats = std::vector<ThreadStats>((size_t) numThreads);
+        pinThreads = numThreads <= numCpus;
+
+        startThreads(numThreads);
+        pinToCore(0);
+
+        auto blockTicks = juce::Time::secondsToHighResolutionTicks(options.blockSize / options.sampleRate);
+        auto numBlocks = juce::jmax(1, (int) (options.seconds * options.sampleRate / options.blockSize));
+        std::vector<double> blockMicroseconds;
+        blockMicroseconds.reserve((size_t) numBlocks);
+
+        auto runStart = juce::Time::getHighResolutionTicks();
+        auto nextBlock = runStart;
+
+        for (int block = 0; block < numBlocks; block++) {
+            if (options.paced) {
+                waitUntil(nextBlock);
+            }
+
+            // Deadlines count from when the block was due, so a late start counts too
+            auto due = options.paced ? nextBlock : juce::Time::getHighResolutionTicks();
+            processBlock();
+            auto ticks = juce::Time::getHighResolutionTicks() - due;
+
+            blockMicroseconds.push_back(1.0e6 * juce::Time::highResolutionTicksToSeconds(ticks));
+            report.deadlineMisses += ticks > blockTicks ? 1 : 0;
+            nextBlock += blockTicks;
+        }
+
+        auto runTicks = juce::Time::getHighResolutionTicks() - runStart;
+        stopThreads();
+
+        report.numBlocks = numBlocks;
+        report.meanBlockMicroseconds = std::accumulate(blockMicroseconds.begin(), blockMicroseconds.end(), 0.0) / numBlocks;
+        report.maxBlockMicroseconds = *std::max_element(blockMicroseconds.begin(), blockMicroseconds.end());
+        auto p99 = blockMicroseconds.begin() + (std::ptrdiff_t) juce::jmin(blockMicroseconds.size() - 1, (size_t) (0.99 * numBlocks));
+        std::nth_element(blockMicroseconds.begin(), p99, blockMicroseconds.end());
+        report.p99BlockMicroseconds = *p99;
+
+        for (int t = 0; t < numThreads; t++) {
+            auto& stats = threadStats[(size_t) t];
+            ThreadLoad load;
+            load.core = pinThreads ? t : -1;
+            load.utilisation = (double) stats.busyTicks / (double) juce::jmax((juce::int64) 1, runTicks);
+            load.numNodesProcessed = stats.numNodes;
+            report.threads.add(load);
+            report.numParameterChanges += stats.numParameterChanges;
+        }
+
+        return report;
+    }
+
+private:
+    int addNode(const Description::Node& info, juce::Random& random)
+    {
+        auto* node = nodes.add(new Node());
+        node->type = info.type;
+        node->random.setSeed(random.nextInt64());
+        node->noiseOffset = random.nextInt(NOISE_SAMPLES);
+
+        auto numChannels = info.numChannels;
+        if (info.type == Node_Plugin) {
+            node->processor = std::make_unique<FirstJUCEpluginAudioProcessor>();
+            if (info.state.getSize() > 0) {
+                node->processor->setStateInformation(info.state.getData(), (int) info.state.getSize());
+            }
+            numChannels = juce::jmax(node->processor->getTotalNumInputChannels(), node->processor->getTotalNumOutputChannels());
+            node->samplesToAutomation = getSamplesToAutomation(*node);
+            numInstances++;
+        }
+
+        node->buffer.setSize(numChannels, options.blockSize);
+        node->buffer.clear();
+        node->midi.ensureSize(256);
+        return nodes.size() - 1;
+    }
+
+    void connect(int source, int sourceChannel, int destination, int channel)
+    {
+        auto& destinationNode = *nodes[destination];
+        if (channel >= destinationNode.buffer.getNumChannels() || sourceChannel >= nodes[source]->buffer.getNumChannels()) {
+            return;
+        }
+
+        destinationNode.inputs.push_back({source, sourceChannel, channel});
+
+        auto& outputs = nodes[source]->outputs;
+        if (std::find(outputs.begin(), outputs.end(), destination) == outputs.end()) {
+            outputs.push_back(destination);
+            destinationNode.numDependencies++;
+        }
+    }
+
+    int getSamplesToAutomation(Node& node) const
+    {
+        if (options.automationPerSecond <= 0) {
+            return std::numeric_limits<int>::max();
+        }
+        // Anywhere from none to twice the average interval
+        auto interval = options.sampleRate / options.automationPerSecond;
+        return juce::jmax(1, (int) (2.0 * interval * node.random.nextDouble()));
+    }
+
+    // Threads Code
+    //==============================================================================
+    struct ThreadStats
+    {
+        alignas(64) juce::int64 busyTicks {0};
+        int numNodes {0};
+        juce::int64 numParameterChanges {0};
+    };
+
+    struct Worker : juce::Thread
+    {
+        Worker(Graph& g, int participantIndex)
+            : juce::Thread("Graph Worker " + juce::String(participantIndex)),
+              graph(g), index(participantIndex),
+              seen(g.generation.load(std::memory_order_relaxed))
+        {
+        }
+
+        void run() override
+        {
+            graph.pinToCore(index);
+
+            while (!threadShouldExit()) {
+                auto current = graph.generation.load(std::memory_order_acquire);
+                for (int spin = 0; current == seen && spin < SPIN_COUNT; spin++) {
+                    current = graph.generation.load(std::memory_order_acquire);
+                }
+
+                if (current == seen) {
+                    wake.wait(1);
+                    continue;
+                }
+
+                seen = current;
+                graph.runNodes(index);
+                graph.activeParticipants.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+
+        Graph& graph;
+        const int index;
+        juce::uint32 seen;
+        juce::WaitableEvent wake;
+    };
+
+    void startThreads(int numThreads)
+    {
+        // The calling thread is participant 0, like a host's audio callback
+        for (int i = 1; i < numThreads; i++) {
+            auto* worker = workers.add(new Worker(*this, i));
+            worker->startRealtimeThread(juce::Thread::RealtimeOptions{});
+        }
+    }
+
+    void stopThreads()
+    {
+        for (auto* worker : workers) {
+            worker->signalThreadShouldExit();
+            worker->wake.signal();
+        }
+        for (auto* worker : workers) {
+            worker->stopThread(1000);
+        }
+        workers.clear();
+    }
+
+    void pinToCore(int index)
+    {
+        if (pinThreads) {
+            juce::Thread::setCurrentThreadAffinityMask((juce::uint32) 1 << (index % 32));
+        }
+    }
+
+    static void waitUntil(juce::int64 ticks)
+    {
+        // Sleep most of the way, then spin, since sleeps overshoot
+        auto margin = juce::Time::secondsToHighResolutionTicks(0.002);
+        while (ticks - juce::Time::getHighResolutionTicks() > margin) {
+            juce::Thread::sleep(1);
+        }
+        while (juce::Time::getHighResolutionTicks() < ticks) {
+        }
+    }
+
+    // Scheduler Code
+    //==============================================================================
+    void processBlock()
+    {
+        // Everyone is idle here, so the queue and counters can be reset
+        readyQueue.reset();
+        for (int i = 0; i < nodes.size(); i++) {
+            auto* node = nodes.getUnchecked(i);
+            node->pending.store(node->numDependencies, std::memory_order_relaxed);
+            if (node->numDependencies == 0) {
+                readyQueue.push(i);
+            }
+        }
+
+        remainingNodes.store(nodes.size(), std::memory_order_relaxed);
+        activeParticipants.store(workers.size() + 1, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+        for (auto* worker : workers) {
+            worker->wake.signal();
+        }
+
+        runNodes(0);
+        activeParticipants.fetch_sub(1, std::memory_order_acq_rel);
+
+        // Nothing is left to process, the others are only moments from noticing
+        while (activeParticipants.load(std::memory_order_acquire) != 0) {
+        }
+    }
+
+    void runNodes(int participant) noexcept
+    {
+        auto& stats = threadStats[(size_t) participant];
+        int index;
+
+        while (remainingNodes.load(std::memory_order_acquire) > 0) {
+            if (!readyQueue.pop(index)) {
+                continue;
+            }
+
+            auto start = juce::Time::getHighResolutionTicks();
+            processNode(*nodes.getUnchecked(index), stats);
+            stats.busyTicks += juce::Time::getHighResolutionTicks() - start;
+            stats.numNodes++;
+
+            for (auto output : nodes.getUnchecked(index)->outputs) {
+                if (nodes.getUnchecked(output)->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    readyQueue.push(output);
+                }
+            }
+            remainingNodes.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    void processNode(Node& node, ThreadStats& stats) noexcept
+    {
+        auto& buffer = node.buffer;
+        auto numSamples = options.blockSize;
+
+        if (node.type == Node_Source) {
+            for (int ch = 0; ch < buffer.getNumChannels(); ch++) {
+                auto offset = (node.noiseOffset + ch * 977) % (NOISE_SAMPLES - numSamples);
+                buffer.copyFrom(ch, 0, noise, 0, offset, numSamples);
+            }
+            node.noiseOffset = (node.noiseOffset + numSamples) % NOISE_SAMPLES;
+            return;
+        }
+
+        buffer.clear();
+        for (const auto& input : node.inputs) {
+            buffer.addFrom(input.channel, 0, nodes.getUnchecked(input.source)->buffer, input.sourceChannel, 0, numSamples);
+        }
+
+        if (node.type != Node_Plugin) {
+            return;
+        }
+
+        // What the plugin wrappers do with host automation: set the value and
+        // tell the listeners, from whichever thread is processing the plugin
+        node.samplesToAutomation -= numSamples;
+        while (node.samplesToAutomation <= 0) {
+            auto& parameters = node.processor->getParameters();
+            auto* parameter = parameters.getUnchecked(node.random.nextInt(parameters.size()));
+            auto value = node.random.nextFloat();
+            parameter->setValue(value);
+            parameter->sendValueChangedMessageToListeners(value);
+            stats.numParameterChanges++;
+            node.samplesToAutomation += getSamplesToAutomation(node);
+        }
+
+        node.midi.clear();
+        node.processor->processBlock(buffer, node.midi);
+    }
+
+    const Options& options;
+    juce::AudioBuffer<float> noise;
+    juce::OwnedArray<Node> nodes;
+    int numInstances {0};
+
+    ReadyQueue readyQueue;
+    std::atomic<int> remainingNodes {0}, activeParticipants {0};
+    std::atomic<juce::uint32> generation {0};
+    juce::OwnedArray<Worker> workers;
+    std::vector<ThreadStats> threadStats;
+    bool pinThreads {false};
+};
+
+// Memory Code
+//==============================================================================
+static size_t getResidentBytes()
+{
+   #if JUCE_LINUX
+    // Total and resident size, in pages
+    auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), false);
+    if (fields.size() > 1) {
+        return (size_t) fields[1].getLargeIntValue() * (size_t) sysconf(_SC_PAGESIZE);
+    }
+   #endif
+    return 0;
+}
+
+// Report Code
+//==============================================================================
+Report run(const Options& options)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    Report report;
+    report.sampleRate = options.sampleRate;
+    report.blockSize = options.blockSize;
+
+    auto numInstances = juce::jlimit(1, maxInstances, options.numInstances);
+
+    Description description;
+    if (options.scenario != juce::File()) {
+        report.error = loadFilterGraph(options.scenario, description);
+        if (!report.succeeded()) {
+            return report;
+        }
+    } else {
+        description = makeTracks(numInstances, options.chainLength);
+    }
+    report.scenario = description.name;
+
+    // Whole copies only, so the last one isn't cut off halfway down a chain
+    auto pluginsPerCopy = description.getNumPlugins();
+    report.numCopies = juce::jmax(1, numInstances / pluginsPerCopy);
+
+    auto residentBefore = getResidentBytes();
+    Graph graph(options, description, report.numCopies);
+
+    if (graph.hasCycle()) {
+        report.error = description.name + " has a feedback loop in it";
+        return report;
+    }
+
+    graph.prepare();
+    auto residentAfter = getResidentBytes();
+
+    report.numInstances = graph.getNumInstances();
+    report.numNodes = graph.getNumNodes();
+    report.footprintPerInstance = graph.getFootprintPerInstance();
+    if (residentAfter > residentBefore) {
+        report.residentBytesPerInstance = (residentAfter - residentBefore) / (size_t) report.numInstances;
+    }
+
+    report = graph.process(report);
+    graph.release();
+    return report;
+}
+
+juce::String Report::toString() const
+{
+    if (!succeeded()) {
+        return error + juce::newLine;
+    }
+
+    juce::String text;
+    text << scenario << ": " << numInstances << " instances in " << numNodes << " nodes (" << numCopies << " copies), "
+         << blockSize << " samples at " << juce::String(sampleRate / 1000.0, 1) << " kHz" << juce::newLine
+         << numBlocks << " blocks, " << deadlineMisses << " missed (" << juce::String(100.0 * getDeadlineMissRate(), 3) << "%), "
+         << "mean " << juce::String(meanBlockMicroseconds, 1) << " us, p99 " << juce::String(p99BlockMicroseconds, 1)
+         << " us, max " << juce::String(maxBlockMicroseconds, 1) << " us of " << juce::String(1.0e6 * blockSize / sampleRate, 1)
+         << " us" << juce::newLine
+         << numParameterChanges << " parameter changes" << juce::newLine
+         << "Memory per instance: " << juce::String((double) footprintPerInstance / 1024.0, 1) << " KiB footprint, "
+         << (residentBytesPerInstance > 0 ? juce::String((double) residentBytesPerInstance / 1024.0, 1) + " KiB resident"
+                                          : juce::String("resident n/a")) << juce::newLine;
+
+    for (int t = 0; t < threads.size(); t++) {
+        const auto& load = threads.getReference(t);
+        text << "Thread " << t << (load.core >= 0 ? " on core " + juce::String(load.core) : juce::String(" unpinned")) << ": "
+             << juce::String(100.0 * load.utilisation, 1) << "% busy, " << load.numNodesProcessed << " nodes" << juce::newLine;
+    }
+
+    return text;
+}
+
+bool Report::writeCsv(const juce::File& file) const
+{
+    juce::String csv;
+    csv << "metric,value" << juce::newLine
+        << "scenario," << scenario.quoted() << juce::newLine
+        << "instances," << numInstances << juce::newLine
+        << "nodes," << numNodes << juce::newLine
+        << "sample_rate," << sampleRate << juce::newLine
+        << "block_size," << blockSize << juce::newLine
+        << "blocks," << numBlocks << juce::newLine
+        << "deadline_misses," << deadlineMisses << juce::newLine
+        << "deadline_miss_rate," << getDeadlineMissRate() << juce::newLine
+        << "mean_block_us," << meanBlockMicroseconds << juce::newLine
+        << "p99_block_us," << p99BlockMicroseconds << juce::newLine
+        << "max_block_us," << maxBlockMicroseconds << juce::newLine
+        << "parameter_changes," << numParameterChanges << juce::newLine
+        << "footprint_bytes_per_instance," << (juce::int64) footprintPerInstance << juce::newLine
+        << "resident_bytes_per_instance," << (juce::int64) residentBytesPerInstance << juce::newLine
+        << juce::newLine
+        << "thread,core,utilisation,nodes" << juce::newLine;
+
+    for (int t = 0; t < threads.size(); t++) {
+        const auto& load = threads.getReference(t);
+        csv << t << "," << load.core << "," << load.utilisation << "," << load.numNodesProcessed << juce::newLine;
+    }
+
+    return file.replaceWithText(csv);
+}
+
+}
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    GraphBenchmark.h
+
+    A whole session's worth of FirstJUCEpluginAudioProcessor instances, up
+    to 1000, each with its own chains and parameter tree, processed the way
+    a host processes its graph: a thread per core takes whichever node has
+    all of its inputs ready, block after block at a fixed block size, paced
+    like an audio device. Every instance's parameters are automated at
+    random as it goes.
+
+    The graph is either generated (tracks of plugins in series, all mixed
+    into one output) or an AudioPluginHost .filtergraph such as
+    FirstJUCE.filtergraph, copied until it holds enough instances. In a
+    .filtergraph every FirstJUCEplugin is an instance with the saved state;
+    other plugins with no inputs become noise sources, anything else passes
+    audio through, and the audio input and output are shared by all copies.
+
+    It reports how often a block missed its deadline, how busy each core
+    was and how much memory an instance costs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace GraphBenchmark
+{
+    struct Options
+    {
+        // At most maxInstances
+        int numInstances {100};
+        // Scheduling threads, each pinned to a core of its own where there
+        // are enough. 0 for one per core.
+        int numThreads {0};
+        double sampleRate {48000.0};
+        int blockSize {128};
+        double seconds {10.0};
+        // Starts each block on the audio clock like a device callback would.
+        // Off runs them back to back, which only measures throughput.
+        bool paced {true};
+        // Parameter changes per instance per second, at random times
+        double automationPerSecond {20.0};
+        // Opens an editor (offscreen) on every instance, so the parameter
+        // listeners it adds are there too
+        bool withEditors {false};
+
+        // Plugins in series per track for the generated graph
+        int chainLength {4};
+        // A .filtergraph to use instead, see above
+        juce::File scenario;
+
+        juce::int64 seed {1};
+    };
+
+    static constexpr int maxInstances = 1000;
+
+    struct ThreadLoad
+    {
+        int core {-1};
+        // Time spent processing nodes over the length of the run
+        double utilisation {0};
+        int numNodesProcessed {0};
+    };
+
+    struct Report
+    {
+        // Empty if it ran
+        juce::String error;
+
+        juce::String scenario;
+        int numInstances {0}, numNodes {0}, numCopies {0};
+        double sampleRate {0};
+        int blockSize {0};
+
+        int numBlocks {0}, deadlineMisses {0};
+        double meanBlockMicroseconds {0}, p99BlockMicroseconds {0}, maxBlockMicroseconds {0};
+        juce::int64 numParameterChanges {0};
+
+        juce::Array<ThreadLoad> threads;
+
+        // What an instance says it holds (getMemoryFootprint) on average, and
+        // how much the process grew per instance creating and preparing them
+        // all, which counts the parameter trees and editors too (Linux only,
+        // 0 elsewhere)
+        size_t footprintPerInstance {0};
+        size_t residentBytesPerInstance {0};
+
+        bool succeeded() const { return error.isEmpty(); }
+        double getDeadlineMissRate() const { return numBlocks > 0 ? (double) deadlineMisses / numBlocks : 0.0; }
+
+        juce::String toString() const;
+        // One row per metric, then one per thread
+        bool writeCsv(const juce::File& file) const;
+    };
+
+    // Message thread, since it can open editors. Takes options.seconds plus
+    // however long creating the instances does.
+    Report run(const Options& options = {});
+}
@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    The headless harness: benchmarks and checks that need a processor but
+    no host, no editor window and no audio device, run from a terminal or
+    CI. Build it from FirstJUCEHarness.jucer (Linux Makefile or Xcode).
+
+        FirstJUCEHarness --help
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ScalingBenchmark.h"
+#include "GraphBenchmark.h"
+#include "MeteringBenchmark.h"
+#include "../../Source/EngineConformance.h"
+#include "../../Source/SessionReplay.h"
+#include "../../Source/EditorBenchmark.h"
+
+// Options shared by every command
+static juce::File getCsvFile(const juce::ArgumentList& args, const juce::String& defaultName)
+{
+    auto path = args.getValueForOption("--csv");
+    return path.isNotEmpty() ? juce::File::getCurrentWorkingDirectory().getChildFile(path)
+                             : juce::File::getCurrentWorkingDirectory().getChildFile(defaultName);
+}
+
+static int getIntOption(const juce::ArgumentList& args, const juce::String& option, int defaultValue)
+{
+    auto value = args.getValueForOption(option);
+    return value.isNotEmpty() ? value.getIntValue() : defaultValue;
+}
+
+static juce::Array<int> getIntListOption(const juce::ArgumentList& args, const juce::String& option, const juce::Array<int>& defaultValue)
+{
+    auto value = args.getValueForOption(option);
+    if (value.isEmpty()) {
+        return defaultValue;
+    }
+
+    juce::Array<int> values;
+    for (const auto& item : juce::StringArray::fromTokens(value, ",", {})) {
+        values.add(item.getIntValue());
+    }
+    return values;
+}
+
+static void writeCsv(bool written, const juce::File& file)
+{
+    if (!written) {
+        juce::ConsoleApplication::fail("Couldn't write " + file.getFullPathName());
+    }
+    std::cout << "Wrote " << file.getFullPathName() << std::endl;
+}
+
+// Command Code
+//==============================================================================
+static void runScaling(const juce::ArgumentList& args)
+{
+    ScalingBenchmark::Options options;
+    options.channelCounts = getIntListOption(args, "--channels", options.channelCounts);
+    options.maxParticipants = getIntOption(args, "--cores", options.maxParticipants);
+    options.blockSize = getIntOption(args, "--block-size", options.blockSize);
+    options.numBlocks = getIntOption(args, "--blocks", options.numBlocks);
+
+    auto report = ScalingBenchmark::run(options);
+    std::cout << report.toString();
+
+    auto file = getCsvFile(args, "scaling.csv");
+    writeCsv(report.writeCsv(file), file);
+}
+
+static void runGraph(const juce::ArgumentList& args)
+{
+    GraphBenchmark::Options options;
+    options.numInstances = getIntOption(args, "--instances", options.numInstances);
+    options.numThreads = getIntOption(args, "--threads", options.numThreads);
+    options.blockSize = getIntOption(args, "--block-size", options.blockSize);
+    options.chainLength = getIntOption(args, "--chain", options.chainLength);
+    options.paced = !args.containsOption("--unpaced");
+    options.withEditors = args.containsOption("--editors");
+
+    auto seconds = args.getValueForOption("--seconds");
+    if (seconds.isNotEmpty()) {
+        options.seconds = seconds.getDoubleValue();
+    }
+    auto automation = args.getValueForOption("--automation");
+    if (automation.isNotEmpty()) {
+        options.automationPerSecond = automation.getDoubleValue();
+    }
+    auto scenario = args.getValueForOption("--scenario");
+    if (scenario.isNotEmpty()) {
+        options.scenario = juce::File::getCurrentWorkingDirectory().getChildFile(scenario);
+    }
+
+    auto report = GraphBenchmark::run(options);
+    std::cout << report.toString();
+    if (!report.succeeded()) {
+        juce::ConsoleApplication::fail(report.error);
+    }
+
+    auto file = getCsvFile(args, "graph.csv");
+    writeCsv(report.writeCsv(file), file);
+}
+
+static void runMetering(const juce::ArgumentList& args)
+{
+    MeteringBenchmark::Options options;
+    options.blockSizes = getIntListOption(args, "--block-sizes", options.blockSizes);
+    options.channelCounts = getIntListOption(args, "--channels", options.channelCounts);
+
+    auto report = MeteringBenchmark::run(options);
+    std::cout << report.toString();
+
+    auto file = getCsvFile(args, "metering.csv");
+    writeCsv(report.writeCsv(file), file);
+}
+
+static void runReplay(const juce::ArgumentList& args)
+{
+    args.checkMinNumArguments(2);
+    auto log = args[1].resolveAsExistingFile();
+
+    SessionReplay::Options options;
+    options.allEngines = args.containsOption("--all-engines");
+    options.multiCore = !args.containsOption("--single-core");
+
+    auto report = SessionReplay::run(log, options);
+    std::cout << report.toString();
+    if (!report.succeeded()) {
+        juce::ConsoleApplication::fail(report.error);
+    }
+
+    auto file = getCsvFile(args, log.withFileExtension("replay.csv").getFileName());
+    writeCsv(report.writeCsv(file), file);
+}
+
+static void runEditorBenchmark(const juce::ArgumentList& args)
+{
+    EditorBenchmark::Options options;
+    options.numFrames = getIntOption(args, "--frames", options.numFrames);
+
+    auto report = EditorBenchmark::run(options);
+    std::cout << report.toString();
+
+    auto file = getCsvFile(args, "editor.csv");
+    writeCsv(report.writeCsv(file), file);
+}
+
+static void runConformance(const juce::ArgumentList& args)
+{
+    EngineConformance::Options options;
+    if (args.containsOption("--quick")) {
+        options.frequencySteps = 3;
+        options.quickGainAndQuality = true;
+    }
+
+    auto report = EngineConformance::run(options);
+    std::cout << report.toString();
+
+    if (!report.passed()) {
+        juce::ConsoleApplication::fail("Conformance failed");
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // Processors and components expect a message manager, even offscreen
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+    app.addHelpCommand("--help|-h", "Usage: FirstJUCEHarness <command> [options]", true);
+
+    app.addCommand({"scaling",
+                    "scaling [--channels=16,32,64] [--cores=16] [--block-size=128] [--blocks=4000] [--csv=scaling.csv]",
+                    "Times multi-core processing for 1 to 16 cores",
+                    "Runs buses of each channel count through the cascades and the worker pool with "
+                    "1 up to --cores participants, and writes every result to the CSV file. Counts past "
+                    "this machine's cores are marked oversubscribed.",
+                    runScaling});
+
+    app.addCommand({"graph",
+                    "graph [--instances=100] [--threads=0] [--block-size=128] [--seconds=10] [--automation=20] "
+                    "[--chain=4] [--scenario=FirstJUCE.filtergraph] [--editors] [--unpaced] [--csv=graph.csv]",
+                    "Runs up to 1000 instances through a multithreaded host graph",
+                    "Processes --instances plugins, in tracks of --chain in series or as copies of a .filtergraph, "
+                    "with a scheduling thread per core (or --threads), paced like an audio device and with "
+                    "--automation random parameter changes per instance per second. Reports deadline misses, "
+                    "per-core utilisation and memory per instance.",
+                    runGraph});
+
+    app.addCommand({"metering",
+                    "metering [--block-sizes=64,256,1024] [--channels=2,16,64] [--csv=metering.csv]",
+                    "Measures what in/out metering costs",
+                    "Times a stereo instance's processBlock with Metering off and on, taking turns, and "
+                    "the cascade pass on its own at each channel count, metering off and on, with and "
+                    "without true peak.",
+                    runMetering});
+
+    app.addCommand({"replay",
+                    "replay <capture log> [--all-engines] [--single-core] [--csv=<log>.replay.csv]",
+                    "Replays a SessionCapture log through a fresh processor",
+                    "Plays the log's prepares, blocks and parameter changes back with no host, timing and "
+                    "hashing every block. --all-engines runs it once per filter kernel this CPU supports.",
+                    runReplay});
+
+    app.addCommand({"editor-bench",
+                    "editor-bench [--frames=120] [--csv=editor.csv]",
+                    "Times painting and layout of the editor and its components",
+                    "Renders the response curve, a rotary slider and the whole editor offscreen at several "
+                    "sizes and scales while the bands sweep, and counts allocations per frame.",
+                    runEditorBenchmark});
+
+    app.addCommand({"conformance",
+                    "conformance [--quick]",
+                    "Checks every filter engine and kernel, exits with 1 on a failure",
+                    "Runs EngineConformance: every engine against the double precision reference and "
+                    "every vector kernel against the scalar one. --quick sweeps fewer settings.",
+                    runConformance});
+
+    return app.findAndRunCommand(argc, argv);
+}
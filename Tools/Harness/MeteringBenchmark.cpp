@@ -0,0 +1,237 @@
+/*
+  ==============================================================================
+
+    MeteringBenchmark.cpp
+
+  ==============================================================================
+*/
+
+#include "MeteringBenchmark.h"
+#include "../../Source/PluginProcessor.h"
+
+namespace MeteringBenchmark
+{
+
+// Off and on take turns this many times, so drift in clock speed or
+// background load hits both alike
+static constexpr int NUM_ROUNDS = 10;
+
+static void fillWithNoise(juce::AudioBuffer<float>& buffer, juce::Random& random)
+{
+    for (int ch = 0; ch < buffer.getNumChannels(); ch++) {
+        for (int i = 0; i < buffer.getNumSamples(); i++) {
+            buffer.setSample(ch, i, 0.5f * (random.nextFloat() * 2.f - 1.f));
+        }
+    }
+}
+
+// Processor Code
+//==============================================================================
+static ProcessorResult measureProcessor(double sampleRate, int blockSize, int numBlocks)
+{
+    FirstJUCEpluginAudioProcessor processor;
+    // Keeps metering on however long the blocks take
+    processor.setAdaptiveQuality(false);
+    processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+
+    auto* metering = processor.apvts.getParameter("Metering");
+    juce::AudioBuffer<float> input(processor.getTotalNumInputChannels(), blockSize), buffer(input);
+    juce::MidiBuffer midi;
+    juce::Random random(1);
+    fillWithNoise(input, random);
+
+    juce::int64 ticks[2] {};
+    auto blocksPerRound = juce::jmax(1, numBlocks / NUM_ROUNDS);
+
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        for (int on = 0; on < 2; on++) {
+            metering->setValueNotifyingHost(on == 1 ? 1.f : 0.f);
+
+            for (int block = 0; block < blocksPerRound; block++) {
+                buffer.makeCopyOf(input, true);
+                auto start = juce::Time::getHighResolutionTicks();
+                processor.processBlock(buffer, midi);
+                ticks[on] += juce::Time::getHighResolutionTicks() - start;
+            }
+        }
+    }
+
+    processor.releaseResources();
+
+    auto toMicroseconds = [blocks = blocksPerRound * NUM_ROUNDS](juce::int64 t) {
+        return 1.0e6 * juce::Time::highResolutionTicksToSeconds(t) / blocks;
+    };
+
+    ProcessorResult result;
+    result.blockSize = blockSize;
+    result.offMicroseconds = toMicroseconds(ticks[0]);
+    result.onMicroseconds = toMicroseconds(ticks[1]);
+    return result;
+}
+
+// Meter Code
+//==============================================================================
+// The processor's cascade pass and metering, without the rest of processBlock:
+// one cascade per kernel width of channels, every band in use
+static MeterResult measureMeter(double sampleRate, int numChannels, int blockSize, bool truePeak, int numBlocks)
+{
+    auto channelsPerCascade = juce::jlimit(4, FilterCascade::maxLanes, CascadeKernels::getWidth(CascadeKernels::getActiveISA()));
+
+    LevelMeter inputMeter, outputMeter;
+    inputMeter.prepare(sampleRate, numChannels);
+    outputMeter.prepare(sampleRate, numChannels);
+    inputMeter.setTruePeakEnabled(truePeak);
+    outputMeter.setTruePeakEnabled(truePeak);
+
+    ChainSettings settings;
+    settings.lowCutFreq = 80.f;
+    settings.highCutFreq = 12000.f;
+    settings.lowCutSlope = settings.highCutSlope = Slope_48;
+    settings.peakFreq = 1000.f;
+    settings.peakGainInDecibels = 6.f;
+    auto bands = BandDesign::design(settings, sampleRate);
+
+    juce::OwnedArray<FilterCascade> cascades;
+    for (int ch = 0; ch < numChannels; ch += channelsPerCascade) {
+        auto* cascade = cascades.add(new FilterCascade());
+        for (int lane = 0; lane < channelsPerCascade; lane++) {
+            cascade->setBands(lane, bands);
+        }
+        inputMeter.prepareLevels(cascade->getInputLevels());
+        outputMeter.prepareLevels(cascade->getOutputLevels());
+    }
+
+    RealtimeArena arena;
+    arena.prepare(RealtimeArena::alignUp(CascadeKernels::getScratchFloatsNeeded(blockSize) * sizeof(float))
+                  + RealtimeArena::alignUp(LevelMeter::getScratchFloatsNeeded(blockSize) * sizeof(float)));
+    auto* cascadeScratch = arena.allocate<float>(CascadeKernels::getScratchFloatsNeeded(blockSize));
+    auto* meterScratch = arena.allocate<float>(LevelMeter::getScratchFloatsNeeded(blockSize));
+
+    juce::AudioBuffer<float> input(numChannels, blockSize), buffer(input);
+    juce::Random random(1);
+    fillWithNoise(input, random);
+
+    auto processBlock = [&](bool metering) {
+        auto* const* channels = buffer.getArrayOfWritePointers();
+        if (metering && truePeak) {
+            inputMeter.measureTruePeak(channels, numChannels, blockSize, meterScratch);
+        }
+
+        for (int i = 0; i < cascades.size(); i++) {
+            auto firstChannel = i * channelsPerCascade;
+            auto numLanes = juce::jmin(channelsPerCascade, numChannels - firstChannel);
+            auto* cascade = cascades.getUnchecked(i);
+            cascade->setMetering(metering);
+            cascade->process(channels + firstChannel, numLanes, blockSize, false, cascadeScratch);
+
+            if (metering) {
+                inputMeter.collect(cascade->getInputLevels(), numLanes);
+                outputMeter.collect(cascade->getOutputLevels(), numLanes);
+            }
+        }
+
+        if (metering) {
+            inputMeter.advance(blockSize);
+            outputMeter.advance(blockSize);
+            if (truePeak) {
+                outputMeter.measureTruePeak(channels, numChannels, blockSize, meterScratch);
+            }
+        }
+    };
+
+    juce::int64 ticks[2] {};
+    auto blocksPerRound = juce::jmax(1, numBlocks / NUM_ROUNDS);
+
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        for (int on = 0; on < 2; on++) {
+            for (int block = 0; block < blocksPerRound; block++) {
+                buffer.makeCopyOf(input, true);
+                auto start = juce::Time::getHighResolutionTicks();
+                processBlock(on == 1);
+                ticks[on] += juce::Time::getHighResolutionTicks() - start;
+            }
+        }
+    }
+
+    auto toNanosecondsPerSample = [samples = (double) blocksPerRound * NUM_ROUNDS * blockSize * numChannels](juce::int64 t) {
+        return 1.0e9 * juce::Time::highResolutionTicksToSeconds(t) / samples;
+    };
+
+    MeterResult result;
+    result.numChannels = numChannels;
+    result.blockSize = blockSize;
+    result.truePeak = truePeak;
+    result.cascadeNanosecondsPerSample = toNanosecondsPerSample(ticks[0]);
+    result.nanosecondsPerSample = toNanosecondsPerSample(ticks[1]) - result.cascadeNanosecondsPerSample;
+    return result;
+}
+
+// Report Code
+//==============================================================================
+Report run(const Options& options)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    Report report;
+    report.sampleRate = options.sampleRate;
+
+    for (auto blockSize : options.blockSizes) {
+        auto numBlocks = juce::jmax(NUM_ROUNDS, (int) (options.seconds * options.sampleRate / blockSize));
+        report.processor.add(measureProcessor(options.sampleRate, blockSize, numBlocks));
+
+        for (auto numChannels : options.channelCounts) {
+            for (auto truePeak : {false, true}) {
+                report.meter.add(measureMeter(options.sampleRate, numChannels, blockSize, truePeak, numBlocks));
+            }
+        }
+    }
+
+    return report;
+}
+
+juce::String Report::toString() const
+{
+    juce::String text;
+    text << "Stereo processBlock, metering off and on, at " << juce::String(sampleRate / 1000.0, 1) << " kHz" << juce::newLine;
+
+    for (const auto& result : processor) {
+        text << juce::String(result.blockSize).paddedLeft(' ', 5) << " samples  "
+             << "off " << juce::String(result.offMicroseconds, 2) << " us  "
+             << "on " << juce::String(result.onMicroseconds, 2) << " us  "
+             << "metering costs " << juce::String(result.getOnCostMicroseconds(), 2) << " us, "
+             << juce::String(100.0 * result.getOnCostLoad(sampleRate), 3) << "% of the block" << juce::newLine;
+    }
+
+    text << "The cascade pass on its own, and what input and output metering add to it" << juce::newLine;
+
+    for (const auto& result : meter) {
+        text << juce::String(result.numChannels).paddedLeft(' ', 3) << " channels  "
+             << juce::String(result.blockSize).paddedLeft(' ', 5) << " samples  "
+             << (result.truePeak ? "with true peak     " : "without true peak  ")
+             << "cascades " << juce::String(result.cascadeNanosecondsPerSample, 2) << " ns/sample  "
+             << "metering +" << juce::String(result.nanosecondsPerSample, 2) << " ns/sample" << juce::newLine;
+    }
+
+    return text;
+}
+
+bool Report::writeCsv(const juce::File& file) const
+{
+    juce::String csv;
+    csv << "what,channels,block_size,true_peak,off_us,on_us,on_cost_us,on_cost_load,cascade_ns_per_sample,ns_per_sample" << juce::newLine;
+
+    for (const auto& result : processor) {
+        csv << "processBlock,2," << result.blockSize << ",1,"
+            << result.offMicroseconds << "," << result.onMicroseconds << ","
+            << result.getOnCostMicroseconds() << "," << result.getOnCostLoad(sampleRate) << ",," << juce::newLine;
+    }
+    for (const auto& result : meter) {
+        csv << "cascades," << result.numChannels << "," << result.blockSize << "," << (result.truePeak ? 1 : 0)
+            << ",,,,," << result.cascadeNanosecondsPerSample << "," << result.nanosecondsPerSample << juce::newLine;
+    }
+
+    return file.replaceWithText(csv);
+}
+
+}
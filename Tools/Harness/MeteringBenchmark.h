@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    MeteringBenchmark.h
+
+    What in/out metering costs. The cascade kernels meter as they load and
+    store each block, so this measures it two ways: the whole processBlock
+    of a stereo instance with "Metering" off and on, and the cascade pass on
+    its own at several channel counts, metering off against on, with and
+    without true peak (the part the QualityGovernor sheds first, and the
+    only one with a pass over the block of its own).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace MeteringBenchmark
+{
+    struct Options
+    {
+        double sampleRate {48000.0};
+        juce::Array<int> blockSizes {64, 256, 1024};
+        juce::Array<int> channelCounts {2, 16, 64};
+        // Audio to run through each configuration, in seconds
+        double seconds {5.0};
+    };
+
+    struct ProcessorResult
+    {
+        int blockSize {0};
+        // processBlock, mean per block
+        double offMicroseconds {0}, onMicroseconds {0};
+
+        double getOnCostMicroseconds() const { return onMicroseconds - offMicroseconds; }
+        // Of the time the block lasts
+        double getOnCostLoad(double sampleRate) const { return getOnCostMicroseconds() * 1.0e-6 * sampleRate / blockSize; }
+    };
+
+    struct MeterResult
+    {
+        int numChannels {0}, blockSize {0};
+        bool truePeak {false};
+        // The cascades' pass without metering, per channel and sample, and
+        // what metering adds to that
+        double cascadeNanosecondsPerSample {0}, nanosecondsPerSample {0};
+    };
+
+    struct Report
+    {
+        double sampleRate {0};
+        juce::Array<ProcessorResult> processor;
+        juce::Array<MeterResult> meter;
+
+        juce::String toString() const;
+        bool writeCsv(const juce::File& file) const;
+    };
+
+    // Not on an audio thread. Takes about options.seconds per configuration.
+    Report run(const Options& options = {});
+}
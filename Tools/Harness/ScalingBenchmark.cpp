@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    ScalingBenchmark.cpp
+
+  ==============================================================================
+*/
+
+#include "ScalingBenchmark.h"
+#include "../../Source/PluginProcessor.h"
+
+namespace ScalingBenchmark
+{
+
+// Blocks run before timing starts, so the workers are up and the caches warm
+static constexpr int WARM_UP_BLOCKS = 200;
+
+// Bus Code
+//==============================================================================
+// What processChannels does with a bus, without the rest of the processor
+struct Bus
+{
+    Bus(int numChannelsToUse, int blockSize, double sampleRate)
+        : numChannels(numChannelsToUse),
+          numSamples(blockSize),
+          channelsPerCascade(juce::jlimit(4, FilterCascade::maxLanes, CascadeKernels::getWidth(CascadeKernels::getActiveISA()))),
+          buffer(numChannelsToUse, blockSize),
+          input(numChannelsToUse, blockSize)
+    {
+        // The most expensive settings there are: every section in use
+        ChainSettings settings;
+        settings.lowCutFreq = 80.f;
+        settings.lowCutSlope = Slope_48;
+        settings.highCutFreq = 12000.f;
+        settings.highCutSlope = Slope_48;
+        settings.peakFreq = 1000.f;
+        settings.peakGainInDecibels = 6.f;
+        settings.peakQuality = 1.f;
+        auto bands = BandDesign::design(settings, sampleRate);
+
+        for (int ch = 0; ch < numChannels; ch += channelsPerCascade) {
+            auto* cascade = cascades.add(new FilterCascade());
+            for (int lane = 0; lane < channelsPerCascade; lane++) {
+                cascade->setBands(lane, bands);
+            }
+        }
+
+        // Every cascade can run at the same time, so each gets its own scratch
+        scratchFloats = CascadeKernels::getScratchFloatsNeeded(blockSize);
+        storage.allocate((size_t) cascades.size() * scratchFloats + 16, true);
+
+        juce::Random random(0x5ca1e);
+        for (int ch = 0; ch < numChannels; ch++) {
+            for (int i = 0; i < numSamples; i++) {
+                input.setSample(ch, i, random.nextFloat() - 0.5f);
+            }
+        }
+    }
+
+    void refill()
+    {
+        for (int ch = 0; ch < numChannels; ch++) {
+            buffer.copyFrom(ch, 0, input, ch, 0, numSamples);
+        }
+    }
+
+    static void processCascade(void* context, int index)
+    {
+        auto& bus = *static_cast<Bus*>(context);
+        auto firstChannel = index * bus.channelsPerCascade;
+        auto numLanes = juce::jmin(bus.channelsPerCascade, bus.numChannels - firstChannel);
+        auto* scratch = juce::snapPointerToAlignment(bus.storage.get(), (size_t) 64) + (size_t) index * bus.scratchFloats;
+
+        bus.cascades.getUnchecked(index)->process(bus.channels + firstChannel,
+                                                  numLanes, bus.numSamples, false, scratch);
+    }
+
+    const int numChannels, numSamples, channelsPerCascade;
+    juce::OwnedArray<FilterCascade> cascades;
+    juce::AudioBuffer<float> buffer, input;
+    // Taken once, the workers share them
+    float* const* channels {buffer.getArrayOfWritePointers()};
+    juce::HeapBlock<float> storage;
+    size_t scratchFloats {0};
+};
+
+static double getPercentile(std::vector<double> values, double percentile)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    auto index = juce::jlimit<size_t>(0, values.size() - 1, (size_t) (percentile / 100.0 * (double) values.size()));
+    std::nth_element(values.begin(), values.begin() + (std::ptrdiff_t) index, values.end());
+    return values[index];
+}
+
+// Report Code
+//==============================================================================
+Report run(const Options& options)
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    Report report;
+    report.numCpus = juce::SystemStats::getNumCpus();
+    report.kernel = CascadeKernels::getName(CascadeKernels::getActiveISA());
+    report.blockSize = options.blockSize;
+    report.sampleRate = options.sampleRate;
+
+    auto deadlineMicroseconds = 1.0e6 * options.blockSize / options.sampleRate;
+    auto minParticipants = juce::jlimit(1, ChannelWorkerPool::maxParticipants, options.minParticipants);
+    auto maxParticipants = juce::jlimit(minParticipants, ChannelWorkerPool::maxParticipants, options.maxParticipants);
+
+    for (auto numChannels : options.channelCounts) {
+        Bus bus(juce::jlimit(1, MAX_CHANNELS, numChannels), options.blockSize, options.sampleRate);
+        double serialMicroseconds = 0;
+
+        for (int participants = minParticipants; participants <= maxParticipants; participants++) {
+            // No point in more participants than there are cascades to go round
+            if (participants > 1 && participants > bus.cascades.size()) {
+                break;
+            }
+
+            ChannelWorkerPool pool;
+            pool.prepare(participants - 1);
+
+            std::vector<double> blockMicroseconds;
+            blockMicroseconds.reserve((size_t) options.numBlocks);
+            int misses = 0;
+
+            for (int block = -WARM_UP_BLOCKS; block < options.numBlocks; block++) {
+                bus.refill();
+
+                auto start = juce::Time::getHighResolutionTicks();
+                pool.run(bus.cascades.size(), &Bus::processCascade, &bus);
+                auto microseconds = 1.0e6 * juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+                if (block >= 0) {
+                    blockMicroseconds.push_back(microseconds);
+                    misses += microseconds > deadlineMicroseconds ? 1 : 0;
+                }
+            }
+
+            pool.release();
+
+            Result result;
+            result.numChannels = bus.numChannels;
+            result.numParticipants = participants;
+            result.oversubscribed = participants > report.numCpus;
+            result.meanMicroseconds = std::accumulate(blockMicroseconds.begin(), blockMicroseconds.end(), 0.0)
+                                    / (double) juce::jmax<size_t>(1, blockMicroseconds.size());
+            result.p99Microseconds = getPercentile(blockMicroseconds, 99.0);
+            result.maxMicroseconds = blockMicroseconds.empty() ? 0.0 : *std::max_element(blockMicroseconds.begin(), blockMicroseconds.end());
+            result.deadlineMissRate = (double) misses / (double) juce::jmax(1, options.numBlocks);
+
+            if (participants == 1) {
+                serialMicroseconds = result.meanMicroseconds;
+            }
+            // Left at 0 when the options skipped the serial run
+            result.speedup = serialMicroseconds > 0 && result.meanMicroseconds > 0 ? serialMicroseconds / result.meanMicroseconds : 0.0;
+            result.efficiency = result.speedup / participants;
+
+            report.results.add(result);
+        }
+    }
+
+    return report;
+}
+
+juce::String Report::toString() const
+{
+    juce::String text;
+    text << numCpus << " CPUs, " << kernel << " kernel, " << blockSize << " samples at "
+         << juce::String(sampleRate / 1000.0, 1) << " kHz (deadline "
+         << juce::String(1.0e6 * blockSize / sampleRate, 1) << " us)" << juce::newLine;
+
+    for (const auto& result : results) {
+        text << juce::String(result.numChannels).paddedLeft(' ', 3) << " channels  "
+             << juce::String(result.numParticipants).paddedLeft(' ', 2) << " cores  "
+             << "mean " << juce::String(result.meanMicroseconds, 1) << " us  "
+             << "p99 " << juce::String(result.p99Microseconds, 1) << " us  "
+             << "max " << juce::String(result.maxMicroseconds, 1) << " us  "
+             << "speedup " << juce::String(result.speedup, 2) << "x  "
+             << "efficiency " << juce::String(100.0 * result.efficiency, 0) << "%  "
+             << "misses " << juce::String(100.0 * result.deadlineMissRate, 2) << "%"
+             << (result.oversubscribed ? "  (oversubscribed)" : "") << juce::newLine;
+    }
+
+    return text;
+}
+
+bool Report::writeCsv(const juce::File& file) const
+{
+    juce::String csv;
+    csv << "channels,cores,oversubscribed,mean_us,p99_us,max_us,speedup,efficiency,miss_rate,cpus,kernel,block_size,sample_rate" << juce::newLine;
+
+    for (const auto& result : results) {
+        csv << result.numChannels << "," << result.numParticipants << "," << (result.oversubscribed ? 1 : 0) << ","
+            << result.meanMicroseconds << "," << result.p99Microseconds << "," << result.maxMicroseconds << ","
+            << result.speedup << "," << result.efficiency << "," << result.deadlineMissRate << ","
+            << numCpus << "," << kernel << "," << blockSize << "," << sampleRate << juce::newLine;
+    }
+
+    return file.replaceWithText(csv);
+}
+
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    ScalingBenchmark.h
+
+    How multi-core processing scales with the number of cores it gets. A
+    bus of channels runs through the same cascades and ChannelWorkerPool
+    the processor uses, with the audio thread plus 0 to 15 workers, and
+    every block is timed against its deadline. Runs for one participant are
+    the baseline each channel count's speedup is worked out from.
+
+    Results past the machine's core count are still measured, but they're
+    oversubscribed and marked as such: the numbers only mean something on
+    a machine with at least as many cores as participants.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace ScalingBenchmark
+{
+    struct Options
+    {
+        juce::Array<int> channelCounts {16, 32, 64};
+        // The audio thread counts as one, so 1 is serial processing
+        int minParticipants {1}, maxParticipants {16};
+        double sampleRate {48000.0};
+        int blockSize {128};
+        int numBlocks {4000};
+    };
+
+    struct Result
+    {
+        int numChannels {0}, numParticipants {0};
+        // More participants than this machine has cores
+        bool oversubscribed {false};
+
+        double meanMicroseconds {0}, p99Microseconds {0}, maxMicroseconds {0};
+        // Against one participant at the same channel count; efficiency is
+        // speedup per participant
+        double speedup {0}, efficiency {0};
+        // Fraction of blocks that took longer than the block lasts
+        double deadlineMissRate {0};
+    };
+
+    struct Report
+    {
+        int numCpus {0};
+        juce::String kernel;
+        int blockSize {0};
+        double sampleRate {0};
+        juce::Array<Result> results;
+
+        juce::String toString() const;
+        bool writeCsv(const juce::File& file) const;
+    };
+
+    // Not on an audio thread, it starts worker threads of its own. Takes
+    // about numBlocks blocks per channel count and participant count.
+    Report run(const Options& options = {});
+}
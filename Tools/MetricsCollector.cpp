@@ -0,0 +1,209 @@
+/*
+  ==============================================================================
+
+    MetricsCollector.cpp
+
+    Reads the shared metrics segment every plugin instance started with
+    FIRSTJUCE_METRICS publishes into, and prints each instance and a
+    summary per host process. Read-only and local: it never writes to the
+    segment and never makes an instance wait.
+
+    No JUCE, builds on its own:
+        c++ -std=c++17 -O2 -ISource Tools/MetricsCollector.cpp Source/MetricsSegment.cpp -o firstjuce-metrics
+    (add -lrt on older Linux)
+
+    firstjuce-metrics [segment] [--watch seconds] [--stale seconds] [--unlink]
+        segment     defaults to MetricsSegment::defaultName
+        --watch     prints again every so many seconds until interrupted
+        --stale     an instance that hasn't published for this long is
+                    listed as stale, its host isn't processing (default 2)
+        --unlink    removes the segment, e.g. after a version change
+
+  ==============================================================================
+*/
+
+#include "MetricsSegment.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace
+{
+    struct Options
+    {
+        std::string segment {MetricsSegment::defaultName};
+        double watchSeconds {0};
+        double staleSeconds {2};
+        bool unlink {false};
+    };
+
+    struct ProcessSummary
+    {
+        int numInstances {0}, numStale {0};
+        double totalMeanLoad {0}, maxLoad {0};
+        int64_t deadlineMisses {0};
+    };
+
+    const char* getStereoModeName(int32_t mode)
+    {
+        switch (mode) {
+            case 0: return "linked";
+            case 1: return "L/R";
+            case 2: return "M/S";
+            default: return "?";
+        }
+    }
+
+    const char* getFilterDesignName(int32_t design)
+    {
+        return design == 1 ? "matched" : "bilinear";
+    }
+
+    int64_t getNowMilliseconds()
+    {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    void printBands(const MetricsSegment::Bands& bands)
+    {
+        std::printf("LC %.0f Hz/%d  PK %.0f Hz %+.1f dB Q %.2f%s  HC %.0f Hz/%d",
+                    bands.lowCutFreq, bands.lowCutSlope,
+                    bands.peakFreq, bands.peakGainDb, bands.peakQuality, bands.peakDynamic != 0 ? " dyn" : "",
+                    bands.highCutFreq, bands.highCutSlope);
+    }
+
+    void printSummary(const MetricsSegment::Layout& layout, const Options& options)
+    {
+        auto now = getNowMilliseconds();
+        std::map<int32_t, ProcessSummary> processes;
+        int numBusy = 0;
+
+        std::printf("%-8s %-16s %8s %6s %3s %-7s %-8s %7s %7s %9s %7s %4s %s\n",
+                    "pid", "instance", "rate", "block", "ch", "stereo", "design",
+                    "load", "max", "blocks", "misses", "tier", "bands");
+
+        for (auto& slot : layout.slots) {
+            auto pid = slot.pid.load(std::memory_order_acquire);
+            if (pid == 0 || !MetricsSegment::isProcessAlive(pid)) {
+                continue;
+            }
+
+            MetricsSegment::Metrics metrics;
+            int64_t published = 0;
+            if (!MetricsSegment::read(slot, metrics, published)) {
+                // Being written to for every attempt, so very much alive
+                numBusy++;
+                continue;
+            }
+
+            auto stale = published == 0 || (double) (now - published) > options.staleSeconds * 1000.0;
+            auto& process = processes[pid];
+            process.numInstances++;
+            process.numStale += stale ? 1 : 0;
+            if (!stale) {
+                process.totalMeanLoad += metrics.meanLoad;
+                process.maxLoad = std::max(process.maxLoad, metrics.maxLoad);
+            }
+            process.deadlineMisses += metrics.deadlineMisses;
+
+            std::printf("%-8d %016llx %8.0f %6d %3d %-7s %-8s %6.1f%% %6.1f%% %9lld %7lld %4d ",
+                        (int) pid, (unsigned long long) slot.instanceId.load(std::memory_order_relaxed),
+                        metrics.sampleRate, metrics.lastBlockSize, metrics.numChannels,
+                        getStereoModeName(metrics.stereoMode), getFilterDesignName(metrics.filterDesign),
+                        100.0 * metrics.meanLoad, 100.0 * metrics.maxLoad,
+                        (long long) metrics.numBlocks, (long long) metrics.deadlineMisses, (int) metrics.qualityTier);
+            for (int path = 0; path < std::min(metrics.numPaths, (int32_t) 2); path++) {
+                std::printf(path == 0 ? "" : " | ");
+                printBands(metrics.bands[path]);
+            }
+            std::printf("%s\n", stale ? "  (stale)" : "");
+        }
+
+        std::printf("\n%-8s %9s %6s %11s %9s %9s\n", "pid", "instances", "stale", "summed load", "max load", "misses");
+
+        ProcessSummary total;
+        for (auto& [pid, process] : processes) {
+            std::printf("%-8d %9d %6d %10.1f%% %8.1f%% %9lld\n",
+                        (int) pid, process.numInstances, process.numStale,
+                        100.0 * process.totalMeanLoad, 100.0 * process.maxLoad, (long long) process.deadlineMisses);
+            total.numInstances += process.numInstances;
+            total.numStale += process.numStale;
+            total.totalMeanLoad += process.totalMeanLoad;
+            total.maxLoad = std::max(total.maxLoad, process.maxLoad);
+            total.deadlineMisses += process.deadlineMisses;
+        }
+
+        std::printf("%-8s %9d %6d %10.1f%% %8.1f%% %9lld\n",
+                    "total", total.numInstances, total.numStale,
+                    100.0 * total.totalMeanLoad, 100.0 * total.maxLoad, (long long) total.deadlineMisses);
+        std::printf("%zu processes, %u slots claimed since the segment was created",
+                    processes.size(), layout.header.numClaims.load(std::memory_order_relaxed));
+        if (numBusy > 0) {
+            std::printf(", %d busy", numBusy);
+        }
+        std::printf("\n");
+    }
+
+    bool parseOptions(int argc, char* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; i++) {
+            auto argument = std::string(argv[i]);
+            auto hasValue = i + 1 < argc;
+
+            if (argument == "--watch" && hasValue) {
+                options.watchSeconds = std::atof(argv[++i]);
+            } else if (argument == "--stale" && hasValue) {
+                options.staleSeconds = std::atof(argv[++i]);
+            } else if (argument == "--unlink") {
+                options.unlink = true;
+            } else if (!argument.empty() && argument[0] == '/') {
+                options.segment = argument;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [segment] [--watch seconds] [--stale seconds] [--unlink]\n", argv[0]);
+        return 2;
+    }
+
+    if (options.unlink) {
+        if (!MetricsSegment::unlink(options.segment.c_str())) {
+            std::fprintf(stderr, "Couldn't remove %s\n", options.segment.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    auto* layout = MetricsSegment::map(options.segment.c_str(), false);
+    if (layout == nullptr) {
+        std::fprintf(stderr, "No metrics segment %s, or it's from a different version\n", options.segment.c_str());
+        return 1;
+    }
+
+    for (;;) {
+        printSummary(*layout, options);
+        if (options.watchSeconds <= 0) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.watchSeconds));
+        std::printf("\n");
+    }
+
+    MetricsSegment::unmap(layout);
+    return 0;
+}